@@ -0,0 +1,164 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Runs an AutoFlip graph on an input with the MediaPipe profiler enabled and
+// reports where the time goes: per node Process calls, total and percentile
+// Process time, mean queue wait and packet counts, plus the end-to-end frames
+// per second and the peak resident set size. The graph runs --num_runs times
+// to show the variance between runs. The report is printed as a table and,
+// with --output_json, written as a BenchmarkReport in JSON.
+//
+// Nodes of subgraphs, e.g. of AutoFlipShotBoundaryDetectionSubgraph, are
+// reported one by one under the name of their subgraph instance.
+//
+// Example:
+//   autoflip_benchmark \
+//     --calculator_graph_config_file=autoflip_graph_trace.pbtxt \
+//     --input_side_packets=input_video_path=/tmp/in.mp4,trace_path=/tmp/t \
+//     --num_runs=3 --output_json=/tmp/autoflip_benchmark.json
+
+#include <sys/resource.h>
+
+#include <atomic>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_split.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "google/protobuf/util/json_util.h"
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/benchmark_report.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/commandlineflags.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+DEFINE_string(calculator_graph_config_file, "",
+              "Graph to benchmark, e.g. autoflip_graph.pbtxt.");
+DEFINE_string(input_side_packets, "", "Comma-separated name=value string "
+              "side packets of the graph, as for run_autoflip.");
+DEFINE_string(frame_stream, "video_raw", "Stream whose packets are counted "
+              "as the frames of the input.");
+DEFINE_int32(num_runs, 3, "Number of runs of the graph.");
+DEFINE_int64(histogram_interval_usec, 1000, "Interval of the Process time "
+             "histograms the percentiles are computed from.");
+DEFINE_int32(num_histogram_intervals, 1000, "Number of intervals of the "
+             "Process time histograms; longer calls fall into the last one.");
+DEFINE_string(output_json, "", "If set, the report is written to this path "
+              "as JSON.");
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+int64 PeakRssKb() {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  // Kilobytes on Linux.
+  return usage.ru_maxrss;
+}
+
+::mediapipe::Status RunOnce(const CalculatorGraphConfig& config,
+                            const std::map<std::string, Packet>& side_packets,
+                            BenchmarkRun* run) {
+  CalculatorGraph graph;
+  MP_RETURN_IF_ERROR(graph.Initialize(config));
+  std::atomic<int64> frames(0);
+  MP_RETURN_IF_ERROR(graph.ObserveOutputStream(
+      FLAGS_frame_stream, [&frames](const Packet& packet) {
+        ++frames;
+        return ::mediapipe::OkStatus();
+      }));
+  const absl::Time start = absl::Now();
+  MP_RETURN_IF_ERROR(graph.Run(side_packets));
+  const absl::Duration wall_time = absl::Now() - start;
+
+  std::vector<CalculatorProfile> profiles;
+  MP_RETURN_IF_ERROR(graph.profiler()->GetCalculatorProfiles(&profiles));
+  MP_RETURN_IF_ERROR(SummarizeProfiles(graph.Config(), profiles, run));
+  run->set_frames(frames);
+  run->set_wall_time_us(absl::ToInt64Microseconds(wall_time));
+  run->set_frames_per_second(frames / absl::ToDoubleSeconds(wall_time));
+  run->set_peak_rss_kb(PeakRssKb());
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status RunBenchmark() {
+  RET_CHECK(!FLAGS_calculator_graph_config_file.empty())
+      << "--calculator_graph_config_file is required.";
+  RET_CHECK_GT(FLAGS_num_runs, 0);
+  std::string config_contents;
+  MP_RETURN_IF_ERROR(::mediapipe::file::GetContents(
+      FLAGS_calculator_graph_config_file, &config_contents));
+  auto config = ParseTextProtoOrDie<CalculatorGraphConfig>(config_contents);
+  auto* profiler_config = config.mutable_profiler_config();
+  profiler_config->set_enable_profiler(true);
+  profiler_config->set_histogram_interval_size_usec(
+      FLAGS_histogram_interval_usec);
+  profiler_config->set_num_histogram_intervals(FLAGS_num_histogram_intervals);
+
+  std::map<std::string, Packet> side_packets;
+  for (const auto& name_value :
+       absl::StrSplit(FLAGS_input_side_packets, ',', absl::SkipEmpty())) {
+    const std::vector<std::string> parts = absl::StrSplit(name_value, '=');
+    RET_CHECK_EQ(parts.size(), 2) << "Invalid side packet " << name_value;
+    side_packets[parts[0]] = MakePacket<std::string>(parts[1]);
+  }
+
+  BenchmarkReport report;
+  report.set_graph(FLAGS_calculator_graph_config_file);
+  report.set_input(FLAGS_input_side_packets);
+  for (int i = 0; i < FLAGS_num_runs; ++i) {
+    auto* run = report.add_run();
+    MP_RETURN_IF_ERROR(RunOnce(config, side_packets, run));
+    LOG(INFO) << "Run " << i << ": " << run->frames() << " frames at "
+              << run->frames_per_second() << " fps.";
+  }
+  SummarizeRuns(&report);
+  std::cout << FormatBenchmarkTable(report);
+
+  if (!FLAGS_output_json.empty()) {
+    google::protobuf::util::JsonPrintOptions json_options;
+    json_options.add_whitespace = true;
+    json_options.preserve_proto_field_names = true;
+    std::string json;
+    RET_CHECK(google::protobuf::util::MessageToJsonString(report, &json,
+                                                          json_options)
+                  .ok())
+        << "Fail to convert the report to JSON.";
+    MP_RETURN_IF_ERROR(::mediapipe::file::SetContents(FLAGS_output_json, json));
+  }
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  ::mediapipe::Status status = ::mediapipe::autoflip::RunBenchmark();
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to run the benchmark: " << status.message();
+    return 1;
+  }
+  return 0;
+}
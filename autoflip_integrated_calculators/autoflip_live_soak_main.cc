@@ -0,0 +1,313 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Soak test of a live AutoFlip graph such as autoflip_graph_live.pbtxt.
+// Synthetic frames (see synthetic_video.h) are sent to the input stream at
+// --fps for --duration_minutes, and for every frame that comes out cropped
+// the time from sending it to receiving its crop is measured. Every
+// --report_seconds, the frames sent, cropped, dropped by the flow limiter and
+// cropped later than --latency_budget_ms, the p50, p99 and maximum latency
+// and the resident set size are printed.
+//
+// The test exits with 1 if, after --warmup_seconds, any frame is cropped
+// later than --latency_budget_ms after it was sent, an interval crops no
+// frame at all, or the resident set size grows by more than
+// --max_rss_growth_mb over the run. The budget is applied to the graph with
+// ApplyLatencyBudget.
+//
+// Example:
+//   autoflip_live_soak --graph=autoflip_graph_live.pbtxt \
+//     --latency_budget_ms=1000 --duration_minutes=240
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/live_latency_budget.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/synthetic_video.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/port/commandlineflags.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status.h"
+
+DEFINE_string(graph,
+              "mediapipe/examples/desktop/autoflip/autoflip_graph_live.pbtxt",
+              "Live graph to soak.");
+DEFINE_string(input_stream, "input_video", "Input stream of the frames.");
+DEFINE_string(crop_stream, "cropped_frames", "Stream of the cropped frames.");
+DEFINE_string(aspect_ratio, "9:16", "Aspect ratio of the crops.");
+DEFINE_int32(width, 640, "Width of the synthetic frames.");
+DEFINE_int32(height, 360, "Height of the synthetic frames.");
+DEFINE_double(fps, 30, "Frame rate the frames are sent at.");
+DEFINE_double(shot_seconds, 4, "Length of the shots of the synthetic input.");
+DEFINE_double(latency_budget_ms, 1000, "Latency budget of the graph.");
+DEFINE_double(duration_minutes, 120, "Length of the input.");
+DEFINE_bool(realtime, true, "If true, frames are sent at --fps in wall "
+            "time; if false, as fast as the graph accepts them, which "
+            "exercises dropping under back-pressure.");
+DEFINE_double(report_seconds, 60, "Length of a report interval.");
+DEFINE_double(warmup_seconds, 60, "Intervals ending before this are "
+              "printed but not checked; the resident set size at the end "
+              "of the warm-up is the reference for the growth check.");
+DEFINE_double(max_rss_growth_mb, 64, "Allowed growth of the resident set "
+              "size after the warm-up.");
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+int64 RssKb() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  int64 rss_kb = 0;
+  while (std::getline(status, line)) {
+    if (absl::StartsWith(line, "VmRSS:")) {
+      const std::vector<std::string> parts =
+          absl::StrSplit(line, ' ', absl::SkipEmpty());
+      if (parts.size() >= 2 && absl::SimpleAtoi(parts[1], &rss_kb)) {
+        break;
+      }
+    }
+  }
+  return rss_kb;
+}
+
+double Percentile(std::vector<double>* values, double percentile) {
+  if (values->empty()) {
+    return 0;
+  }
+  const size_t index = std::min(
+      values->size() - 1, static_cast<size_t>(percentile * values->size()));
+  std::nth_element(values->begin(), values->begin() + index, values->end());
+  return (*values)[index];
+}
+
+// Send times of the frames whose crops have not come out yet, and the
+// measurements of the current report interval. Frames dropped by the flow
+// limiter never come out; they are counted and forgotten once a later frame
+// does, so that the test itself does not grow.
+class LatencyTracker {
+ public:
+  explicit LatencyTracker(double budget_ms) : budget_ms_(budget_ms) {}
+
+  void Sent(int64 timestamp_us) {
+    absl::MutexLock lock(&mutex_);
+    pending_[timestamp_us] = absl::Now();
+    ++sent_;
+  }
+
+  void Cropped(int64 timestamp_us) {
+    const absl::Time now = absl::Now();
+    absl::MutexLock lock(&mutex_);
+    const auto end = pending_.upper_bound(timestamp_us);
+    for (auto it = pending_.begin(); it != end; ++it) {
+      if (it->first == timestamp_us) {
+        const double latency_ms = absl::ToDoubleMilliseconds(now - it->second);
+        latencies_ms_.push_back(latency_ms);
+        max_ms_ = std::max(max_ms_, latency_ms);
+        if (latency_ms > budget_ms_) {
+          ++late_;
+        }
+      } else {
+        ++dropped_;
+      }
+    }
+    pending_.erase(pending_.begin(), end);
+  }
+
+  struct Interval {
+    int64 sent = 0;
+    int64 cropped = 0;
+    int64 dropped = 0;
+    // Cropped frames whose latency exceeds the budget.
+    int64 late = 0;
+    double p50_ms = 0;
+    double p99_ms = 0;
+    double max_ms = 0;
+  };
+
+  // Returns the measurements since the last call and starts a new interval.
+  Interval TakeInterval() {
+    absl::MutexLock lock(&mutex_);
+    Interval interval;
+    interval.sent = sent_;
+    interval.cropped = latencies_ms_.size();
+    interval.dropped = dropped_;
+    interval.p50_ms = Percentile(&latencies_ms_, 0.5);
+    interval.p99_ms = Percentile(&latencies_ms_, 0.99);
+    interval.late = late_;
+    interval.max_ms = max_ms_;
+    sent_ = 0;
+    dropped_ = 0;
+    late_ = 0;
+    max_ms_ = 0;
+    latencies_ms_.clear();
+    return interval;
+  }
+
+ private:
+  const double budget_ms_;
+  absl::Mutex mutex_;
+  std::map<int64, absl::Time> pending_ ABSL_GUARDED_BY(mutex_);
+  std::vector<double> latencies_ms_ ABSL_GUARDED_BY(mutex_);
+  int64 sent_ ABSL_GUARDED_BY(mutex_) = 0;
+  int64 dropped_ ABSL_GUARDED_BY(mutex_) = 0;
+  int64 late_ ABSL_GUARDED_BY(mutex_) = 0;
+  double max_ms_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+std::unique_ptr<ImageFrame> RenderFrame(const SyntheticVideoSpec& spec,
+                                        int index, cv::Mat* bgr) {
+  RenderSyntheticFrame(spec, index, bgr);
+  auto frame =
+      absl::make_unique<ImageFrame>(ImageFormat::SRGB, spec.width, spec.height);
+  cv::Mat rgb = formats::MatView(frame.get());
+  cv::cvtColor(*bgr, rgb, cv::COLOR_BGR2RGB);
+  return frame;
+}
+
+::mediapipe::Status RunSoak(bool* passed) {
+  std::string config_contents;
+  MP_RETURN_IF_ERROR(
+      ::mediapipe::file::GetContents(FLAGS_graph, &config_contents));
+  auto config = ParseTextProtoOrDie<CalculatorGraphConfig>(config_contents);
+  MP_RETURN_IF_ERROR(ApplyLatencyBudget(FLAGS_latency_budget_ms / 1000,
+                                        FLAGS_fps, &config));
+
+  // The synthetic input repeats after 12 shots, i.e. four of each scene.
+  SyntheticVideoSpec spec;
+  spec.width = FLAGS_width;
+  spec.height = FLAGS_height;
+  spec.fps = FLAGS_fps;
+  spec.shot_frames =
+      std::max(1, static_cast<int>(FLAGS_shot_seconds * FLAGS_fps));
+  spec.num_frames = 12 * spec.shot_frames;
+
+  CalculatorGraph graph;
+  MP_RETURN_IF_ERROR(graph.Initialize(config));
+  LatencyTracker tracker(FLAGS_latency_budget_ms);
+  MP_RETURN_IF_ERROR(graph.ObserveOutputStream(
+      FLAGS_crop_stream, [&tracker](const Packet& packet) {
+        tracker.Cropped(packet.Timestamp().Value());
+        return ::mediapipe::OkStatus();
+      }));
+  MP_RETURN_IF_ERROR(graph.StartRun(
+      {{"aspect_ratio", MakePacket<std::string>(FLAGS_aspect_ratio)}}));
+
+  const int64 num_frames =
+      static_cast<int64>(FLAGS_duration_minutes * 60 * FLAGS_fps);
+  const absl::Duration frame_period = absl::Seconds(1 / FLAGS_fps);
+  const absl::Duration report_period = absl::Seconds(FLAGS_report_seconds);
+  const absl::Time start = absl::Now();
+  absl::Time next_report = start + report_period;
+  int64 warm_rss_kb = -1;
+  int64 last_rss_kb = 0;
+  std::vector<std::string> failures;
+  std::cout << absl::StrFormat(
+      "%8s %8s %8s %8s %8s %10s %10s %10s %10s\n", "minute", "sent",
+      "cropped", "dropped", "late", "p50 ms", "p99 ms", "max ms", "RSS MB");
+  cv::Mat bgr;
+  for (int64 i = 0; i < num_frames; ++i) {
+    if (FLAGS_realtime) {
+      absl::SleepFor(start + i * frame_period - absl::Now());
+    }
+    const int64 timestamp_us = std::llround(i * 1000000.0 / FLAGS_fps);
+    Packet frame = Adopt(RenderFrame(spec, i % spec.num_frames, &bgr).release())
+                       .At(Timestamp(timestamp_us));
+    tracker.Sent(timestamp_us);
+    MP_RETURN_IF_ERROR(
+        graph.AddPacketToInputStream(FLAGS_input_stream, std::move(frame)));
+
+    const absl::Time now = absl::Now();
+    if (now < next_report) {
+      continue;
+    }
+    next_report += report_period;
+    const double minutes = absl::ToDoubleMinutes(now - start);
+    const LatencyTracker::Interval interval = tracker.TakeInterval();
+    last_rss_kb = RssKb();
+    std::cout << absl::StrFormat(
+        "%8.1f %8d %8d %8d %8d %10.1f %10.1f %10.1f %10.1f\n", minutes,
+        interval.sent, interval.cropped, interval.dropped, interval.late,
+        interval.p50_ms, interval.p99_ms, interval.max_ms,
+        last_rss_kb / 1024.0);
+    if (absl::ToDoubleSeconds(now - start) < FLAGS_warmup_seconds) {
+      continue;
+    }
+    if (warm_rss_kb < 0) {
+      warm_rss_kb = last_rss_kb;
+    }
+    if (interval.cropped == 0) {
+      failures.push_back(
+          absl::StrFormat("No frame cropped in the interval ending at "
+                          "minute %.1f.", minutes));
+    } else if (interval.late > 0) {
+      failures.push_back(absl::StrFormat(
+          "%d frames cropped over the budget of %.1f ms, up to %.1f ms, in "
+          "the interval ending at minute %.1f.",
+          interval.late, FLAGS_latency_budget_ms, interval.max_ms, minutes));
+    }
+  }
+  MP_RETURN_IF_ERROR(graph.CloseAllInputStreams());
+  MP_RETURN_IF_ERROR(graph.WaitUntilDone());
+
+  if (warm_rss_kb < 0) {
+    failures.push_back("The run ended within the warm-up; nothing checked.");
+  } else if ((last_rss_kb - warm_rss_kb) / 1024.0 > FLAGS_max_rss_growth_mb) {
+    failures.push_back(absl::StrFormat(
+        "RSS grew by %.1f MB after the warm-up, more than %.1f MB.",
+        (last_rss_kb - warm_rss_kb) / 1024.0, FLAGS_max_rss_growth_mb));
+  }
+  for (const auto& failure : failures) {
+    std::cout << "FAILED " << failure << "\n";
+  }
+  *passed = failures.empty();
+  std::cout << (*passed ? "PASSED" : "FAILED") << "\n";
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  bool passed = false;
+  ::mediapipe::Status status = ::mediapipe::autoflip::RunSoak(&passed);
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to run the soak test: " << status.message();
+    return 1;
+  }
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,382 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// End-to-end performance regression suite. For every case, a deterministic
+// synthetic video (see synthetic_video.h) with cuts at known frames, talking
+// face sprites, scrolling text and static slides is generated, and the
+// production graphs run on it in this process. With --web_benchmark, the web
+// graph also runs on the raw I420 frames of the video, through
+// graph_runner_benchmark.
+//
+// Each run records the frames per second, the latency to the first crop and
+// the peak RSS, and checks the detected shot changes and, where the graph
+// outputs them, the active speakers against the ground truth of the video.
+// The measurements are compared with --baseline, a JSON PerfBaseline written
+// by an earlier --update_baseline run on the same machine, which refuses to
+// write runs that emitted no crop. The suite exits with 1 if a run emits no
+// crop, a check fails or a measurement regresses by more than --tolerance.
+//
+// Example:
+//   autoflip_perf_suite \
+//     --graphs=autoflip_graph.pbtxt \
+//     --cases=640x360x300,1280x720x300 --work_dir=/tmp/autoflip_perf \
+//     --baseline=/path/to/autoflip_perf_baseline.json
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "google/protobuf/util/json_util.h"
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/perf_baseline.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/synthetic_video.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/commandlineflags.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+DEFINE_string(graphs,
+              "mediapipe/examples/desktop/autoflip/autoflip_graph.pbtxt",
+              "Comma-separated production graphs to run.");
+DEFINE_string(cases, "640x360x300,1280x720x300,1920x1080x150",
+              "Comma-separated synthetic videos, as WIDTHxHEIGHTxFRAMES.");
+DEFINE_double(fps, 30, "Frame rate of the synthetic videos.");
+DEFINE_double(shot_seconds, 2, "Length of the shots of the synthetic videos.");
+DEFINE_string(work_dir, "/tmp/autoflip_perf_suite",
+              "Directory of the synthetic videos and the cropped outputs.");
+DEFINE_string(aspect_ratio, "9:16", "Aspect ratio of the crops.");
+DEFINE_string(input_side_packets, "", "Comma-separated name=value string "
+              "side packets the graphs need besides input_video_path, "
+              "output_video_path and aspect_ratio.");
+DEFINE_string(frame_stream, "video_raw", "Stream of the decoded frames.");
+DEFINE_string(crop_stream, "cropped_frames", "Stream of the cropped frames.");
+DEFINE_string(shot_stream, "shot_change", "Stream of the shot changes.");
+DEFINE_string(speaker_stream, "active_speaker_regions",
+              "Stream of the active speaker regions; graphs without it are "
+              "not checked for speakers.");
+DEFINE_string(web_benchmark, "", "If set, graph_runner_benchmark binary "
+              "that runs --web_graph on each case.");
+DEFINE_string(web_graph, "", "Web graph for --web_benchmark.");
+DEFINE_int32(web_num_threads, 1, "Threads of the web graph.");
+DEFINE_string(baseline, "", "JSON PerfBaseline to compare with, or to write "
+              "with --update_baseline.");
+DEFINE_bool(update_baseline, false, "If true, writes the measurements to "
+            "--baseline instead of comparing with it.");
+DEFINE_double(tolerance, 0.15, "Allowed regression, as a fraction of the "
+              "baseline value.");
+DEFINE_int32(shot_tolerance_frames, 2, "Allowed distance of a detected shot "
+             "change from its cut.");
+DEFINE_double(speaker_tolerance, 0.15, "Allowed horizontal distance of an "
+              "active speaker region from the talking face, normalized.");
+DEFINE_bool(check_speakers, true, "If false, active speakers are not "
+            "checked.");
+DEFINE_string(output_json, "", "If set, the measurements are also written "
+              "to this path as a JSON PerfBaseline.");
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+// The peak RSS of this process is reset before each graph run, so that each
+// run reports its own. Linux only.
+void ResetPeakRss() {
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  clear_refs << "5";
+}
+
+int64 PeakRssKb() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  int64 peak_kb = 0;
+  while (std::getline(status, line)) {
+    if (absl::StartsWith(line, "VmHWM:")) {
+      const std::vector<std::string> parts =
+          absl::StrSplit(line, ' ', absl::SkipEmpty());
+      if (parts.size() >= 2 && absl::SimpleAtoi(parts[1], &peak_kb)) {
+        break;
+      }
+    }
+  }
+  return peak_kb;
+}
+
+std::string Basename(const std::string& path) {
+  return path.substr(path.rfind('/') + 1);
+}
+
+bool HasStream(const CalculatorGraphConfig& config, const std::string& name) {
+  for (const auto& node : config.node()) {
+    for (const auto& output : node.output_stream()) {
+      if (output.substr(output.rfind(':') + 1) == name) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+::mediapipe::Status ParseCase(const std::string& name,
+                              SyntheticVideoSpec* spec) {
+  const std::vector<std::string> parts = absl::StrSplit(name, 'x');
+  RET_CHECK(parts.size() == 3 && absl::SimpleAtoi(parts[0], &spec->width) &&
+            absl::SimpleAtoi(parts[1], &spec->height) &&
+            absl::SimpleAtoi(parts[2], &spec->num_frames))
+      << "Invalid case " << name << ", expected WIDTHxHEIGHTxFRAMES.";
+  spec->fps = FLAGS_fps;
+  spec->shot_frames = std::max(1, static_cast<int>(FLAGS_shot_seconds *
+                                                   FLAGS_fps));
+  return ::mediapipe::OkStatus();
+}
+
+// Runs the production graph at |graph_path| on |video_path| in this
+// process.
+::mediapipe::Status RunGraph(const std::string& graph_path,
+                             const std::string& video_path,
+                             const std::string& output_path,
+                             PerfMeasurement* measurement) {
+  std::string config_contents;
+  MP_RETURN_IF_ERROR(
+      ::mediapipe::file::GetContents(graph_path, &config_contents));
+  const auto config =
+      ParseTextProtoOrDie<CalculatorGraphConfig>(config_contents);
+  std::map<std::string, Packet> side_packets = {
+      {"input_video_path", MakePacket<std::string>(video_path)},
+      {"output_video_path", MakePacket<std::string>(output_path)},
+      {"aspect_ratio", MakePacket<std::string>(FLAGS_aspect_ratio)}};
+  for (const auto& name_value :
+       absl::StrSplit(FLAGS_input_side_packets, ',', absl::SkipEmpty())) {
+    const std::vector<std::string> parts = absl::StrSplit(name_value, '=');
+    RET_CHECK_EQ(parts.size(), 2) << "Invalid side packet " << name_value;
+    side_packets[parts[0]] = MakePacket<std::string>(parts[1]);
+  }
+
+  CalculatorGraph graph;
+  MP_RETURN_IF_ERROR(graph.Initialize(config));
+  // Observers of different streams may run concurrently.
+  absl::Mutex mutex;
+  int64 frames = 0;
+  absl::Time first_crop = absl::InfiniteFuture();
+  MP_RETURN_IF_ERROR(graph.ObserveOutputStream(
+      FLAGS_frame_stream, [&](const Packet& packet) {
+        absl::MutexLock lock(&mutex);
+        ++frames;
+        return ::mediapipe::OkStatus();
+      }));
+  MP_RETURN_IF_ERROR(graph.ObserveOutputStream(
+      FLAGS_crop_stream, [&](const Packet& packet) {
+        absl::MutexLock lock(&mutex);
+        first_crop = std::min(first_crop, absl::Now());
+        return ::mediapipe::OkStatus();
+      }));
+  MP_RETURN_IF_ERROR(graph.ObserveOutputStream(
+      FLAGS_shot_stream, [&](const Packet& packet) {
+        if (packet.Get<bool>()) {
+          absl::MutexLock lock(&mutex);
+          measurement->add_shot_change_us(packet.Timestamp().Value());
+        }
+        return ::mediapipe::OkStatus();
+      }));
+  measurement->set_has_speakers(FLAGS_check_speakers &&
+                                HasStream(config, FLAGS_speaker_stream));
+  if (measurement->has_speakers()) {
+    MP_RETURN_IF_ERROR(graph.ObserveOutputStream(
+        FLAGS_speaker_stream, [&](const Packet& packet) {
+          absl::MutexLock lock(&mutex);
+          for (const auto& region : packet.Get<DetectionSet>().detections()) {
+            const auto& location = region.location_normalized();
+            auto* speaker = measurement->add_speaker();
+            speaker->set_timestamp_us(packet.Timestamp().Value());
+            speaker->set_center_x(location.x() + location.width() / 2);
+          }
+          return ::mediapipe::OkStatus();
+        }));
+  }
+
+  ResetPeakRss();
+  const absl::Time start = absl::Now();
+  MP_RETURN_IF_ERROR(graph.Run(side_packets));
+  const absl::Duration wall_time = absl::Now() - start;
+  measurement->set_graph(Basename(graph_path));
+  measurement->set_frames(frames);
+  measurement->set_frames_per_second(frames /
+                                     absl::ToDoubleSeconds(wall_time));
+  // Left unset if no crop was emitted, which CheckMeasurement() fails.
+  if (first_crop != absl::InfiniteFuture()) {
+    measurement->set_first_crop_latency_ms(
+        absl::ToDoubleMilliseconds(first_crop - start));
+  }
+  measurement->set_peak_rss_kb(PeakRssKb());
+  return ::mediapipe::OkStatus();
+}
+
+// Runs the web graph on the raw frames at |yuv_path| with
+// graph_runner_benchmark, in a process of its own.
+::mediapipe::Status RunWebGraph(const SyntheticVideoSpec& spec,
+                                const std::string& yuv_path,
+                                PerfMeasurement* measurement) {
+  const std::string output_path = absl::StrCat(yuv_path, ".measurements");
+  const std::string command = absl::StrFormat(
+      "%s --graph=%s --input_yuv=%s --width=%d --height=%d --fps=%f "
+      "--num_threads=%d --aspect_ratio=%s --output_measurements=%s",
+      FLAGS_web_benchmark, FLAGS_web_graph, yuv_path, spec.width, spec.height,
+      spec.fps, FLAGS_web_num_threads, FLAGS_aspect_ratio, output_path);
+  RET_CHECK_EQ(std::system(command.c_str()), 0) << "Failed: " << command;
+  std::ifstream input(output_path, std::ios::in | std::ios::binary);
+  PerfBaseline measurements;
+  RET_CHECK(input.is_open() && measurements.ParseFromIstream(&input) &&
+            measurements.measurement_size() == 1)
+      << "No measurement in " << output_path;
+  *measurement = measurements.measurement(0);
+  measurement->set_graph(absl::StrCat("web:", Basename(FLAGS_web_graph)));
+  measurement->set_has_speakers(false);
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status ReadBaseline(const std::string& path,
+                                 PerfBaseline* baseline) {
+  std::string json;
+  MP_RETURN_IF_ERROR(::mediapipe::file::GetContents(path, &json));
+  RET_CHECK(google::protobuf::util::JsonStringToMessage(json, baseline).ok())
+      << "Invalid baseline " << path;
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status WriteJson(const std::string& path,
+                              const PerfBaseline& measured) {
+  google::protobuf::util::JsonPrintOptions json_options;
+  json_options.add_whitespace = true;
+  json_options.preserve_proto_field_names = true;
+  std::string json;
+  RET_CHECK(
+      google::protobuf::util::MessageToJsonString(measured, &json, json_options)
+          .ok());
+  return ::mediapipe::file::SetContents(path, json);
+}
+
+::mediapipe::Status RunSuite(bool* passed) {
+  RET_CHECK(!FLAGS_update_baseline || !FLAGS_baseline.empty())
+      << "--update_baseline needs --baseline.";
+  RET_CHECK(FLAGS_web_benchmark.empty() || !FLAGS_web_graph.empty())
+      << "--web_benchmark needs --web_graph.";
+  MP_RETURN_IF_ERROR(::mediapipe::file::RecursivelyCreateDir(FLAGS_work_dir));
+  const std::vector<std::string> graphs =
+      absl::StrSplit(FLAGS_graphs, ',', absl::SkipEmpty());
+
+  PerfBaseline measured;
+  std::vector<std::string> failures;
+  for (const auto& case_name :
+       absl::StrSplit(FLAGS_cases, ',', absl::SkipEmpty())) {
+    SyntheticVideoSpec spec;
+    MP_RETURN_IF_ERROR(ParseCase(std::string(case_name), &spec));
+    const std::string prefix = absl::StrCat(FLAGS_work_dir, "/", case_name);
+    const std::string video_path = absl::StrCat(prefix, ".mp4");
+    const std::string yuv_path =
+        FLAGS_web_benchmark.empty() ? "" : absl::StrCat(prefix, ".yuv");
+    MP_RETURN_IF_ERROR(WriteSyntheticVideo(spec, video_path, yuv_path));
+    const SyntheticVideoGroundTruth truth = SyntheticGroundTruth(spec);
+
+    std::vector<PerfMeasurement*> case_measurements;
+    for (const auto& graph_path : graphs) {
+      auto* measurement = measured.add_measurement();
+      MP_RETURN_IF_ERROR(RunGraph(
+          graph_path, video_path,
+          absl::StrCat(prefix, ".", Basename(graph_path), ".mp4"),
+          measurement));
+      case_measurements.push_back(measurement);
+    }
+    if (!FLAGS_web_benchmark.empty()) {
+      auto* measurement = measured.add_measurement();
+      MP_RETURN_IF_ERROR(RunWebGraph(spec, yuv_path, measurement));
+      case_measurements.push_back(measurement);
+    }
+    for (auto* measurement : case_measurements) {
+      measurement->set_case_name(std::string(case_name));
+      CheckMeasurement(*measurement, &failures);
+      CheckGroundTruth(truth, *measurement, FLAGS_shot_tolerance_frames,
+                       FLAGS_speaker_tolerance, &failures);
+    }
+  }
+
+  std::cout << absl::StrFormat("%-20s %-32s %8s %10s %14s %12s %6s\n", "case",
+                               "graph", "frames", "fps", "first crop ms",
+                               "peak RSS MB", "shots");
+  for (const auto& measurement : measured.measurement()) {
+    const std::string first_crop =
+        measurement.has_first_crop_latency_ms()
+            ? absl::StrFormat("%.0f", measurement.first_crop_latency_ms())
+            : "no crop";
+    std::cout << absl::StrFormat(
+        "%-20s %-32s %8d %10.1f %14s %12.1f %6d\n", measurement.case_name(),
+        measurement.graph(), measurement.frames(),
+        measurement.frames_per_second(), first_crop,
+        measurement.peak_rss_kb() / 1024.0, measurement.shot_change_us_size());
+  }
+  if (!FLAGS_output_json.empty()) {
+    MP_RETURN_IF_ERROR(WriteJson(FLAGS_output_json, measured));
+  }
+  if (FLAGS_update_baseline) {
+    std::vector<std::string> incomplete;
+    for (const auto& measurement : measured.measurement()) {
+      CheckMeasurement(measurement, &incomplete);
+    }
+    RET_CHECK(incomplete.empty())
+        << "Not writing an incomplete baseline: "
+        << absl::StrJoin(incomplete, "; ");
+    MP_RETURN_IF_ERROR(WriteJson(FLAGS_baseline, measured));
+    std::cout << "Baseline written to " << FLAGS_baseline << "\n";
+  } else if (!FLAGS_baseline.empty()) {
+    PerfBaseline baseline;
+    MP_RETURN_IF_ERROR(ReadBaseline(FLAGS_baseline, &baseline));
+    CompareToBaseline(baseline, measured, FLAGS_tolerance, &failures);
+  }
+
+  for (const auto& failure : failures) {
+    std::cout << "FAILED " << failure << "\n";
+  }
+  *passed = failures.empty();
+  std::cout << (*passed ? "PASSED" : "FAILED") << "\n";
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  bool passed = false;
+  ::mediapipe::Status status = ::mediapipe::autoflip::RunSuite(&passed);
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to run the performance suite: " << status.message();
+    return 1;
+  }
+  return passed ? 0 : 1;
+}
@@ -17,6 +17,7 @@
 
 #include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
 #include "mediapipe/examples/desktop/autoflip/calculators/active_speaker_to_region_calculator.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/simd_kernels.h"
 #include "mediapipe/examples/desktop/autoflip/quality/visual_scorer.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/detection.pb.h"
@@ -72,6 +73,8 @@ class ActiveSpeakerToRegionCalculator : public CalculatorBase {
   // Dimensions of video frame
   int frame_width_;
   int frame_height_;
+  // Speaker boxes of the current frame, clipped to the frame together.
+  Boxes boxes_;
 }; // end with inheritance
 
 REGISTER_CALCULATOR(ActiveSpeakerToRegionCalculator);
@@ -123,25 +126,24 @@ ActiveSpeakerToRegionCalculator::ActiveSpeakerToRegionCalculator() {}
     const auto& input_rois =
         cc->Inputs().Tag(kInputRois).Get<std::vector<Detection>>();
 
+    boxes_.Clear();
     for (const auto& input_roi : input_rois) {
       RET_CHECK(input_roi.location_data().format() ==
         mediapipe::LocationData::RELATIVE_BOUNDING_BOX)
         << "Speaker detection input is lacking required relative_bounding_box()";
       const auto& location = input_roi.location_data().relative_bounding_box();
+      boxes_.Add(location.xmin(), location.ymin(), location.width(),
+                 location.height());
+    }
+    ClampToUnitSquare(&boxes_);
 
-      float x = std::max(0.0f, location.xmin());
-      float y = std::max(0.0f, location.ymin());
-      float width =
-          std::min(location.width() - x + location.xmin(), 1 - x);
-      float height = 
-          std::min(location.height() - y + location.ymin(), 1 - y);
-
+    for (int i = 0; i < boxes_.size(); ++i) {
       // Convert the text bounding box to a region.
       SalientRegion* region = region_set->add_detections();
-      region->mutable_location_normalized()->set_x(x);
-      region->mutable_location_normalized()->set_y(y);
-      region->mutable_location_normalized()->set_width(width);
-      region->mutable_location_normalized()->set_height(height);
+      region->mutable_location_normalized()->set_x(boxes_.xmin[i]);
+      region->mutable_location_normalized()->set_y(boxes_.ymin[i]);
+      region->mutable_location_normalized()->set_width(boxes_.width[i]);
+      region->mutable_location_normalized()->set_height(boxes_.height[i]);
       region->mutable_signal_type()->set_standard(SignalType::SPEAKER);
 
       // Score the scores based on image cues.
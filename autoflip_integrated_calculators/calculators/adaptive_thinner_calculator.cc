@@ -0,0 +1,269 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+
+#include "mediapipe/examples/desktop/autoflip/calculators/adaptive_thinner_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// IO labels.
+constexpr char kVideo[] = "VIDEO";
+constexpr char kInputMotionVideo[] = "MOTION_VIDEO";
+constexpr char kInputBoost[] = "BOOST";
+constexpr char kOutputSamplingRate[] = "SAMPLING_RATE";
+
+// This calculator thins the frame streams that feed the detectors, like an
+// ASYNC PacketThinnerCalculator, but adapts the sampling period to the
+// video: static stretches are sampled every max_period_us, scenes with a lot
+// of motion every min_period_us, and the rate is interpolated in between. The
+// motion is the mean absolute difference between consecutive frames of
+// MOTION_VIDEO (or VIDEO:0 if not connected), so a small frame such as the
+// 48x27 level of ImagePyramidCalculator keeps it cheap. It is measured on
+// every frame, not only on the sampled ones.
+//
+// Any number of VIDEO streams can be thinned; input i is passed through to
+// output i, and all are sampled at the same timestamps, those of the frames
+// of VIDEO:0 that are kept. Any number of bool BOOST streams, e.g. shot and
+// speaker changes, can be attached. The frame at a true BOOST packet is
+// sampled, if there is one, and the following boost_duration_us are sampled
+// every min_period_us.
+//
+// The optional SAMPLING_RATE output reports, at each sampled frame, the
+// sampling rate in frames per second the thinner is running at, and the
+// average rate of the whole video is logged on close.
+//
+// A BOOST stream that is computed from the thinned frames, such as the
+// speaker changes, must be a back edge in its own sync set, so that the
+// thinner does not wait for it. Boosts from a back edge only affect the
+// frames after them, and depend on how fast the detectors run.
+//
+// Example:
+//  node {
+//    calculator: "AdaptiveThinnerCalculator"
+//    input_stream: "VIDEO:0:video_frames_scaled"
+//    input_stream: "MOTION_VIDEO:video_frames_shot"
+//    input_stream: "BOOST:0:shot_change"
+//    input_stream: "BOOST:1:speaker_change"
+//    input_stream_info: { tag_index: "BOOST:1" back_edge: true }
+//    input_stream_handler {
+//      input_stream_handler: "SyncSetInputStreamHandler"
+//      options {
+//        [mediapipe.SyncSetInputStreamHandlerOptions.ext] {
+//          sync_set { tag_index: "VIDEO:0" tag_index: "MOTION_VIDEO"
+//                     tag_index: "BOOST:0" }
+//          sync_set { tag_index: "BOOST:1" }
+//        }
+//      }
+//    }
+//    output_stream: "VIDEO:0:video_frames_scaled_downsampled"
+//    output_stream: "SAMPLING_RATE:sampling_rate"
+//  }
+class AdaptiveThinnerCalculator : public CalculatorBase {
+ public:
+  AdaptiveThinnerCalculator() {}
+  AdaptiveThinnerCalculator(const AdaptiveThinnerCalculator&) = delete;
+  AdaptiveThinnerCalculator& operator=(const AdaptiveThinnerCalculator&) =
+      delete;
+
+  static ::mediapipe::Status GetContract(mediapipe::CalculatorContract* cc);
+  ::mediapipe::Status Open(mediapipe::CalculatorContext* cc) override;
+  ::mediapipe::Status Process(mediapipe::CalculatorContext* cc) override;
+  ::mediapipe::Status Close(mediapipe::CalculatorContext* cc) override;
+
+ private:
+  // Updates the smoothed difference with the motion frame of this timestamp.
+  void UpdateDifference(const Packet& motion_packet);
+  // Returns the sampling period at |timestamp|, in microseconds.
+  int64 SamplingPeriod(int64 timestamp) const;
+
+  // Calculator options.
+  AdaptiveThinnerCalculatorOptions options_;
+  // Previous motion frame, held rather than copied.
+  Packet previous_motion_;
+  // Exponential moving average of the frame difference.
+  float difference_ = 0;
+  // End of the dense sampling after the last BOOST event.
+  int64 boost_end_us_ = 0;
+  // Timestamp of the last sampled frame.
+  int64 last_sample_us_ = 0;
+  // First and last frame, and number of frames, seen and sampled.
+  int64 first_frame_us_ = 0;
+  int64 last_frame_us_ = 0;
+  int num_frames_ = 0;
+  int num_samples_ = 0;
+};
+
+REGISTER_CALCULATOR(AdaptiveThinnerCalculator);
+
+::mediapipe::Status AdaptiveThinnerCalculator::GetContract(
+    mediapipe::CalculatorContract* cc) {
+  RET_CHECK_GT(cc->Inputs().NumEntries(kVideo), 0)
+      << "At least one VIDEO stream is required.";
+  RET_CHECK_EQ(cc->Inputs().NumEntries(kVideo),
+               cc->Outputs().NumEntries(kVideo))
+      << "Each VIDEO input needs a VIDEO output.";
+  // The motion is measured on VIDEO:0 if there is no MOTION_VIDEO.
+  const bool has_motion_video = cc->Inputs().HasTag(kInputMotionVideo);
+  if (has_motion_video) {
+    cc->Inputs().Tag(kInputMotionVideo).Set<ImageFrame>();
+  }
+  for (int i = 0; i < cc->Inputs().NumEntries(kVideo); ++i) {
+    if (i == 0 && !has_motion_video) {
+      cc->Inputs().Get(kVideo, i).Set<ImageFrame>();
+    } else {
+      cc->Inputs().Get(kVideo, i).SetAny();
+    }
+    cc->Outputs().Get(kVideo, i).SetSameAs(&cc->Inputs().Get(kVideo, i));
+  }
+  for (int i = 0; i < cc->Inputs().NumEntries(kInputBoost); ++i) {
+    cc->Inputs().Get(kInputBoost, i).Set<bool>();
+  }
+  if (cc->Outputs().HasTag(kOutputSamplingRate)) {
+    cc->Outputs().Tag(kOutputSamplingRate).Set<double>();
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status AdaptiveThinnerCalculator::Open(
+    mediapipe::CalculatorContext* cc) {
+  options_ = cc->Options<AdaptiveThinnerCalculatorOptions>();
+  RET_CHECK_GT(options_.min_period_us(), 0)
+      << "min_period_us must be positive.";
+  RET_CHECK_GE(options_.max_period_us(), options_.min_period_us())
+      << "max_period_us must not be below min_period_us.";
+  RET_CHECK_GT(options_.motion_difference(), options_.static_difference())
+      << "motion_difference must be above static_difference.";
+  RET_CHECK(options_.difference_smoothing() >= 0 &&
+            options_.difference_smoothing() < 1)
+      << "difference_smoothing must be in [0, 1).";
+  RET_CHECK_GE(options_.boost_duration_us(), 0)
+      << "boost_duration_us must not be negative.";
+  // Outputs only skip timestamps, so downstream calculators do not have to
+  // wait for the next sampled frame.
+  cc->SetOffset(TimestampDiff(0));
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status AdaptiveThinnerCalculator::Process(
+    mediapipe::CalculatorContext* cc) {
+  const int64 timestamp = cc->InputTimestamp().Value();
+  bool boost_now = false;
+  for (int i = 0; i < cc->Inputs().NumEntries(kInputBoost); ++i) {
+    const auto& packet = cc->Inputs().Get(kInputBoost, i).Value();
+    if (!packet.IsEmpty() && packet.Get<bool>()) {
+      boost_now = true;
+      boost_end_us_ = std::max(boost_end_us_,
+                               timestamp + options_.boost_duration_us());
+    }
+  }
+
+  // BOOST packets from back edges arrive without a frame.
+  const auto& frame_packet = cc->Inputs().Get(kVideo, 0).Value();
+  if (frame_packet.IsEmpty()) {
+    return ::mediapipe::OkStatus();
+  }
+  UpdateDifference(cc->Inputs().HasTag(kInputMotionVideo)
+                       ? cc->Inputs().Tag(kInputMotionVideo).Value()
+                       : frame_packet);
+  if (num_frames_ == 0) {
+    first_frame_us_ = timestamp;
+  }
+  last_frame_us_ = timestamp;
+  num_frames_++;
+
+  const int64 period = SamplingPeriod(timestamp);
+  if (num_samples_ > 0 && !boost_now &&
+      timestamp - last_sample_us_ < period) {
+    return ::mediapipe::OkStatus();
+  }
+  last_sample_us_ = timestamp;
+  num_samples_++;
+  for (int i = 0; i < cc->Inputs().NumEntries(kVideo); ++i) {
+    const auto& packet = cc->Inputs().Get(kVideo, i).Value();
+    if (!packet.IsEmpty()) {
+      cc->Outputs().Get(kVideo, i).AddPacket(packet);
+    }
+  }
+  if (cc->Outputs().HasTag(kOutputSamplingRate)) {
+    cc->Outputs().Tag(kOutputSamplingRate).Add(
+        new double(1000000.0 / period), cc->InputTimestamp());
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status AdaptiveThinnerCalculator::Close(
+    mediapipe::CalculatorContext* cc) {
+  if (num_frames_ > 1) {
+    const double seconds = (last_frame_us_ - first_frame_us_) / 1000000.0;
+    LOG(INFO) << "Sampled " << num_samples_ << " of " << num_frames_
+              << " frames, " << num_samples_ / seconds
+              << " frames per second on average.";
+  }
+  return ::mediapipe::OkStatus();
+}
+
+void AdaptiveThinnerCalculator::UpdateDifference(const Packet& motion_packet) {
+  if (motion_packet.IsEmpty()) {
+    return;
+  }
+  float difference = 0;
+  if (!previous_motion_.IsEmpty()) {
+    const cv::Mat previous =
+        formats::MatView(&previous_motion_.Get<ImageFrame>());
+    const cv::Mat current = formats::MatView(&motion_packet.Get<ImageFrame>());
+    if (previous.size() == current.size() &&
+        previous.type() == current.type()) {
+      cv::Mat diff;
+      cv::absdiff(previous, current, diff);
+      const cv::Scalar mean = cv::mean(diff);
+      for (int c = 0; c < diff.channels(); ++c) {
+        difference += mean[c];
+      }
+      difference /= diff.channels();
+    } else {
+      // A new geometry is a new video.
+      difference = options_.motion_difference();
+    }
+  }
+  difference_ = options_.difference_smoothing() * difference_ +
+                (1 - options_.difference_smoothing()) * difference;
+  previous_motion_ = motion_packet;
+}
+
+int64 AdaptiveThinnerCalculator::SamplingPeriod(int64 timestamp) const {
+  if (timestamp < boost_end_us_) {
+    return options_.min_period_us();
+  }
+  // The rate, rather than the period, is interpolated, so that moderate
+  // motion already gets a good share of the dense sampling.
+  const float activity = std::min(
+      1.0f, std::max(0.0f, (difference_ - options_.static_difference()) /
+                               (options_.motion_difference() -
+                                options_.static_difference())));
+  const double min_rate = 1000000.0 / options_.max_period_us();
+  const double max_rate = 1000000.0 / options_.min_period_us();
+  return static_cast<int64>(1000000.0 /
+                            (min_rate + activity * (max_rate - min_rate)));
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,247 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/adaptive_thinner_calculator.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/shot_boundary_decoder_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+using ::testing::ElementsAre;
+
+constexpr char kVideo[] = "VIDEO";
+constexpr char kInputMotionVideo[] = "MOTION_VIDEO";
+constexpr char kInputBoost[] = "BOOST";
+constexpr char kOutputSamplingRate[] = "SAMPLING_RATE";
+
+// 30 frames per second.
+const int64 kFramePeriodUs = 33333;
+const int kNumFrames = 90;
+
+constexpr char kConfig[] = R"(
+    calculator: "AdaptiveThinnerCalculator"
+    input_stream: "VIDEO:0:video"
+    output_stream: "VIDEO:0:video_thinned"
+    output_stream: "SAMPLING_RATE:sampling_rate")";
+
+Packet MakeFrame(int value, int frame) {
+  auto image = ::absl::make_unique<ImageFrame>(ImageFormat::SRGB, 48, 27);
+  formats::MatView(image.get()).setTo(cv::Scalar(value, value, value));
+  return Adopt(image.release()).At(Timestamp(frame * kFramePeriodUs));
+}
+
+// Adds frames to |tag|:0 that are all black if |moving| is false, and
+// alternate between black and white otherwise.
+void AddFrames(bool moving, const std::string& tag, CalculatorRunner* runner) {
+  for (int i = 0; i < kNumFrames; ++i) {
+    const int value = moving && i % 2 == 1 ? 255 : 0;
+    runner->MutableInputs()->Get(tag, 0).packets.push_back(
+        MakeFrame(value, i));
+  }
+}
+
+// Returns the frame indices of the packets of VIDEO:|index|.
+std::vector<int> SampledFrames(const CalculatorRunner& runner, int index) {
+  std::vector<int> frames;
+  for (const auto& packet : runner.Outputs().Get(kVideo, index).packets) {
+    frames.push_back(packet.Timestamp().Value() / kFramePeriodUs);
+  }
+  return frames;
+}
+
+TEST(AdaptiveThinnerCalculatorTest, SamplesStaticVideoSparsely) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  AddFrames(/*moving=*/false, kVideo, runner.get());
+  MP_ASSERT_OK(runner->Run());
+
+  // One frame per max_period_us.
+  EXPECT_THAT(SampledFrames(*runner, 0), ElementsAre(0, 31, 62));
+  for (const auto& packet :
+       runner->Outputs().Tag(kOutputSamplingRate).packets) {
+    EXPECT_DOUBLE_EQ(1.0, packet.Get<double>());
+  }
+}
+
+TEST(AdaptiveThinnerCalculatorTest, SamplesMovingVideoDensely) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  AddFrames(/*moving=*/true, kVideo, runner.get());
+  MP_ASSERT_OK(runner->Run());
+
+  // Every other frame, one per min_period_us.
+  const auto frames = SampledFrames(*runner, 0);
+  ASSERT_EQ(kNumFrames / 2, frames.size());
+  for (int i = 0; i < frames.size(); ++i) {
+    EXPECT_EQ(2 * i, frames[i]);
+  }
+  const auto& rates = runner->Outputs().Tag(kOutputSamplingRate).packets;
+  ASSERT_EQ(frames.size(), rates.size());
+  EXPECT_NEAR(15.0, rates.back().Get<double>(), 0.01);
+}
+
+TEST(AdaptiveThinnerCalculatorTest, SamplesDenselyAfterBoost) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(R"(
+        calculator: "AdaptiveThinnerCalculator"
+        input_stream: "VIDEO:0:video"
+        input_stream: "BOOST:0:shot_change"
+        output_stream: "VIDEO:0:video_thinned"
+        options: {
+          [mediapipe.autoflip.AdaptiveThinnerCalculatorOptions.ext]: {
+            boost_duration_us: 200000
+          }
+        })"));
+  AddFrames(/*moving=*/false, kVideo, runner.get());
+  for (int i = 0; i < kNumFrames; ++i) {
+    runner->MutableInputs()->Get(kInputBoost, 0).packets.push_back(
+        MakePacket<bool>(i == 41).At(Timestamp(i * kFramePeriodUs)));
+  }
+  MP_ASSERT_OK(runner->Run());
+
+  // The boost frame is sampled out of turn, the following 200 ms every
+  // other frame, and then the period is back to one second.
+  EXPECT_THAT(SampledFrames(*runner, 0),
+              ElementsAre(0, 31, 41, 43, 45, 47, 78));
+}
+
+TEST(AdaptiveThinnerCalculatorTest, DoesNotHoldBackFramesOnSparseBoost) {
+  // The shot changes are decoded with output_only_on_change, so the BOOST
+  // stream only carries timestamp bounds while there is no cut.
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(
+      ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+        input_stream: "video"
+        input_stream: "prediction_vector"
+        input_stream: "time_stamp"
+        node {
+          calculator: "ShotBoundaryDecoderCalculator"
+          input_stream: "PREDICTION:prediction_vector"
+          input_stream: "TIME:time_stamp"
+          output_stream: "IS_SHOT_CHANGE:shot_change"
+          options: {
+            [mediapipe.autoflip.ShotBoundaryDecoderCalculatorOptions.ext]: {
+              output_only_on_change: true
+            }
+          }
+        }
+        node {
+          calculator: "AdaptiveThinnerCalculator"
+          input_stream: "VIDEO:0:video"
+          input_stream: "BOOST:0:shot_change"
+          output_stream: "VIDEO:0:video_thinned"
+        })")));
+  std::vector<Packet> thinned;
+  MP_ASSERT_OK(graph.ObserveOutputStream(
+      "video_thinned", [&thinned](const Packet& packet) {
+        thinned.push_back(packet);
+        return ::mediapipe::OkStatus();
+      }));
+  MP_ASSERT_OK(graph.StartRun({}));
+
+  // One decoder window: 25 frames of padding on each side of 50 frames.
+  const int kWindowFrames = 50;
+  auto predictions = ::absl::make_unique<std::vector<float>>(100, -5.0f);
+  auto times = ::absl::make_unique<std::vector<Timestamp>>();
+  for (int i = 0; i < 100; ++i) {
+    const int frame = std::min(std::max(i - 25, 0), kWindowFrames);
+    times->push_back(frame == kWindowFrames
+                         ? Timestamp::Done()
+                         : Timestamp(frame * kFramePeriodUs));
+  }
+  for (int i = 0; i < kWindowFrames; ++i) {
+    MP_ASSERT_OK(graph.AddPacketToInputStream("video", MakeFrame(0, i)));
+  }
+  MP_ASSERT_OK(graph.AddPacketToInputStream(
+      "prediction_vector", Adopt(predictions.release()).At(Timestamp(0))));
+  MP_ASSERT_OK(graph.AddPacketToInputStream(
+      "time_stamp", Adopt(times.release()).At(Timestamp(0))));
+  MP_ASSERT_OK(graph.WaitUntilIdle());
+
+  // The frames are sampled before the video ends, without any shot change.
+  std::vector<int> frames;
+  for (const auto& packet : thinned) {
+    frames.push_back(packet.Timestamp().Value() / kFramePeriodUs);
+  }
+  EXPECT_THAT(frames, ElementsAre(0, 31));
+
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+}
+
+TEST(AdaptiveThinnerCalculatorTest, MeasuresMotionOnMotionVideo) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(R"(
+        calculator: "AdaptiveThinnerCalculator"
+        input_stream: "VIDEO:0:video"
+        input_stream: "VIDEO:1:video_small"
+        input_stream: "MOTION_VIDEO:video_motion"
+        output_stream: "VIDEO:0:video_thinned"
+        output_stream: "VIDEO:1:video_small_thinned"
+      )"));
+  for (int i = 0; i < kNumFrames; ++i) {
+    const Timestamp timestamp(i * kFramePeriodUs);
+    runner->MutableInputs()->Get(kVideo, 0).packets.push_back(
+        MakePacket<int>(i).At(timestamp));
+    runner->MutableInputs()->Get(kVideo, 1).packets.push_back(
+        MakePacket<int>(-i).At(timestamp));
+  }
+  AddFrames(/*moving=*/true, kInputMotionVideo, runner.get());
+  MP_ASSERT_OK(runner->Run());
+
+  const auto frames = SampledFrames(*runner, 0);
+  EXPECT_EQ(kNumFrames / 2, frames.size());
+  // Both streams are sampled at the same timestamps.
+  EXPECT_EQ(frames, SampledFrames(*runner, 1));
+  for (const auto& packet : runner->Outputs().Get(kVideo, 1).packets) {
+    EXPECT_EQ(-packet.Timestamp().Value() / kFramePeriodUs,
+              packet.Get<int>());
+  }
+}
+
+TEST(AdaptiveThinnerCalculatorTest, RejectsInvalidPeriods) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(R"(
+        calculator: "AdaptiveThinnerCalculator"
+        input_stream: "VIDEO:0:video"
+        output_stream: "VIDEO:0:video_thinned"
+        options: {
+          [mediapipe.autoflip.AdaptiveThinnerCalculatorOptions.ext]: {
+            min_period_us: 500000
+            max_period_us: 100000
+          }
+        })"));
+  AddFrames(/*moving=*/false, kVideo, runner.get());
+  EXPECT_FALSE(runner->Run().ok());
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,230 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/benchmark_report.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/tool/name_util.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+std::string StreamName(const std::string& spec) {
+  return spec.substr(spec.rfind(':') + 1);
+}
+
+int64 NumSamples(const TimeHistogram& histogram) {
+  int64 samples = 0;
+  for (const int64 count : histogram.count()) {
+    samples += count;
+  }
+  return samples;
+}
+
+// Mean and standard deviation of |values|.
+void MeanAndStddev(const std::vector<double>& values, double* mean,
+                   double* stddev) {
+  *mean = 0;
+  *stddev = 0;
+  if (values.empty()) {
+    return;
+  }
+  for (const double value : values) {
+    *mean += value;
+  }
+  *mean /= values.size();
+  for (const double value : values) {
+    *stddev += (value - *mean) * (value - *mean);
+  }
+  *stddev = std::sqrt(*stddev / values.size());
+}
+
+}  // namespace
+
+double HistogramPercentile(const TimeHistogram& histogram, double fraction) {
+  const double target = fraction * NumSamples(histogram);
+  const double interval = histogram.interval_size_usec();
+  double below = 0;
+  for (int i = 0; i < histogram.count_size(); ++i) {
+    const int64 count = histogram.count(i);
+    if (count > 0 && below + count >= target) {
+      if (i + 1 == histogram.count_size()) {
+        return i * interval;
+      }
+      return (i + (target - below) / count) * interval;
+    }
+    below += count;
+  }
+  return 0;
+}
+
+::mediapipe::Status SummarizeProfiles(
+    const CalculatorGraphConfig& config,
+    const std::vector<CalculatorProfile>& profiles, BenchmarkRun* run) {
+  std::map<std::string, const CalculatorProfile*> profile_of_node;
+  // A stream sends as many packets as its consumers receive.
+  std::map<std::string, int64> stream_packets;
+  for (const auto& profile : profiles) {
+    profile_of_node[profile.name()] = &profile;
+    for (const auto& input : profile.input_stream_profiles()) {
+      stream_packets[input.name()] = NumSamples(input.latency());
+    }
+  }
+
+  run->clear_node();
+  for (int i = 0; i < config.node_size(); ++i) {
+    const auto& node_config = config.node(i);
+    const auto found = profile_of_node.find(tool::CanonicalNodeName(config, i));
+    if (found == profile_of_node.end()) {
+      continue;
+    }
+    const CalculatorProfile& profile = *found->second;
+    RET_CHECK(profile.process_runtime().num_intervals() == 0 ||
+              profile.process_runtime().interval_size_usec() > 0)
+        << "Invalid profile histogram of " << profile.name();
+    auto* node = run->add_node();
+    node->set_name(profile.name());
+    node->set_calculator(node_config.calculator());
+    node->set_process_calls(NumSamples(profile.process_runtime()));
+    node->set_process_time_us(profile.process_runtime().total());
+    node->set_process_p50_us(
+        HistogramPercentile(profile.process_runtime(), 0.5));
+    node->set_process_p90_us(
+        HistogramPercentile(profile.process_runtime(), 0.9));
+    node->set_process_p99_us(
+        HistogramPercentile(profile.process_runtime(), 0.99));
+
+    int64 input_packets = 0;
+    int64 wait_us = 0;
+    for (const auto& input : profile.input_stream_profiles()) {
+      input_packets += NumSamples(input.latency());
+      wait_us += input.latency().total();
+    }
+    node->set_input_packets(input_packets);
+    node->set_queue_wait_mean_us(
+        input_packets > 0 ? static_cast<double>(wait_us) / input_packets : 0);
+
+    int64 output_packets = 0;
+    for (const auto& output : node_config.output_stream()) {
+      const auto packets = stream_packets.find(StreamName(output));
+      if (packets != stream_packets.end()) {
+        output_packets += packets->second;
+      }
+    }
+    node->set_output_packets(output_packets);
+  }
+  return ::mediapipe::OkStatus();
+}
+
+void SummarizeRuns(BenchmarkReport* report) {
+  std::vector<double> fps;
+  for (const auto& run : report->run()) {
+    fps.push_back(run.frames_per_second());
+  }
+  double mean, stddev;
+  MeanAndStddev(fps, &mean, &stddev);
+  report->set_frames_per_second_mean(mean);
+  report->set_frames_per_second_stddev(stddev);
+}
+
+std::string FormatBenchmarkTable(const BenchmarkReport& report) {
+  if (report.run_size() == 0) {
+    return "No runs.\n";
+  }
+  // Nodes are matched across runs by name; the first run sets the nodes.
+  struct Row {
+    const NodeBenchmark* first;
+    std::vector<double> time_ms;
+    std::vector<double> p50_ms, p90_ms, p99_ms, wait_ms;
+  };
+  std::vector<Row> rows;
+  std::map<std::string, int> row_of_node;
+  for (const auto& node : report.run(0).node()) {
+    row_of_node[node.name()] = rows.size();
+    rows.push_back({&node});
+  }
+  for (const auto& run : report.run()) {
+    for (const auto& node : run.node()) {
+      const auto found = row_of_node.find(node.name());
+      if (found == row_of_node.end()) {
+        continue;
+      }
+      Row& row = rows[found->second];
+      row.time_ms.push_back(node.process_time_us() / 1000.0);
+      row.p50_ms.push_back(node.process_p50_us() / 1000.0);
+      row.p90_ms.push_back(node.process_p90_us() / 1000.0);
+      row.p99_ms.push_back(node.process_p99_us() / 1000.0);
+      row.wait_ms.push_back(node.queue_wait_mean_us() / 1000.0);
+    }
+  }
+  std::vector<double> total_ms(rows.size()), stddev_ms(rows.size());
+  for (int i = 0; i < rows.size(); ++i) {
+    MeanAndStddev(rows[i].time_ms, &total_ms[i], &stddev_ms[i]);
+  }
+  std::vector<int> order(rows.size());
+  for (int i = 0; i < order.size(); ++i) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [&total_ms](int a, int b) {
+    return total_ms[a] > total_ms[b];
+  });
+  double all_ms = 0;
+  for (const double ms : total_ms) {
+    all_ms += ms;
+  }
+
+  std::string table = absl::StrFormat(
+      "%-48s %8s %10s %8s %6s %8s %8s %8s %8s %9s %9s\n", "node", "calls",
+      "total ms", "+-", "%", "p50 ms", "p90 ms", "p99 ms", "wait ms",
+      "in pkts", "out pkts");
+  for (const int i : order) {
+    const Row& row = rows[i];
+    double p50, p90, p99, wait, unused;
+    MeanAndStddev(row.p50_ms, &p50, &unused);
+    MeanAndStddev(row.p90_ms, &p90, &unused);
+    MeanAndStddev(row.p99_ms, &p99, &unused);
+    MeanAndStddev(row.wait_ms, &wait, &unused);
+    absl::StrAppend(
+        &table,
+        absl::StrFormat(
+            "%-48s %8d %10.1f %8.1f %6.1f %8.2f %8.2f %8.2f %8.2f %9d %9d\n",
+            row.first->name().substr(0, 48), row.first->process_calls(),
+            total_ms[i], stddev_ms[i],
+            all_ms > 0 ? 100 * total_ms[i] / all_ms : 0.0, p50, p90, p99,
+            wait, row.first->input_packets(), row.first->output_packets()));
+  }
+  int64 peak_rss_kb = 0;
+  for (const auto& run : report.run()) {
+    peak_rss_kb = std::max(peak_rss_kb, run.peak_rss_kb());
+  }
+  absl::StrAppend(
+      &table,
+      absl::StrFormat("%d run(s) of %d frames: %.1f +- %.1f fps, peak RSS "
+                      "%.1f MB\n",
+                      report.run_size(), report.run(0).frames(),
+                      report.frames_per_second_mean(),
+                      report.frames_per_second_stddev(), peak_rss_kb / 1024.0));
+  return table;
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
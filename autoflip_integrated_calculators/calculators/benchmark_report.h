@@ -0,0 +1,55 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_BENCHMARK_REPORT_H_
+#define MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_BENCHMARK_REPORT_H_
+
+#include <string>
+#include <vector>
+
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/framework/calculator.pb.h"
+#include "mediapipe/framework/calculator_profile.pb.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// Turns the calculator profiles of the MediaPipe profiler into the
+// BenchmarkReport that autoflip_benchmark prints and exports as JSON.
+
+// Returns the time below which |fraction| of the samples of |histogram|
+// fall, interpolated linearly within the interval. The last interval of a
+// profiler histogram also holds every longer sample, so percentiles that
+// fall into it return its lower bound.
+double HistogramPercentile(const TimeHistogram& histogram, double fraction);
+
+// Fills the nodes of |run| from |profiles|, in the order of the nodes of
+// |config|, which must be the expanded config of the profiled graph, i.e.
+// CalculatorGraph::Config(). Nodes without a profile are skipped.
+::mediapipe::Status SummarizeProfiles(
+    const CalculatorGraphConfig& config,
+    const std::vector<CalculatorProfile>& profiles, BenchmarkRun* run);
+
+// Sets the summary fields of |report| from its runs.
+void SummarizeRuns(BenchmarkReport* report);
+
+// Returns a table of the nodes of |report|, slowest first, with the mean
+// and, over several runs, the standard deviation of the Process time.
+std::string FormatBenchmarkTable(const BenchmarkReport& report);
+
+}  // namespace autoflip
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_BENCHMARK_REPORT_H_
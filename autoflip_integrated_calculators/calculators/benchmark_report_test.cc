@@ -0,0 +1,150 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/benchmark_report.h"
+
+#include "absl/strings/match.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kGraph[] = R"(
+    node {
+      calculator: "OpenCvVideoDecoderCalculator"
+      output_stream: "VIDEO:video_raw"
+    }
+    node {
+      calculator: "BorderDetectionCalculator"
+      input_stream: "VIDEO:video_raw"
+      output_stream: "DETECTED_BORDERS:borders"
+    }
+    node {
+      name: "cropper"
+      calculator: "SceneCroppingCalculator"
+      input_stream: "VIDEO_FRAMES:video_raw"
+      input_stream: "STATIC_FEATURES:borders"
+      output_stream: "CROPPED_FRAMES:cropped_frames"
+    })";
+
+// Ten 1 ms intervals, the last one open ended.
+TimeHistogram Histogram(const std::vector<int64>& counts, int64 total) {
+  TimeHistogram histogram;
+  histogram.set_interval_size_usec(1000);
+  histogram.set_num_intervals(counts.size());
+  histogram.set_total(total);
+  for (const int64 count : counts) {
+    histogram.add_count(count);
+  }
+  return histogram;
+}
+
+CalculatorProfile Profile(const std::string& name, int64 calls,
+                          int64 time_us) {
+  CalculatorProfile profile;
+  profile.set_name(name);
+  *profile.mutable_process_runtime() =
+      Histogram({0, calls, 0, 0, 0, 0, 0, 0, 0, 0}, time_us);
+  return profile;
+}
+
+void AddInput(const std::string& stream, int64 packets, int64 wait_us,
+              CalculatorProfile* profile) {
+  auto* input = profile->add_input_stream_profiles();
+  input->set_name(stream);
+  *input->mutable_latency() =
+      Histogram({packets, 0, 0, 0, 0, 0, 0, 0, 0, 0}, wait_us);
+}
+
+TEST(BenchmarkReportTest, HistogramPercentile) {
+  const TimeHistogram histogram =
+      Histogram({0, 50, 40, 0, 0, 0, 0, 0, 0, 10}, 0);
+  EXPECT_DOUBLE_EQ(2000, HistogramPercentile(histogram, 0.5));
+  EXPECT_DOUBLE_EQ(1500, HistogramPercentile(histogram, 0.25));
+  EXPECT_DOUBLE_EQ(3000, HistogramPercentile(histogram, 0.9));
+  // The last interval only has a lower bound.
+  EXPECT_DOUBLE_EQ(9000, HistogramPercentile(histogram, 0.99));
+  EXPECT_DOUBLE_EQ(0, HistogramPercentile(TimeHistogram(), 0.5));
+}
+
+TEST(BenchmarkReportTest, SummarizeProfiles) {
+  const auto config = ParseTextProtoOrDie<CalculatorGraphConfig>(kGraph);
+  std::vector<CalculatorProfile> profiles;
+  profiles.push_back(Profile("OpenCvVideoDecoderCalculator", 101, 50000));
+  profiles.push_back(Profile("BorderDetectionCalculator", 100, 150000));
+  AddInput("video_raw", 100, 2000, &profiles.back());
+  profiles.push_back(Profile("cropper", 100, 120000));
+  AddInput("video_raw", 100, 30000, &profiles.back());
+  AddInput("borders", 100, 10000, &profiles.back());
+
+  BenchmarkRun run;
+  MP_ASSERT_OK(SummarizeProfiles(config, profiles, &run));
+  ASSERT_EQ(3, run.node_size());
+  const auto& decoder = run.node(0);
+  EXPECT_EQ("OpenCvVideoDecoderCalculator", decoder.name());
+  EXPECT_EQ(101, decoder.process_calls());
+  EXPECT_EQ(0, decoder.input_packets());
+  EXPECT_EQ(100, decoder.output_packets());
+
+  const auto& borders = run.node(1);
+  EXPECT_EQ(150000, borders.process_time_us());
+  EXPECT_DOUBLE_EQ(1500, borders.process_p50_us());
+  EXPECT_DOUBLE_EQ(20, borders.queue_wait_mean_us());
+  EXPECT_EQ(100, borders.output_packets());
+
+  const auto& cropper = run.node(2);
+  EXPECT_EQ("cropper", cropper.name());
+  EXPECT_EQ("SceneCroppingCalculator", cropper.calculator());
+  EXPECT_EQ(200, cropper.input_packets());
+  EXPECT_DOUBLE_EQ(200, cropper.queue_wait_mean_us());
+  // Nobody consumes the cropped frames.
+  EXPECT_EQ(0, cropper.output_packets());
+}
+
+TEST(BenchmarkReportTest, FormatsRuns) {
+  const auto config = ParseTextProtoOrDie<CalculatorGraphConfig>(kGraph);
+  std::vector<CalculatorProfile> profiles;
+  profiles.push_back(Profile("BorderDetectionCalculator", 100, 150000));
+  profiles.push_back(Profile("cropper", 100, 120000));
+
+  BenchmarkReport report;
+  for (const double fps : {40.0, 60.0}) {
+    auto* run = report.add_run();
+    MP_ASSERT_OK(SummarizeProfiles(config, profiles, run));
+    run->set_frames(100);
+    run->set_frames_per_second(fps);
+    run->set_peak_rss_kb(2048);
+  }
+  SummarizeRuns(&report);
+  EXPECT_DOUBLE_EQ(50, report.frames_per_second_mean());
+  EXPECT_DOUBLE_EQ(10, report.frames_per_second_stddev());
+
+  const std::string table = FormatBenchmarkTable(report);
+  // Slowest node first.
+  const size_t borders = table.find("BorderDetectionCalculator");
+  const size_t cropper = table.find("cropper");
+  ASSERT_NE(std::string::npos, borders);
+  ASSERT_NE(std::string::npos, cropper);
+  EXPECT_LT(borders, cropper);
+  EXPECT_TRUE(absl::StrContains(table, "50.0 +- 10.0 fps"));
+  EXPECT_TRUE(absl::StrContains(table, "peak RSS 2.0 MB"));
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,131 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/chunk_range_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+constexpr char kStartUs[] = "START_US";
+constexpr char kEndUs[] = "END_US";
+
+// This calculator passes through the packets whose timestamps fall in
+// [start_us, end_us) and drops all others. It is put right after the video
+// decoder of a chunk graph, so that one graph instance only analyzes one
+// chunk of the video (plus its overlap margins, see chunked_analysis_main.cc).
+// Packets keep their timestamps, so the signals of every chunk are in the
+// time base of the whole video.
+//
+// Any number of streams of any type can be gated; input i is passed through
+// to output i. Once a packet at or after end_us arrives, all outputs are
+// closed, so that downstream calculators flush and close without waiting for
+// the rest of the video. Header streams (e.g. VIDEO_PRESTREAM) should bypass
+// this calculator, since their packets are before any start_us.
+//
+// The range is taken from the options, and is overridden by the optional
+// START_US and END_US int64 input side packets.
+//
+// Example:
+//  node {
+//    calculator: "ChunkRangeCalculator"
+//    input_side_packet: "START_US:chunk_start_us"
+//    input_side_packet: "END_US:chunk_end_us"
+//    input_stream: "video_raw"
+//    output_stream: "video_chunk"
+//  }
+class ChunkRangeCalculator : public CalculatorBase {
+ public:
+  ChunkRangeCalculator() {}
+  ChunkRangeCalculator(const ChunkRangeCalculator&) = delete;
+  ChunkRangeCalculator& operator=(const ChunkRangeCalculator&) = delete;
+
+  static ::mediapipe::Status GetContract(mediapipe::CalculatorContract* cc);
+  ::mediapipe::Status Open(mediapipe::CalculatorContext* cc) override;
+  ::mediapipe::Status Process(mediapipe::CalculatorContext* cc) override;
+
+ private:
+  Timestamp start_;
+  Timestamp end_;
+  bool done_ = false;
+};
+REGISTER_CALCULATOR(ChunkRangeCalculator);
+
+::mediapipe::Status ChunkRangeCalculator::GetContract(
+    mediapipe::CalculatorContract* cc) {
+  RET_CHECK_EQ(cc->Inputs().NumEntries(), cc->Outputs().NumEntries())
+      << "Every gated input needs one output.";
+  for (int i = 0; i < cc->Inputs().NumEntries(); ++i) {
+    cc->Inputs().Index(i).SetAny();
+    cc->Outputs().Index(i).SetSameAs(&cc->Inputs().Index(i));
+  }
+  if (cc->InputSidePackets().HasTag(kStartUs)) {
+    cc->InputSidePackets().Tag(kStartUs).Set<int64>();
+  }
+  if (cc->InputSidePackets().HasTag(kEndUs)) {
+    cc->InputSidePackets().Tag(kEndUs).Set<int64>();
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status ChunkRangeCalculator::Open(
+    mediapipe::CalculatorContext* cc) {
+  const auto& options = cc->Options<ChunkRangeCalculatorOptions>();
+  int64 start_us = options.start_us();
+  int64 end_us = options.end_us();
+  if (cc->InputSidePackets().HasTag(kStartUs)) {
+    start_us = cc->InputSidePackets().Tag(kStartUs).Get<int64>();
+  }
+  if (cc->InputSidePackets().HasTag(kEndUs)) {
+    end_us = cc->InputSidePackets().Tag(kEndUs).Get<int64>();
+  }
+  RET_CHECK(end_us < 0 || start_us < end_us)
+      << "Empty chunk range [" << start_us << ", " << end_us << ").";
+  start_ = Timestamp(start_us);
+  end_ = end_us < 0 ? Timestamp::Max() : Timestamp(end_us);
+  // Nothing before the range is ever output.
+  for (int i = 0; i < cc->Outputs().NumEntries(); ++i) {
+    cc->Outputs().Index(i).SetNextTimestampBound(start_);
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status ChunkRangeCalculator::Process(
+    mediapipe::CalculatorContext* cc) {
+  if (done_) {
+    return ::mediapipe::OkStatus();
+  }
+  const Timestamp timestamp = cc->InputTimestamp();
+  if (timestamp >= end_) {
+    for (int i = 0; i < cc->Outputs().NumEntries(); ++i) {
+      cc->Outputs().Index(i).Close();
+    }
+    done_ = true;
+    return ::mediapipe::OkStatus();
+  }
+  if (timestamp < start_) {
+    return ::mediapipe::OkStatus();
+  }
+  for (int i = 0; i < cc->Inputs().NumEntries(); ++i) {
+    if (!cc->Inputs().Index(i).IsEmpty()) {
+      cc->Outputs().Index(i).AddPacket(cc->Inputs().Index(i).Value());
+    }
+  }
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,118 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include "mediapipe/examples/desktop/autoflip/calculators/chunk_range_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kStartUs[] = "START_US";
+constexpr char kEndUs[] = "END_US";
+
+constexpr char kConfig[] = R"(
+    calculator: "ChunkRangeCalculator"
+    input_stream: "video_raw"
+    input_stream: "shot_change"
+    output_stream: "video_chunk"
+    output_stream: "shot_change_chunk"
+    options: {
+      [mediapipe.autoflip.ChunkRangeCalculatorOptions.ext]: {
+        start_us: 2000
+        end_us: 5000
+      }
+    })";
+
+constexpr char kSidePacketConfig[] = R"(
+    calculator: "ChunkRangeCalculator"
+    input_side_packet: "START_US:chunk_start_us"
+    input_side_packet: "END_US:chunk_end_us"
+    input_stream: "video_raw"
+    output_stream: "video_chunk")";
+
+void AddPackets(CalculatorRunner* runner, int index, int num_packets) {
+  for (int i = 0; i < num_packets; ++i) {
+    runner->MutableInputs()->Index(index).packets.push_back(
+        MakePacket<int>(i).At(Timestamp(i * 1000)));
+  }
+}
+
+std::vector<int64> Timestamps(const CalculatorRunner& runner, int index) {
+  std::vector<int64> timestamps;
+  for (const auto& packet : runner.Outputs().Index(index).packets) {
+    timestamps.push_back(packet.Timestamp().Value());
+  }
+  return timestamps;
+}
+
+TEST(ChunkRangeCalculatorTest, PassesPacketsInRange) {
+  CalculatorRunner runner(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  AddPackets(&runner, 0, 8);
+  // Only some timestamps carry a second packet.
+  runner.MutableInputs()->Index(1).packets.push_back(
+      MakePacket<bool>(true).At(Timestamp(1000)));
+  runner.MutableInputs()->Index(1).packets.push_back(
+      MakePacket<bool>(true).At(Timestamp(3000)));
+  MP_ASSERT_OK(runner.Run());
+
+  EXPECT_THAT(Timestamps(runner, 0), ::testing::ElementsAre(2000, 3000, 4000));
+  EXPECT_THAT(Timestamps(runner, 1), ::testing::ElementsAre(3000));
+  EXPECT_EQ(2, runner.Outputs().Index(0).packets[0].Get<int>());
+}
+
+TEST(ChunkRangeCalculatorTest, SidePacketsOverrideOptions) {
+  CalculatorRunner runner(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kSidePacketConfig));
+  runner.MutableSidePackets()->Tag(kStartUs) = MakePacket<int64>(0);
+  runner.MutableSidePackets()->Tag(kEndUs) = MakePacket<int64>(2000);
+  AddPackets(&runner, 0, 8);
+  MP_ASSERT_OK(runner.Run());
+
+  EXPECT_THAT(Timestamps(runner, 0), ::testing::ElementsAre(0, 1000));
+}
+
+TEST(ChunkRangeCalculatorTest, NegativeEndIsUnbounded) {
+  CalculatorRunner runner(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kSidePacketConfig));
+  runner.MutableSidePackets()->Tag(kStartUs) = MakePacket<int64>(6000);
+  runner.MutableSidePackets()->Tag(kEndUs) = MakePacket<int64>(-1);
+  AddPackets(&runner, 0, 8);
+  MP_ASSERT_OK(runner.Run());
+
+  EXPECT_THAT(Timestamps(runner, 0), ::testing::ElementsAre(6000, 7000));
+}
+
+TEST(ChunkRangeCalculatorTest, FailsOnEmptyRange) {
+  CalculatorRunner runner(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kSidePacketConfig));
+  runner.MutableSidePackets()->Tag(kStartUs) = MakePacket<int64>(3000);
+  runner.MutableSidePackets()->Tag(kEndUs) = MakePacket<int64>(3000);
+  AddPackets(&runner, 0, 8);
+  EXPECT_FALSE(runner.Run().ok());
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
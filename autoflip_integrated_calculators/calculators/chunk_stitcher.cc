@@ -0,0 +1,127 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/chunk_stitcher.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+#include "mediapipe/framework/port/ret_check.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+std::vector<ChunkRange> SplitIntoChunks(int64 duration_us, int64 chunk_us) {
+  std::vector<ChunkRange> chunks;
+  for (int64 start_us = 0; start_us < duration_us; start_us += chunk_us) {
+    ChunkRange chunk;
+    chunk.start_us = start_us;
+    chunk.end_us = std::min(start_us + chunk_us, duration_us);
+    chunks.push_back(chunk);
+  }
+  if (chunks.size() > 1 &&
+      chunks.back().end_us - chunks.back().start_us < chunk_us / 2) {
+    chunks[chunks.size() - 2].end_us = chunks.back().end_us;
+    chunks.pop_back();
+  }
+  return chunks;
+}
+
+std::vector<int64> ShotBoundaries(const std::vector<TraceRecord>& records) {
+  std::vector<int64> boundaries;
+  for (const auto& record : records) {
+    if (record.shot_change()) {
+      boundaries.push_back(record.timestamp_us());
+    }
+  }
+  return boundaries;
+}
+
+bool ChooseSeamCut(const std::vector<int64>& left_boundaries,
+                   const std::vector<int64>& right_boundaries, int64 seam_us,
+                   int64 overlap_us, int64 tolerance_us, int64* cut_us) {
+  const auto in_overlap = [&](int64 timestamp_us) {
+    return timestamp_us >= seam_us - overlap_us &&
+           timestamp_us < seam_us + overlap_us;
+  };
+  bool found = false;
+  int64 best_distance = std::numeric_limits<int64>::max();
+  *cut_us = seam_us;
+  for (const int64 left : left_boundaries) {
+    if (!in_overlap(left)) {
+      continue;
+    }
+    for (const int64 right : right_boundaries) {
+      if (!in_overlap(right) || std::abs(left - right) > tolerance_us) {
+        continue;
+      }
+      const int64 cut = std::min(left, right);
+      const int64 distance = std::abs(cut - seam_us);
+      if (distance < best_distance) {
+        best_distance = distance;
+        *cut_us = cut;
+        found = true;
+      }
+    }
+  }
+  return found;
+}
+
+::mediapipe::Status StitchTraces(
+    const std::vector<ChunkRange>& chunks,
+    const std::vector<std::vector<TraceRecord>>& traces, int64 overlap_us,
+    int64 tolerance_us, std::vector<TraceRecord>* merged, StitchStats* stats) {
+  RET_CHECK(!chunks.empty());
+  RET_CHECK_EQ(chunks.size(), traces.size());
+  RET_CHECK_GE(overlap_us, 0);
+  for (int i = 1; i < chunks.size(); ++i) {
+    RET_CHECK_EQ(chunks[i - 1].end_us, chunks[i].start_us)
+        << "Chunks " << i - 1 << " and " << i << " are not consecutive.";
+  }
+
+  *stats = StitchStats();
+  // cuts[i] is the first timestamp taken from chunk i.
+  std::vector<int64> cuts = {std::numeric_limits<int64>::min()};
+  std::vector<int64> left_boundaries = ShotBoundaries(traces[0]);
+  for (int i = 1; i < chunks.size(); ++i) {
+    const std::vector<int64> right_boundaries = ShotBoundaries(traces[i]);
+    int64 cut_us;
+    if (ChooseSeamCut(left_boundaries, right_boundaries, chunks[i].start_us,
+                      overlap_us, tolerance_us, &cut_us)) {
+      ++stats->num_reconciled;
+    }
+    RET_CHECK_GT(cut_us, cuts.back())
+        << "Cuts out of order at chunk " << i
+        << "; chunks must be longer than twice the overlap.";
+    cuts.push_back(cut_us);
+    stats->cuts_us.push_back(cut_us);
+    left_boundaries = right_boundaries;
+  }
+  cuts.push_back(std::numeric_limits<int64>::max());
+
+  merged->clear();
+  for (int i = 0; i < chunks.size(); ++i) {
+    for (const auto& record : traces[i]) {
+      if (record.timestamp_us() >= cuts[i] &&
+          record.timestamp_us() < cuts[i + 1]) {
+        merged->push_back(record);
+      }
+    }
+  }
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
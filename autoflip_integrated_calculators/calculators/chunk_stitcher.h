@@ -0,0 +1,85 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_CHUNK_STITCHER_H_
+#define MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_CHUNK_STITCHER_H_
+
+#include <vector>
+
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// Merges the results of a video that was analyzed in chunks by independent
+// graph instances. Each chunk owns a core range [start_us, end_us) and is
+// analyzed over [start_us - overlap_us, end_us + overlap_us), so that the
+// TransNetV2 window and the LipTrack history are warm at the core edges.
+//
+// At the seam between two chunks, the stitcher looks for a shot boundary
+// that both chunks report in the overlap, within a tolerance, and cuts
+// there: records before the cut come from the left chunk and the rest from
+// the right one. LipTrackCalculator resets its history and
+// SceneCroppingCalculator starts a new scene at every shot boundary, so
+// after a shared boundary both chunks continue exactly as a single pass
+// does. Without a shared boundary the seam itself is used as the cut and
+// counted as unreconciled.
+
+// Core range of one chunk, in microseconds.
+struct ChunkRange {
+  int64 start_us = 0;
+  int64 end_us = 0;
+};
+
+// Per-seam outcome of StitchTraces().
+struct StitchStats {
+  // Cut of each seam, in microseconds.
+  std::vector<int64> cuts_us;
+  // Number of seams cut at a shot boundary both chunks agree on.
+  int num_reconciled = 0;
+};
+
+// Splits [0, duration_us) into consecutive chunks of chunk_us. The last
+// chunk takes the remainder, and is merged into the previous one if it is
+// shorter than half a chunk.
+std::vector<ChunkRange> SplitIntoChunks(int64 duration_us, int64 chunk_us);
+
+// Returns the timestamps of the shot boundaries in |records|.
+std::vector<int64> ShotBoundaries(const std::vector<TraceRecord>& records);
+
+// Chooses the cut of the seam at |seam_us| from the shot boundaries the left
+// and right chunks report. Boundaries of both chunks in
+// [seam_us - overlap_us, seam_us + overlap_us) that are at most
+// |tolerance_us| apart are a shared boundary; the one closest to the seam
+// wins and its earlier timestamp is the cut. Returns false and cuts at
+// |seam_us| if there is no shared boundary.
+bool ChooseSeamCut(const std::vector<int64>& left_boundaries,
+                   const std::vector<int64>& right_boundaries, int64 seam_us,
+                   int64 overlap_us, int64 tolerance_us, int64* cut_us);
+
+// Merges the traces of consecutive |chunks| into |merged|. traces[i] holds
+// the records of chunks[i] in timestamp order, overlap included. Every chunk
+// but the first and the last must be longer than twice |overlap_us|, so
+// that the cuts stay in order.
+::mediapipe::Status StitchTraces(
+    const std::vector<ChunkRange>& chunks,
+    const std::vector<std::vector<TraceRecord>>& traces, int64 overlap_us,
+    int64 tolerance_us, std::vector<TraceRecord>* merged, StitchStats* stats);
+
+}  // namespace autoflip
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_CHUNK_STITCHER_H_
@@ -0,0 +1,136 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/chunk_stitcher.h"
+
+#include <vector>
+
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+const int64 kSecond = 1000000;
+
+TraceRecord Shot(int64 timestamp_us) {
+  TraceRecord record;
+  record.set_timestamp_us(timestamp_us);
+  record.set_shot_change(true);
+  return record;
+}
+
+TraceRecord Speaker(int64 timestamp_us, float x) {
+  TraceRecord record;
+  record.set_timestamp_us(timestamp_us);
+  record.add_speaker()->set_x(x);
+  return record;
+}
+
+std::vector<int64> Timestamps(const std::vector<TraceRecord>& records) {
+  std::vector<int64> timestamps;
+  for (const auto& record : records) {
+    timestamps.push_back(record.timestamp_us());
+  }
+  return timestamps;
+}
+
+TEST(ChunkStitcherTest, SplitIntoChunks) {
+  const auto chunks = SplitIntoChunks(25 * kSecond, 10 * kSecond);
+  ASSERT_EQ(3, chunks.size());
+  EXPECT_EQ(10 * kSecond, chunks[1].start_us);
+  EXPECT_EQ(25 * kSecond, chunks[2].end_us);
+
+  // A short remainder is merged into the last chunk.
+  const auto merged = SplitIntoChunks(21 * kSecond, 10 * kSecond);
+  ASSERT_EQ(2, merged.size());
+  EXPECT_EQ(21 * kSecond, merged[1].end_us);
+}
+
+TEST(ChunkStitcherTest, ChoosesSharedBoundaryClosestToSeam) {
+  int64 cut_us;
+  EXPECT_TRUE(ChooseSeamCut({8 * kSecond, 11 * kSecond},
+                            {9 * kSecond, 11 * kSecond + 40000}, 10 * kSecond,
+                            2 * kSecond, 100000, &cut_us));
+  EXPECT_EQ(11 * kSecond, cut_us);
+
+  // The boundaries at 9s and 8s are too far apart, and 13s is outside of the
+  // overlap.
+  EXPECT_FALSE(ChooseSeamCut({8 * kSecond, 13 * kSecond},
+                             {9 * kSecond, 13 * kSecond}, 10 * kSecond,
+                             2 * kSecond, 100000, &cut_us));
+  EXPECT_EQ(10 * kSecond, cut_us);
+}
+
+TEST(ChunkStitcherTest, MatchesSinglePassAtSharedBoundary) {
+  // Single pass: shots at 3s and 11s, the speaker moves after each shot.
+  const std::vector<TraceRecord> single_pass = {
+      Shot(3 * kSecond), Speaker(5 * kSecond, 0.2), Speaker(9 * kSecond, 0.2),
+      Shot(11 * kSecond), Speaker(12 * kSecond, 0.6),
+      Speaker(18 * kSecond, 0.6)};
+
+  // The left chunk misses the speaker of the second shot at its end, and the
+  // right chunk warms up with a spurious boundary and a wrong speaker.
+  const std::vector<ChunkRange> chunks = SplitIntoChunks(20 * kSecond,
+                                                         10 * kSecond);
+  const std::vector<std::vector<TraceRecord>> traces = {
+      {Shot(3 * kSecond), Speaker(5 * kSecond, 0.2), Speaker(9 * kSecond, 0.2),
+       Shot(11 * kSecond)},
+      {Shot(8 * kSecond), Speaker(9 * kSecond, 0.5), Shot(11 * kSecond),
+       Speaker(12 * kSecond, 0.6), Speaker(18 * kSecond, 0.6)}};
+
+  std::vector<TraceRecord> merged;
+  StitchStats stats;
+  MP_ASSERT_OK(
+      StitchTraces(chunks, traces, 2 * kSecond, 100000, &merged, &stats));
+  EXPECT_EQ(1, stats.num_reconciled);
+  EXPECT_THAT(stats.cuts_us, ::testing::ElementsAre(11 * kSecond));
+  EXPECT_EQ(Timestamps(single_pass), Timestamps(merged));
+  EXPECT_FLOAT_EQ(0.2, merged[2].speaker(0).x());
+  EXPECT_FLOAT_EQ(0.6, merged[4].speaker(0).x());
+}
+
+TEST(ChunkStitcherTest, CutsAtSeamWithoutSharedBoundary) {
+  const std::vector<ChunkRange> chunks = SplitIntoChunks(20 * kSecond,
+                                                         10 * kSecond);
+  const std::vector<std::vector<TraceRecord>> traces = {
+      {Speaker(9 * kSecond, 0.2), Speaker(10 * kSecond, 0.2)},
+      {Speaker(9 * kSecond, 0.5), Speaker(10 * kSecond, 0.5)}};
+
+  std::vector<TraceRecord> merged;
+  StitchStats stats;
+  MP_ASSERT_OK(
+      StitchTraces(chunks, traces, 2 * kSecond, 100000, &merged, &stats));
+  EXPECT_EQ(0, stats.num_reconciled);
+  ASSERT_EQ(2, merged.size());
+  EXPECT_FLOAT_EQ(0.2, merged[0].speaker(0).x());
+  EXPECT_FLOAT_EQ(0.5, merged[1].speaker(0).x());
+}
+
+TEST(ChunkStitcherTest, FailsOnGapBetweenChunks) {
+  std::vector<ChunkRange> chunks(2);
+  chunks[0].end_us = 10 * kSecond;
+  chunks[1].start_us = 11 * kSecond;
+  chunks[1].end_us = 20 * kSecond;
+  std::vector<TraceRecord> merged;
+  StitchStats stats;
+  EXPECT_FALSE(
+      StitchTraces(chunks, {{}, {}}, kSecond, 0, &merged, &stats).ok());
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,159 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/crop_fan_out.h"
+
+#include <set>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/port/ret_check.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kCroppingCalculator[] = "SceneCroppingCalculator";
+
+// Returns the name part of a "TAG:index:name", "TAG:name" or "name" entry.
+std::string NameOf(const std::string& entry) {
+  return entry.substr(entry.rfind(':') + 1);
+}
+
+// Renames the name part of |entry| for output |index|.
+std::string RenameEntry(const std::string& entry, int index) {
+  const size_t colon = entry.rfind(':');
+  const std::string prefix =
+      colon == std::string::npos ? "" : entry.substr(0, colon + 1);
+  return absl::StrCat(prefix, FanOutName(NameOf(entry), index));
+}
+
+}  // namespace
+
+std::string FanOutName(const std::string& name, int index) {
+  return absl::StrCat(name, "_", index);
+}
+
+::mediapipe::Status FanOutCropping(const CalculatorGraphConfig& config,
+                                   int num_outputs,
+                                   CalculatorGraphConfig* fanned_out) {
+  RET_CHECK_GT(num_outputs, 0);
+  const int num_nodes = config.node_size();
+  std::vector<bool> is_cloned(num_nodes, false);
+  int num_croppers = 0;
+  for (int i = 0; i < num_nodes; ++i) {
+    if (config.node(i).calculator() == kCroppingCalculator) {
+      is_cloned[i] = true;
+      ++num_croppers;
+    }
+  }
+  RET_CHECK_EQ(num_croppers, 1)
+      << "Graph must have exactly one " << kCroppingCalculator << " node.";
+
+  // Nodes reading a stream of a cloned node are cloned too. Nodes are not
+  // necessarily in topological order, so iterate until nothing changes.
+  std::set<std::string> cloned_streams;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int i = 0; i < num_nodes; ++i) {
+      const auto& node = config.node(i);
+      if (!is_cloned[i]) {
+        for (const auto& input : node.input_stream()) {
+          if (cloned_streams.count(NameOf(input)) > 0) {
+            is_cloned[i] = true;
+            break;
+          }
+        }
+      }
+      if (!is_cloned[i]) {
+        continue;
+      }
+      for (const auto& output : node.output_stream()) {
+        changed |= cloned_streams.insert(NameOf(output)).second;
+      }
+    }
+  }
+
+  // Input side packets that are produced by a node or read by a shared node
+  // are shared by all outputs.
+  std::set<std::string> shared_side_packets;
+  std::set<std::string> cloned_side_packets;
+  for (int i = 0; i < num_nodes; ++i) {
+    const auto& node = config.node(i);
+    for (const auto& side_packet : node.output_side_packet()) {
+      (is_cloned[i] ? cloned_side_packets : shared_side_packets)
+          .insert(NameOf(side_packet));
+    }
+    if (!is_cloned[i]) {
+      for (const auto& side_packet : node.input_side_packet()) {
+        shared_side_packets.insert(NameOf(side_packet));
+      }
+    }
+  }
+
+  *fanned_out = config;
+  fanned_out->clear_node();
+  for (int i = 0; i < num_nodes; ++i) {
+    if (!is_cloned[i]) {
+      *fanned_out->add_node() = config.node(i);
+    }
+  }
+  for (int index = 0; index < num_outputs; ++index) {
+    for (int i = 0; i < num_nodes; ++i) {
+      if (!is_cloned[i]) {
+        continue;
+      }
+      auto* node = fanned_out->add_node();
+      *node = config.node(i);
+      if (!node->name().empty()) {
+        node->set_name(FanOutName(node->name(), index));
+      }
+      for (auto& input : *node->mutable_input_stream()) {
+        if (cloned_streams.count(NameOf(input)) > 0) {
+          input = RenameEntry(input, index);
+        }
+      }
+      for (auto& output : *node->mutable_output_stream()) {
+        output = RenameEntry(output, index);
+      }
+      for (auto& side_packet : *node->mutable_input_side_packet()) {
+        const std::string name = NameOf(side_packet);
+        if (cloned_side_packets.count(name) > 0 ||
+            shared_side_packets.count(name) == 0) {
+          side_packet = RenameEntry(side_packet, index);
+        }
+      }
+      for (auto& side_packet : *node->mutable_output_side_packet()) {
+        side_packet = RenameEntry(side_packet, index);
+      }
+    }
+  }
+
+  // Graph outputs of the cloned nodes exist once per output.
+  fanned_out->clear_output_stream();
+  for (const auto& output : config.output_stream()) {
+    if (cloned_streams.count(NameOf(output)) == 0) {
+      fanned_out->add_output_stream(output);
+      continue;
+    }
+    for (int index = 0; index < num_outputs; ++index) {
+      fanned_out->add_output_stream(RenameEntry(output, index));
+    }
+  }
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
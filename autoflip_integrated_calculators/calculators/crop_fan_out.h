@@ -0,0 +1,49 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_CROP_FAN_OUT_H_
+#define MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_CROP_FAN_OUT_H_
+
+#include <string>
+
+#include "mediapipe/framework/calculator.pb.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// Rewrites a graph that crops a video to one aspect ratio, such as
+// autoflip_graph.pbtxt, into one that crops it to |num_outputs| aspect ratios
+// in the same pass. Decoding, feature extraction and signal fusion stay
+// shared; the SceneCroppingCalculator node and every node downstream of it,
+// i.e. the encoding nodes, are cloned once per output.
+//
+// In clone i, the streams and output side packets the cloned nodes produce
+// get the suffix "_<i>", and so do the input side packets that only cloned
+// nodes read and no node produces. With autoflip_graph.pbtxt, output i is
+// therefore configured by the side packets aspect_ratio_<i> and
+// output_video_path_<i>, while input_video_path and audio_path are shared.
+//
+// Fails unless |config| has exactly one SceneCroppingCalculator node.
+::mediapipe::Status FanOutCropping(const CalculatorGraphConfig& config,
+                                   int num_outputs,
+                                   CalculatorGraphConfig* fanned_out);
+
+// Returns the name of side packet or stream |name| in output |index|.
+std::string FanOutName(const std::string& name, int index);
+
+}  // namespace autoflip
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_CROP_FAN_OUT_H_
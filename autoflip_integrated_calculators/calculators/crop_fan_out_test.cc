@@ -0,0 +1,129 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/crop_fan_out.h"
+
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+using ::testing::ElementsAre;
+
+constexpr char kGraph[] = R"(
+    max_queue_size: -1
+    node {
+      calculator: "OpenCvVideoDecoderCalculator"
+      input_side_packet: "INPUT_FILE_PATH:input_video_path"
+      output_stream: "VIDEO:video_raw"
+      output_stream: "VIDEO_PRESTREAM:video_header"
+      output_side_packet: "SAVED_AUDIO_PATH:audio_path"
+    }
+    node {
+      calculator: "VideoPreStreamCalculator"
+      input_stream: "FRAME:cropped_frames"
+      input_stream: "VIDEO_PRESTREAM:video_header"
+      output_stream: "output_frames_video_header"
+    }
+    node {
+      calculator: "SignalFusingCalculator"
+      input_stream: "face_regions"
+      output_stream: "salient_regions"
+    }
+    node {
+      calculator: "SceneCroppingCalculator"
+      input_side_packet: "EXTERNAL_ASPECT_RATIO:aspect_ratio"
+      input_stream: "VIDEO_FRAMES:video_raw"
+      input_stream: "DETECTION_FEATURES:salient_regions"
+      output_stream: "CROPPED_FRAMES:cropped_frames"
+    }
+    node {
+      calculator: "OpenCvVideoEncoderCalculator"
+      input_stream: "VIDEO:cropped_frames"
+      input_stream: "VIDEO_PRESTREAM:output_frames_video_header"
+      input_side_packet: "OUTPUT_FILE_PATH:output_video_path"
+      input_side_packet: "AUDIO_FILE_PATH:audio_path"
+    }
+    output_stream: "cropped_frames"
+    output_stream: "salient_regions")";
+
+TEST(CropFanOutTest, ClonesCroppingAndEncoding) {
+  const auto config = ParseTextProtoOrDie<CalculatorGraphConfig>(kGraph);
+  CalculatorGraphConfig fanned_out;
+  MP_ASSERT_OK(FanOutCropping(config, 3, &fanned_out));
+
+  // The decoder and the fusion once, then cropping and encoding per output.
+  ASSERT_EQ(2 + 3 * 3, fanned_out.node_size());
+  EXPECT_EQ("OpenCvVideoDecoderCalculator", fanned_out.node(0).calculator());
+  EXPECT_EQ("SignalFusingCalculator", fanned_out.node(1).calculator());
+  EXPECT_EQ(-1, fanned_out.max_queue_size());
+  for (int i = 0; i < 3; ++i) {
+    const auto& pre_stream = fanned_out.node(2 + 3 * i);
+    EXPECT_EQ("VideoPreStreamCalculator", pre_stream.calculator());
+    EXPECT_THAT(pre_stream.input_stream(),
+                ElementsAre(FanOutName("FRAME:cropped_frames", i),
+                            "VIDEO_PRESTREAM:video_header"));
+    EXPECT_THAT(pre_stream.output_stream(),
+                ElementsAre(FanOutName("output_frames_video_header", i)));
+
+    const auto& cropper = fanned_out.node(3 + 3 * i);
+    EXPECT_EQ("SceneCroppingCalculator", cropper.calculator());
+    EXPECT_THAT(cropper.input_side_packet(),
+                ElementsAre(FanOutName("EXTERNAL_ASPECT_RATIO:aspect_ratio",
+                                       i)));
+    EXPECT_THAT(cropper.input_stream(),
+                ElementsAre("VIDEO_FRAMES:video_raw",
+                            "DETECTION_FEATURES:salient_regions"));
+
+    const auto& encoder = fanned_out.node(4 + 3 * i);
+    EXPECT_EQ("OpenCvVideoEncoderCalculator", encoder.calculator());
+    EXPECT_THAT(encoder.input_side_packet(),
+                ElementsAre(FanOutName("OUTPUT_FILE_PATH:output_video_path",
+                                       i),
+                            "AUDIO_FILE_PATH:audio_path"));
+  }
+  EXPECT_THAT(fanned_out.output_stream(),
+              ElementsAre("cropped_frames_0", "cropped_frames_1",
+                          "cropped_frames_2", "salient_regions"));
+}
+
+TEST(CropFanOutTest, SingleOutputOnlyRenames) {
+  const auto config = ParseTextProtoOrDie<CalculatorGraphConfig>(kGraph);
+  CalculatorGraphConfig fanned_out;
+  MP_ASSERT_OK(FanOutCropping(config, 1, &fanned_out));
+  EXPECT_EQ(config.node_size(), fanned_out.node_size());
+}
+
+TEST(CropFanOutTest, RequiresOneCropper) {
+  auto config = ParseTextProtoOrDie<CalculatorGraphConfig>(kGraph);
+  CalculatorGraphConfig fanned_out;
+  *config.add_node() = config.node(3);
+  EXPECT_FALSE(FanOutCropping(config, 2, &fanned_out).ok());
+  config.mutable_node()->DeleteSubrange(3, 1);
+  config.mutable_node()->DeleteSubrange(config.node_size() - 1, 1);
+  EXPECT_FALSE(FanOutCropping(config, 2, &fanned_out).ok());
+  EXPECT_FALSE(FanOutCropping(
+                   ParseTextProtoOrDie<CalculatorGraphConfig>(kGraph), 0,
+                   &fanned_out)
+                   .ok());
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
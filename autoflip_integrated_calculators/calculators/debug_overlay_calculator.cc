@@ -0,0 +1,267 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/debug_overlay_calculator.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/image_frame_pool.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// IO labels.
+constexpr char kInputVideo[] = "VIDEO";
+constexpr char kInputShotChange[] = "IS_SHOT_CHANGE";
+constexpr char kInputRegions[] = "REGIONS";
+constexpr char kInputAnnotations[] = "ANNOTATIONS";
+constexpr char kOutputFrame[] = "OUTPUT_FRAME";
+
+const cv::Scalar kWhite = cv::Scalar(255.0, 255.0, 255.0);  // text
+const cv::Scalar kRed = cv::Scalar(255.0, 0.0, 0.0);  // speaker, state 2
+const cv::Scalar kGreen = cv::Scalar(0.0, 255.0, 0.0);  // face, state 1
+const cv::Scalar kBlue = cv::Scalar(0.0, 0.0, 255.0);  // text regions
+const cv::Scalar kYellow = cv::Scalar(255.0, 255.0, 0.0);  // other regions
+
+// This calculator draws every debug signal of the AutoFlip graph onto one
+// copy of the input frame, so that development graphs copy each frame once
+// instead of once per visualization calculator. The output frame buffers
+// are recycled through an ImageFramePool.
+//
+// Any number of streams can be attached to each annotation tag:
+//   IS_SHOT_CHANGE:<i>  bool. A boundary counter and a state dot are drawn
+//                       for each stream, as in
+//                       ShotBoundaryVisualizationCalculator.
+//   REGIONS:<i>         DetectionSet, e.g. text or active speaker regions.
+//                       Boxes are colored by signal type.
+//   ANNOTATIONS:<i>     OverlayAnnotation emitted by other calculators,
+//                       e.g. the lip points of LipTrackCalculator.
+//
+// Example:
+//  node {
+//    calculator: "DebugOverlayCalculator"
+//    input_stream: "VIDEO:video_raw"
+//    input_stream: "IS_SHOT_CHANGE:0:shot_change"
+//    input_stream: "REGIONS:0:text_regions"
+//    input_stream: "ANNOTATIONS:0:speaker_annotations"
+//    output_stream: "OUTPUT_FRAME:debug_overlay_frames"
+//  }
+class DebugOverlayCalculator : public CalculatorBase {
+ public:
+  DebugOverlayCalculator() {}
+  DebugOverlayCalculator(const DebugOverlayCalculator&) = delete;
+  DebugOverlayCalculator& operator=(const DebugOverlayCalculator&) = delete;
+
+  static ::mediapipe::Status GetContract(mediapipe::CalculatorContract* cc);
+  ::mediapipe::Status Open(mediapipe::CalculatorContext* cc) override;
+  ::mediapipe::Status Process(mediapipe::CalculatorContext* cc) override;
+
+ private:
+  // Updates the held annotation packets with the current inputs.
+  void UpdateHeldPackets(mediapipe::CalculatorContext* cc);
+  void DrawShotChanges(cv::Mat* viz_mat);
+  void DrawRegions(const DetectionSet& regions, cv::Mat* viz_mat);
+  void DrawAnnotation(const OverlayAnnotation& annotation, cv::Mat* viz_mat);
+  cv::Point2f ToPixel(float x, float y, const cv::Mat& viz_mat);
+
+  // Calculator options.
+  DebugOverlayCalculatorOptions options_;
+  // Recycles the output frame buffers.
+  std::shared_ptr<ImageFramePool> pool_;
+  // Number of boundaries and on/off state of each IS_SHOT_CHANGE stream.
+  std::vector<int> num_boundaries_;
+  std::vector<bool> shot_states_;
+  // Latest packet of each REGIONS and ANNOTATIONS stream.
+  std::vector<Packet> held_regions_;
+  std::vector<Packet> held_annotations_;
+};
+
+REGISTER_CALCULATOR(DebugOverlayCalculator);
+
+::mediapipe::Status DebugOverlayCalculator::GetContract(
+    mediapipe::CalculatorContract* cc) {
+  cc->Inputs().Tag(kInputVideo).Set<ImageFrame>();
+  for (int i = 0; i < cc->Inputs().NumEntries(kInputShotChange); ++i) {
+    cc->Inputs().Get(kInputShotChange, i).Set<bool>();
+  }
+  for (int i = 0; i < cc->Inputs().NumEntries(kInputRegions); ++i) {
+    cc->Inputs().Get(kInputRegions, i).Set<DetectionSet>();
+  }
+  for (int i = 0; i < cc->Inputs().NumEntries(kInputAnnotations); ++i) {
+    cc->Inputs().Get(kInputAnnotations, i).Set<OverlayAnnotation>();
+  }
+  cc->Outputs().Tag(kOutputFrame).Set<ImageFrame>();
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status DebugOverlayCalculator::Open(
+    mediapipe::CalculatorContext* cc) {
+  options_ = cc->Options<DebugOverlayCalculatorOptions>();
+  RET_CHECK_GE(options_.max_pooled_frames(), 0)
+      << "max_pooled_frames must not be negative.";
+  pool_ = ImageFramePool::Create(options_.max_pooled_frames());
+  num_boundaries_.assign(cc->Inputs().NumEntries(kInputShotChange), 0);
+  shot_states_.assign(cc->Inputs().NumEntries(kInputShotChange), false);
+  held_regions_.assign(cc->Inputs().NumEntries(kInputRegions), Packet());
+  held_annotations_.assign(cc->Inputs().NumEntries(kInputAnnotations),
+                           Packet());
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status DebugOverlayCalculator::Process(
+    mediapipe::CalculatorContext* cc) {
+  for (int i = 0; i < num_boundaries_.size(); ++i) {
+    const auto& packet = cc->Inputs().Get(kInputShotChange, i).Value();
+    if (!packet.IsEmpty() && packet.Get<bool>()) {
+      num_boundaries_[i]++;
+      shot_states_[i] = !shot_states_[i];
+    }
+  }
+  UpdateHeldPackets(cc);
+
+  // Annotation streams may advance without a frame; only draw on frames.
+  if (cc->Inputs().Tag(kInputVideo).Value().IsEmpty()) {
+    return ::mediapipe::OkStatus();
+  }
+  const auto& frame = cc->Inputs().Tag(kInputVideo).Get<ImageFrame>();
+  auto viz_frame =
+      pool_->GetFrame(frame.Format(), frame.Width(), frame.Height());
+  cv::Mat viz_mat = formats::MatView(viz_frame.get());
+  formats::MatView(&frame).copyTo(viz_mat);
+
+  DrawShotChanges(&viz_mat);
+  for (const auto& packet : held_regions_) {
+    if (!packet.IsEmpty()) {
+      DrawRegions(packet.Get<DetectionSet>(), &viz_mat);
+    }
+  }
+  for (const auto& packet : held_annotations_) {
+    if (!packet.IsEmpty()) {
+      DrawAnnotation(packet.Get<OverlayAnnotation>(), &viz_mat);
+    }
+  }
+
+  cc->Outputs().Tag(kOutputFrame).Add(viz_frame.release(),
+                                      cc->InputTimestamp());
+  return ::mediapipe::OkStatus();
+}
+
+void DebugOverlayCalculator::UpdateHeldPackets(
+    mediapipe::CalculatorContext* cc) {
+  for (int i = 0; i < held_regions_.size(); ++i) {
+    const auto& packet = cc->Inputs().Get(kInputRegions, i).Value();
+    if (!packet.IsEmpty() || !options_.hold_annotations()) {
+      held_regions_[i] = packet;
+    }
+  }
+  for (int i = 0; i < held_annotations_.size(); ++i) {
+    const auto& packet = cc->Inputs().Get(kInputAnnotations, i).Value();
+    if (!packet.IsEmpty() || !options_.hold_annotations()) {
+      held_annotations_[i] = packet;
+    }
+  }
+}
+
+void DebugOverlayCalculator::DrawShotChanges(cv::Mat* viz_mat) {
+  // One text line per stream, followed by one row of state dots.
+  float text_x = 0.02, text_y = 0.05, line_step = 0.05,
+        state_x = 0.05, state_step = 0.08;
+  const float state_y = text_y + num_boundaries_.size() * line_step + 0.05;
+  for (int i = 0; i < num_boundaries_.size(); ++i) {
+    std::string text = cv::format("Shot boundaries [%d]: %d.", i,
+                                  num_boundaries_[i]);
+    cv::putText(*viz_mat, text,
+                ToPixel(text_x, text_y + i * line_step, *viz_mat),
+                cv::FONT_HERSHEY_COMPLEX, 0.8, kWhite);
+    cv::circle(*viz_mat,
+               ToPixel(state_x + i * state_step, state_y, *viz_mat),
+               20, shot_states_[i] ? kGreen : kRed, CV_FILLED);
+  }
+}
+
+void DebugOverlayCalculator::DrawRegions(const DetectionSet& regions,
+                                         cv::Mat* viz_mat) {
+  for (const auto& region : regions.detections()) {
+    if (!region.has_location_normalized()) {
+      continue;
+    }
+    cv::Scalar color = kYellow;
+    switch (region.signal_type().standard()) {
+      case SignalType::SPEAKER:
+        color = kRed;
+        break;
+      case SignalType::TEXT:
+        color = kBlue;
+        break;
+      case SignalType::FACE_FULL:
+      case SignalType::FACE_CORE_LANDMARKS:
+      case SignalType::FACE_ALL_LANDMARKS:
+      case SignalType::FACE_LANDMARK:
+        color = kGreen;
+        break;
+      default:
+        break;
+    }
+    const auto& location = region.location_normalized();
+    cv::rectangle(*viz_mat, ToPixel(location.x(), location.y(), *viz_mat),
+                  ToPixel(location.x() + location.width(),
+                          location.y() + location.height(), *viz_mat),
+                  color, options_.region_thickness());
+  }
+}
+
+void DebugOverlayCalculator::DrawAnnotation(
+    const OverlayAnnotation& annotation, cv::Mat* viz_mat) {
+  const auto to_scalar = [](const Color& color) {
+    return cv::Scalar(color.r(), color.g(), color.b());
+  };
+  for (const auto& box : annotation.box()) {
+    const auto& location = box.location_normalized();
+    const cv::Point2f top_left = ToPixel(location.x(), location.y(), *viz_mat);
+    cv::rectangle(*viz_mat, top_left,
+                  ToPixel(location.x() + location.width(),
+                          location.y() + location.height(), *viz_mat),
+                  to_scalar(box.color()), box.thickness());
+    if (!box.label().empty()) {
+      cv::putText(*viz_mat, box.label(), top_left,
+                  cv::FONT_HERSHEY_COMPLEX_SMALL, 0.5, kWhite);
+    }
+  }
+  for (const auto& point : annotation.point()) {
+    cv::circle(*viz_mat, ToPixel(point.x(), point.y(), *viz_mat),
+               point.radius(), to_scalar(point.color()), CV_FILLED);
+  }
+  for (const auto& text : annotation.text()) {
+    cv::putText(*viz_mat, text.text(), ToPixel(text.x(), text.y(), *viz_mat),
+                cv::FONT_HERSHEY_COMPLEX, text.font_scale(),
+                to_scalar(text.color()));
+  }
+}
+
+cv::Point2f DebugOverlayCalculator::ToPixel(float x, float y,
+                                            const cv::Mat& viz_mat) {
+  return cv::Point2f(x * viz_mat.cols, y * viz_mat.rows);
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,150 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/debug_overlay_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kInputVideo[] = "VIDEO";
+constexpr char kInputShotChange[] = "IS_SHOT_CHANGE";
+constexpr char kInputRegions[] = "REGIONS";
+constexpr char kInputAnnotations[] = "ANNOTATIONS";
+constexpr char kOutputFrame[] = "OUTPUT_FRAME";
+
+const int kImageWidth = 800;
+const int kImageHeight = 600;
+const int kNumFrames = 3;
+
+constexpr char kConfig[] = R"(
+    calculator: "DebugOverlayCalculator"
+    input_stream: "VIDEO:video"
+    input_stream: "IS_SHOT_CHANGE:0:shot_change"
+    input_stream: "REGIONS:0:text_regions"
+    input_stream: "ANNOTATIONS:0:speaker_annotations"
+    output_stream: "OUTPUT_FRAME:overlay_frames")";
+
+void AddFrames(CalculatorRunner* runner) {
+  for (int i = 0; i < kNumFrames; ++i) {
+    auto frame = ::absl::make_unique<ImageFrame>(ImageFormat::SRGB,
+                                                 kImageWidth, kImageHeight);
+    formats::MatView(frame.get()).setTo(cv::Scalar(0, 0, 0));
+    runner->MutableInputs()->Tag(kInputVideo).packets.push_back(
+        Adopt(frame.release()).At(Timestamp(i)));
+  }
+}
+
+// Returns the pixel at normalized position (x, y).
+cv::Vec3b PixelAt(const ImageFrame& frame, float x, float y) {
+  return formats::MatView(&frame).at<cv::Vec3b>(y * kImageHeight,
+                                                x * kImageWidth);
+}
+
+TEST(DebugOverlayCalculatorTest, OneOutputPerFrame) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  AddFrames(runner.get());
+  MP_ASSERT_OK(runner->Run());
+
+  const auto& output_packets = runner->Outputs().Tag(kOutputFrame).packets;
+  ASSERT_EQ(kNumFrames, output_packets.size());
+  for (int i = 0; i < kNumFrames; ++i) {
+    const auto& frame = output_packets[i].Get<ImageFrame>();
+    EXPECT_EQ(Timestamp(i), output_packets[i].Timestamp());
+    EXPECT_EQ(kImageWidth, frame.Width());
+    EXPECT_EQ(kImageHeight, frame.Height());
+    EXPECT_EQ(ImageFormat::SRGB, frame.Format());
+  }
+}
+
+TEST(DebugOverlayCalculatorTest, DrawsRegionsAndHoldsThem) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  AddFrames(runner.get());
+  auto regions = ::absl::make_unique<DetectionSet>();
+  auto* region = regions->add_detections();
+  region->mutable_location_normalized()->set_x(0.5);
+  region->mutable_location_normalized()->set_y(0.5);
+  region->mutable_location_normalized()->set_width(0.25);
+  region->mutable_location_normalized()->set_height(0.25);
+  region->mutable_signal_type()->set_standard(SignalType::TEXT);
+  runner->MutableInputs()->Tag(kInputRegions).packets.push_back(
+      Adopt(regions.release()).At(Timestamp(0)));
+  MP_ASSERT_OK(runner->Run());
+
+  const auto& output_packets = runner->Outputs().Tag(kOutputFrame).packets;
+  ASSERT_EQ(kNumFrames, output_packets.size());
+  // The region only arrives with the first frame but is held afterwards.
+  for (const auto& packet : output_packets) {
+    EXPECT_EQ(cv::Vec3b(0, 0, 255), PixelAt(packet.Get<ImageFrame>(), 0.5, 0.6));
+    EXPECT_EQ(cv::Vec3b(0, 0, 0), PixelAt(packet.Get<ImageFrame>(), 0.6, 0.6));
+  }
+}
+
+TEST(DebugOverlayCalculatorTest, DrawsAnnotationsOnlyAtTheirTimestamp) {
+  auto config = ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig);
+  config.mutable_options()
+      ->MutableExtension(DebugOverlayCalculatorOptions::ext)
+      ->set_hold_annotations(false);
+  auto runner = ::absl::make_unique<CalculatorRunner>(config);
+  AddFrames(runner.get());
+  auto annotation = ::absl::make_unique<OverlayAnnotation>();
+  auto* point = annotation->add_point();
+  point->set_x(0.5);
+  point->set_y(0.5);
+  point->set_radius(5);
+  point->mutable_color()->set_g(255);
+  runner->MutableInputs()->Tag(kInputAnnotations).packets.push_back(
+      Adopt(annotation.release()).At(Timestamp(1)));
+  MP_ASSERT_OK(runner->Run());
+
+  const auto& output_packets = runner->Outputs().Tag(kOutputFrame).packets;
+  ASSERT_EQ(kNumFrames, output_packets.size());
+  EXPECT_EQ(cv::Vec3b(0, 0, 0),
+            PixelAt(output_packets[0].Get<ImageFrame>(), 0.5, 0.5));
+  EXPECT_EQ(cv::Vec3b(0, 255, 0),
+            PixelAt(output_packets[1].Get<ImageFrame>(), 0.5, 0.5));
+  EXPECT_EQ(cv::Vec3b(0, 0, 0),
+            PixelAt(output_packets[2].Get<ImageFrame>(), 0.5, 0.5));
+}
+
+TEST(DebugOverlayCalculatorTest, DoesNotModifyInputFrames) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  AddFrames(runner.get());
+  runner->MutableInputs()->Tag(kInputShotChange).packets.push_back(
+      MakePacket<bool>(true).At(Timestamp(0)));
+  MP_ASSERT_OK(runner->Run());
+
+  for (const auto& packet : runner->MutableInputs()->Tag(kInputVideo).packets) {
+    const cv::Mat input = formats::MatView(&packet.Get<ImageFrame>());
+    EXPECT_EQ(0, cv::countNonZero(input.reshape(1)));
+  }
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
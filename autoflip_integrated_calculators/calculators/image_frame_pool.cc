@@ -0,0 +1,85 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/image_frame_pool.h"
+
+#include "absl/memory/memory.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+std::shared_ptr<ImageFramePool> ImageFramePool::Create(
+    size_t max_free_buffers) {
+  return std::shared_ptr<ImageFramePool>(new ImageFramePool(max_free_buffers));
+}
+
+ImageFramePool::ImageFramePool(size_t max_free_buffers)
+    : max_free_buffers_(max_free_buffers) {}
+
+std::unique_ptr<ImageFrame> ImageFramePool::GetFrame(
+    ImageFormat::Format format, int width, int height) {
+  std::unique_ptr<uint8[]> buffer;
+  int width_step;
+  int generation;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (format != format_ || width != width_ || height != height_) {
+      format_ = format;
+      width_ = width;
+      height_ = height;
+      const int row_bytes = width * ImageFrame::NumberOfChannelsForFormat(format) *
+                            ImageFrame::ByteDepthForFormat(format);
+      const int alignment = ImageFrame::kDefaultAlignmentBoundary;
+      width_step_ = (row_bytes + alignment - 1) / alignment * alignment;
+      free_buffers_.clear();
+      ++generation_;
+    }
+    width_step = width_step_;
+    generation = generation_;
+    if (!free_buffers_.empty()) {
+      buffer = std::move(free_buffers_.back());
+      free_buffers_.pop_back();
+    }
+  }
+  if (!buffer) {
+    buffer = absl::make_unique<uint8[]>(width_step * height);
+  }
+
+  std::weak_ptr<ImageFramePool> weak_pool = shared_from_this();
+  return absl::make_unique<ImageFrame>(
+      format, width, height, width_step, buffer.release(),
+      [weak_pool, generation](uint8* pixels) {
+        if (auto pool = weak_pool.lock()) {
+          pool->Release(generation, pixels);
+        } else {
+          delete[] pixels;
+        }
+      });
+}
+
+int ImageFramePool::NumFreeBuffers() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return free_buffers_.size();
+}
+
+void ImageFramePool::Release(int generation, uint8* buffer) {
+  std::unique_ptr<uint8[]> owned(buffer);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (generation == generation_ && free_buffers_.size() < max_free_buffers_) {
+    free_buffers_.push_back(std::move(owned));
+  }
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
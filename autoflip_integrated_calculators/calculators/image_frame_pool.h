@@ -0,0 +1,75 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_IMAGE_FRAME_POOL_H_
+#define MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_IMAGE_FRAME_POOL_H_
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "mediapipe/framework/formats/image_frame.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// Recycles the pixel buffers of ImageFrames emitted by a calculator. Frames
+// returned by GetFrame() own a buffer from the pool and hand it back when the
+// last packet holding them is destroyed, so a calculator that outputs one
+// frame per timestamp stops allocating once the pipeline is warm.
+//
+// The pool must be held in a std::shared_ptr. Frames only keep a weak
+// reference to it, so buffers released after the pool is gone are freed.
+//
+// Example:
+//   pool_ = ImageFramePool::Create(/* max_free_buffers = */ 4);
+//   auto frame = pool_->GetFrame(ImageFormat::SRGB, width, height);
+//   cc->Outputs().Tag(kOutput).Add(frame.release(), cc->InputTimestamp());
+class ImageFramePool : public std::enable_shared_from_this<ImageFramePool> {
+ public:
+  static std::shared_ptr<ImageFramePool> Create(size_t max_free_buffers);
+
+  ImageFramePool(const ImageFramePool&) = delete;
+  ImageFramePool& operator=(const ImageFramePool&) = delete;
+
+  // Returns a frame with uninitialized pixels. Buffers are reused only when
+  // format and dimensions match the previous request; otherwise the free list
+  // is dropped and a new buffer is allocated.
+  std::unique_ptr<ImageFrame> GetFrame(ImageFormat::Format format, int width,
+                                       int height);
+
+  // Number of buffers currently waiting to be reused.
+  int NumFreeBuffers();
+
+ private:
+  explicit ImageFramePool(size_t max_free_buffers);
+  void Release(int generation, uint8* buffer);
+
+  const size_t max_free_buffers_;
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<uint8[]>> free_buffers_;
+  ImageFormat::Format format_ = ImageFormat::UNKNOWN;
+  int width_ = -1;
+  int height_ = -1;
+  int width_step_ = 0;
+  // Incremented whenever the frame geometry changes so that buffers of the
+  // old geometry are freed instead of being returned to the pool.
+  int generation_ = 0;
+};
+
+}  // namespace autoflip
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_IMAGE_FRAME_POOL_H_
@@ -0,0 +1,74 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/image_frame_pool.h"
+
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+const int kImageWidth = 801;
+const int kImageHeight = 600;
+
+TEST(ImageFramePoolTest, ReusesReleasedBuffers) {
+  auto pool = ImageFramePool::Create(/* max_free_buffers = */ 2);
+  auto frame = pool->GetFrame(ImageFormat::SRGB, kImageWidth, kImageHeight);
+  const uint8* pixels = frame->PixelData();
+  EXPECT_EQ(0, pool->NumFreeBuffers());
+  frame.reset();
+  EXPECT_EQ(1, pool->NumFreeBuffers());
+
+  frame = pool->GetFrame(ImageFormat::SRGB, kImageWidth, kImageHeight);
+  EXPECT_EQ(pixels, frame->PixelData());
+  EXPECT_EQ(kImageWidth, frame->Width());
+  EXPECT_EQ(kImageHeight, frame->Height());
+  EXPECT_EQ(0, frame->WidthStep() % ImageFrame::kDefaultAlignmentBoundary);
+  EXPECT_EQ(0, pool->NumFreeBuffers());
+}
+
+TEST(ImageFramePoolTest, KeepsAtMostMaxFreeBuffers) {
+  auto pool = ImageFramePool::Create(/* max_free_buffers = */ 1);
+  auto frame_1 = pool->GetFrame(ImageFormat::SRGB, kImageWidth, kImageHeight);
+  auto frame_2 = pool->GetFrame(ImageFormat::SRGB, kImageWidth, kImageHeight);
+  frame_1.reset();
+  frame_2.reset();
+  EXPECT_EQ(1, pool->NumFreeBuffers());
+}
+
+TEST(ImageFramePoolTest, DropsBuffersWhenGeometryChanges) {
+  auto pool = ImageFramePool::Create(/* max_free_buffers = */ 2);
+  auto frame = pool->GetFrame(ImageFormat::SRGB, kImageWidth, kImageHeight);
+  auto other = pool->GetFrame(ImageFormat::SRGB, kImageWidth / 2,
+                              kImageHeight / 2);
+  // The first frame has the old geometry and is not returned to the pool.
+  frame.reset();
+  EXPECT_EQ(0, pool->NumFreeBuffers());
+  other.reset();
+  EXPECT_EQ(1, pool->NumFreeBuffers());
+}
+
+TEST(ImageFramePoolTest, FramesOutliveThePool) {
+  auto pool = ImageFramePool::Create(/* max_free_buffers = */ 2);
+  auto frame = pool->GetFrame(ImageFormat::SRGB, kImageWidth, kImageHeight);
+  pool.reset();
+  frame.reset();
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,182 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "mediapipe/examples/desktop/autoflip/calculators/image_frame_pool.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/image_pyramid_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// IO labels.
+constexpr char kInputImage[] = "IMAGE";
+constexpr char kOutputLevel[] = "LEVEL";
+
+// This calculator resamples each input frame into a pyramid of smaller
+// frames, one output stream per level, so that the detectors of the AutoFlip
+// graph share one resampling pass instead of each resizing the full frame on
+// its own. Level i is resampled from level i - 1 (level 0 from the input), so
+// only the largest level reads the full frame and every other level reads a
+// frame that is still in cache. Resampling uses area averaging (OpenCV's
+// vectorized INTER_AREA), and levels of the size of their source are copied.
+//
+// The level sizes are set in the options, see ImagePyramidCalculatorOptions,
+// and are recomputed whenever the input size changes. Output frames have the
+// format of the input, and their buffers are recycled through one
+// ImageFramePool per level.
+//
+// Example:
+//  node {
+//    calculator: "ImagePyramidCalculator"
+//    input_stream: "IMAGE:video_raw"
+//    output_stream: "LEVEL:0:video_frames_scaled"
+//    output_stream: "LEVEL:1:video_frames_small"
+//    output_stream: "LEVEL:2:video_frames_shot"
+//    options: {
+//      [mediapipe.autoflip.ImagePyramidCalculatorOptions.ext]: {
+//        level { width: 480 }
+//        level { width: 240 }
+//        level { width: 48 height: 27 }
+//      }
+//    }
+//  }
+class ImagePyramidCalculator : public CalculatorBase {
+ public:
+  ImagePyramidCalculator() {}
+  ImagePyramidCalculator(const ImagePyramidCalculator&) = delete;
+  ImagePyramidCalculator& operator=(const ImagePyramidCalculator&) = delete;
+
+  static ::mediapipe::Status GetContract(mediapipe::CalculatorContract* cc);
+  ::mediapipe::Status Open(mediapipe::CalculatorContext* cc) override;
+  ::mediapipe::Status Process(mediapipe::CalculatorContext* cc) override;
+
+ private:
+  // Computes level_sizes_ for an input of the given size.
+  ::mediapipe::Status ComputeLevelSizes(int width, int height);
+
+  // Calculator options.
+  ImagePyramidCalculatorOptions options_;
+  // Recycles the frame buffers of each level.
+  std::vector<std::shared_ptr<ImageFramePool>> pools_;
+  // Input size the level sizes were computed for.
+  int input_width_ = -1;
+  int input_height_ = -1;
+  std::vector<cv::Size> level_sizes_;
+};
+
+REGISTER_CALCULATOR(ImagePyramidCalculator);
+
+::mediapipe::Status ImagePyramidCalculator::GetContract(
+    mediapipe::CalculatorContract* cc) {
+  cc->Inputs().Tag(kInputImage).Set<ImageFrame>();
+  for (int i = 0; i < cc->Outputs().NumEntries(kOutputLevel); ++i) {
+    cc->Outputs().Get(kOutputLevel, i).Set<ImageFrame>();
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status ImagePyramidCalculator::Open(
+    mediapipe::CalculatorContext* cc) {
+  options_ = cc->Options<ImagePyramidCalculatorOptions>();
+  RET_CHECK_EQ(options_.level_size(), cc->Outputs().NumEntries(kOutputLevel))
+      << "There must be one LEVEL output stream per level.";
+  for (const auto& level : options_.level()) {
+    RET_CHECK(level.width() > 0 || level.height() > 0)
+        << "Each level needs a positive width or height.";
+    RET_CHECK(level.width() >= 0 && level.height() >= 0)
+        << "Level sizes must not be negative.";
+  }
+  RET_CHECK_GE(options_.max_pooled_frames(), 0)
+      << "max_pooled_frames must not be negative.";
+  for (int i = 0; i < options_.level_size(); ++i) {
+    pools_.push_back(ImageFramePool::Create(options_.max_pooled_frames()));
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status ImagePyramidCalculator::ComputeLevelSizes(int width,
+                                                              int height) {
+  // Returns |size| scaled by |scale|, rounded to an even number.
+  const auto scaled_even = [](int size, double scale) {
+    return std::max(2, static_cast<int>(std::round(size * scale / 2)) * 2);
+  };
+  level_sizes_.clear();
+  cv::Size previous(width, height);
+  for (const auto& level : options_.level()) {
+    int level_width = level.width();
+    int level_height = level.height();
+    if (level_height == 0) {
+      level_height =
+          scaled_even(height, static_cast<double>(level_width) / width);
+    } else if (level_width == 0) {
+      level_width =
+          scaled_even(width, static_cast<double>(level_height) / height);
+    }
+    const cv::Size size(std::min(level_width, width),
+                        std::min(level_height, height));
+    RET_CHECK(size.width <= previous.width && size.height <= previous.height)
+        << "Level " << level_sizes_.size() << " (" << size.width << "x"
+        << size.height << ") is larger than the level before it ("
+        << previous.width << "x" << previous.height << ").";
+    level_sizes_.push_back(size);
+    previous = size;
+  }
+  input_width_ = width;
+  input_height_ = height;
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status ImagePyramidCalculator::Process(
+    mediapipe::CalculatorContext* cc) {
+  const auto& input = cc->Inputs().Tag(kInputImage).Get<ImageFrame>();
+  if (input.Width() != input_width_ || input.Height() != input_height_) {
+    MP_RETURN_IF_ERROR(ComputeLevelSizes(input.Width(), input.Height()));
+  }
+
+  // The frames are only output once all levels are done, since each level
+  // reads the pixels of the one before it.
+  std::vector<std::unique_ptr<ImageFrame>> levels;
+  cv::Mat source = formats::MatView(&input);
+  for (int i = 0; i < level_sizes_.size(); ++i) {
+    const cv::Size& size = level_sizes_[i];
+    auto level = pools_[i]->GetFrame(input.Format(), size.width, size.height);
+    cv::Mat level_mat = formats::MatView(level.get());
+    if (size == source.size()) {
+      source.copyTo(level_mat);
+    } else {
+      cv::resize(source, level_mat, size, 0, 0, cv::INTER_AREA);
+    }
+    source = level_mat;
+    levels.push_back(std::move(level));
+  }
+  for (int i = 0; i < levels.size(); ++i) {
+    cc->Outputs().Get(kOutputLevel, i).Add(levels[i].release(),
+                                           cc->InputTimestamp());
+  }
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
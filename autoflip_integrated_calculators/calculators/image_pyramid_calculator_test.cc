@@ -0,0 +1,194 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/image_pyramid_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kInputImage[] = "IMAGE";
+constexpr char kOutputLevel[] = "LEVEL";
+
+const int kNumFrames = 3;
+
+constexpr char kConfig[] = R"(
+    calculator: "ImagePyramidCalculator"
+    input_stream: "IMAGE:video"
+    output_stream: "LEVEL:0:video_480"
+    output_stream: "LEVEL:1:video_240"
+    output_stream: "LEVEL:2:video_shot"
+    options: {
+      [mediapipe.autoflip.ImagePyramidCalculatorOptions.ext]: {
+        level { width: 480 }
+        level { width: 240 }
+        level { width: 48 height: 27 }
+      }
+    })";
+
+void AddFrames(int width, int height, const cv::Scalar& color,
+               CalculatorRunner* runner) {
+  for (int i = 0; i < kNumFrames; ++i) {
+    auto frame =
+        ::absl::make_unique<ImageFrame>(ImageFormat::SRGB, width, height);
+    formats::MatView(frame.get()).setTo(color);
+    runner->MutableInputs()->Tag(kInputImage).packets.push_back(
+        Adopt(frame.release()).At(Timestamp(i)));
+  }
+}
+
+void ExpectLevel(const CalculatorRunner& runner, int level, int width,
+                 int height) {
+  const auto& packets = runner.Outputs().Get(kOutputLevel, level).packets;
+  ASSERT_EQ(kNumFrames, packets.size());
+  for (int i = 0; i < kNumFrames; ++i) {
+    const auto& frame = packets[i].Get<ImageFrame>();
+    EXPECT_EQ(Timestamp(i), packets[i].Timestamp());
+    EXPECT_EQ(ImageFormat::SRGB, frame.Format());
+    EXPECT_EQ(width, frame.Width()) << "level " << level;
+    EXPECT_EQ(height, frame.Height()) << "level " << level;
+  }
+}
+
+TEST(ImagePyramidCalculatorTest, OutputsEachLevel) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  AddFrames(1920, 1080, cv::Scalar(10, 20, 30), runner.get());
+  MP_ASSERT_OK(runner->Run());
+
+  ExpectLevel(*runner, 0, 480, 270);
+  ExpectLevel(*runner, 1, 240, 136);
+  ExpectLevel(*runner, 2, 48, 27);
+}
+
+TEST(ImagePyramidCalculatorTest, KeepsUniformColors) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  AddFrames(1280, 720, cv::Scalar(10, 20, 30), runner.get());
+  MP_ASSERT_OK(runner->Run());
+
+  for (int level = 0; level < 3; ++level) {
+    const auto& frame =
+        runner->Outputs().Get(kOutputLevel, level).packets[0].Get<ImageFrame>();
+    const cv::Mat mat = formats::MatView(&frame);
+    EXPECT_EQ(cv::Vec3b(10, 20, 30), mat.at<cv::Vec3b>(0, 0));
+    EXPECT_EQ(cv::Vec3b(10, 20, 30),
+              mat.at<cv::Vec3b>(mat.rows - 1, mat.cols - 1));
+  }
+}
+
+TEST(ImagePyramidCalculatorTest, AveragesPixels) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(R"(
+        calculator: "ImagePyramidCalculator"
+        input_stream: "IMAGE:video"
+        output_stream: "LEVEL:0:video_half"
+        options: {
+          [mediapipe.autoflip.ImagePyramidCalculatorOptions.ext]: {
+            level { width: 2 }
+          }
+        })"));
+  // Alternating black and white columns average to gray. The height follows
+  // the aspect ratio, so rows are copied.
+  auto frame = ::absl::make_unique<ImageFrame>(ImageFormat::SRGB, 4, 2);
+  cv::Mat mat = formats::MatView(frame.get());
+  mat.setTo(cv::Scalar(0, 0, 0));
+  mat.col(1).setTo(cv::Scalar(200, 200, 200));
+  mat.col(3).setTo(cv::Scalar(200, 200, 200));
+  runner->MutableInputs()->Tag(kInputImage).packets.push_back(
+      Adopt(frame.release()).At(Timestamp(0)));
+  MP_ASSERT_OK(runner->Run());
+
+  const auto& level =
+      runner->Outputs().Get(kOutputLevel, 0).packets[0].Get<ImageFrame>();
+  ASSERT_EQ(2, level.Width());
+  ASSERT_EQ(2, level.Height());
+  EXPECT_EQ(cv::Vec3b(100, 100, 100),
+            formats::MatView(&level).at<cv::Vec3b>(0, 0));
+}
+
+TEST(ImagePyramidCalculatorTest, DoesNotUpscale) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  AddFrames(320, 180, cv::Scalar(0, 0, 0), runner.get());
+  MP_ASSERT_OK(runner->Run());
+
+  ExpectLevel(*runner, 0, 320, 180);
+  ExpectLevel(*runner, 1, 240, 136);
+  ExpectLevel(*runner, 2, 48, 27);
+}
+
+TEST(ImagePyramidCalculatorTest, FollowsInputSizeChanges) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  auto wide = ::absl::make_unique<ImageFrame>(ImageFormat::SRGB, 960, 540);
+  auto tall = ::absl::make_unique<ImageFrame>(ImageFormat::SRGB, 960, 1280);
+  runner->MutableInputs()->Tag(kInputImage).packets.push_back(
+      Adopt(wide.release()).At(Timestamp(0)));
+  runner->MutableInputs()->Tag(kInputImage).packets.push_back(
+      Adopt(tall.release()).At(Timestamp(1)));
+  MP_ASSERT_OK(runner->Run());
+
+  const auto& packets = runner->Outputs().Get(kOutputLevel, 0).packets;
+  ASSERT_EQ(2, packets.size());
+  EXPECT_EQ(270, packets[0].Get<ImageFrame>().Height());
+  EXPECT_EQ(640, packets[1].Get<ImageFrame>().Height());
+}
+
+TEST(ImagePyramidCalculatorTest, RejectsGrowingLevels) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(R"(
+        calculator: "ImagePyramidCalculator"
+        input_stream: "IMAGE:video"
+        output_stream: "LEVEL:0:video_small"
+        output_stream: "LEVEL:1:video_large"
+        options: {
+          [mediapipe.autoflip.ImagePyramidCalculatorOptions.ext]: {
+            level { width: 240 }
+            level { width: 480 }
+          }
+        })"));
+  AddFrames(1280, 720, cv::Scalar(0, 0, 0), runner.get());
+  EXPECT_FALSE(runner->Run().ok());
+}
+
+TEST(ImagePyramidCalculatorTest, RejectsMissingLevelOutputs) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(R"(
+        calculator: "ImagePyramidCalculator"
+        input_stream: "IMAGE:video"
+        output_stream: "LEVEL:0:video_480"
+        options: {
+          [mediapipe.autoflip.ImagePyramidCalculatorOptions.ext]: {
+            level { width: 480 }
+            level { width: 240 }
+          }
+        })"));
+  AddFrames(1280, 720, cv::Scalar(0, 0, 0), runner.get());
+  EXPECT_FALSE(runner->Run().ok());
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -17,8 +17,10 @@
 #include <memory>
 #include <cmath>
 
+#include "absl/strings/str_cat.h"
 #include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
 #include "mediapipe/examples/desktop/autoflip/calculators/lip_track_calculator.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/simd_kernels.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/detection.pb.h"
 #include "mediapipe/framework/formats/rect.pb.h"
@@ -52,6 +54,19 @@ constexpr char kOutputShot[] = "IS_SPEAKER_CHANGE";
 // as visualization of lip contour and related information.
 constexpr char kOutputContour[] = "CONTOUR_INFORMATION_FRAME";
 
+// (Optional) Output the same lip contour and face information as
+// OverlayAnnotation packets, to be drawn by DebugOverlayCalculator
+// without copying the frame.
+constexpr char kOutputAnnotations[] = "ANNOTATIONS";
+
+// (Optional) Output the per-face lip statistics of every frame with
+// faces, e.g. for TraceWriterCalculator.
+constexpr char kOutputStatistics[] = "LIP_STATISTICS";
+
+// (Optional) Output a CalculatorCheckpoint after every processed scene, and
+// restore from one given as input side packet.
+constexpr char kCheckpoint[] = "CHECKPOINT";
+
 // Lip contour landmarks.
 // Inner lip conrner
 const int32 kLipLeftInnerCornerIdx = 78;
@@ -98,6 +113,9 @@ struct LipSignal {
 //    output_stream: "DETECTIONS_SPEAKERS:active_speakers_detections"
 //    output_stream: "IS_SPEAKER_CHANGE:speaker_change"
 //    output_stream: "CONTOUR_INFORMATION_FRAME:contour_information_frames"
+//    output_stream: "ANNOTATIONS:speaker_annotations"
+//    output_stream: "LIP_STATISTICS:lip_statistics"
+//    output_stream: "CHECKPOINT:lip_track_checkpoint"
 //    options:{
 //      [mediapipe.autoflip.LipTrackCalculatorOptions.ext]: {
 //        output_shot_boundary: true
@@ -122,28 +140,38 @@ class LipTrackCalculator : public CalculatorBase {
     const std::vector<NormalizedLandmarkList>& landmark_lists, 
     int lip_left_corner, int lip_right_corner, const std::vector<int32>& lip_upper,
     const std::vector<int32>& lip_lower, std::vector<float>* lip_statistics); 
-  // Find match face from last frame. If not find, return -1, otherwise
-  // return the face index.
-  int MatchFace(const Detection& face_bbox);
-  // Convert Detection to opencv Rect
-  cv::Rect2f DetectionToRect(const Detection& bbox);
+  // Find match face from last frame, given the IOU of a face with each face
+  // of the last frame. If not find, return -1, otherwise return the face index.
+  int MatchFace(const float* ious);
+  // Append the relative bounding box of a detection to boxes.
+  void AddBox(const Detection& bbox, Boxes* boxes);
   // Determine whether the face is active speaker or not.
   ::mediapipe::Status IsActiveSpeaker(const std::deque<float>& face_lip_statistics_inner, 
                     const std::deque<float>& face_lip_statistics_outer, bool* is_speaker);
-  // Calculator the absolute Euclidean distance between two landmarks.
-  float GetDistance(const NormalizedLandmark& mark_1, const NormalizedLandmark& mark_2);
   // Calculator IOU of two face bboxes.
   float GetIOU(const Detection& bbox_1, const Detection& bbox_2);
   void GetMeanAndVariance(const std::deque<float>& face_lip_statistics,
                 float* mean, float* variance); 
   // Convert landmark to cv point2f.
   cv::Point2f LandmarkToPoint(const int idx, const NormalizedLandmarkList& landmark_list);
-  // Draws and outputs visualization frames if those streams are present.
+  // Outputs visualization frames and annotations if those streams are present.
+  ::mediapipe::Status OutputDebugSignals(
+                const std::vector<NormalizedLandmarkList>& input_landmark_lists,
+                const std::vector<Detection>& detected_bbox,
+                const std::vector<Detection>& active_speaker_bbox,
+                const cv::Mat& scene_frame, CalculatorContext* cc, int64 timestamp);
+  // Draws and outputs visualization frames.
   ::mediapipe::Status OutputVizFrames(
                 const std::vector<NormalizedLandmarkList>& input_landmark_lists,
                 const std::vector<Detection>& detected_bbox,
                 const std::vector<Detection>& active_speaker_bbox, 
                 const cv::Mat& scene_frame, CalculatorContext* cc, int64 timestamp);
+  // Outputs the lip points and face boxes as an OverlayAnnotation.
+  void OutputAnnotations(
+                const std::vector<NormalizedLandmarkList>& input_landmark_lists,
+                const std::vector<Detection>& detected_bbox,
+                const std::vector<Detection>& active_speaker_bbox,
+                CalculatorContext* cc, int64 timestamp);
   ::mediapipe::Status DrawLandMarksAndInfor(
       const std::vector<NormalizedLandmarkList>& landmark_lists,
       const cv::Scalar& landmark_color, 
@@ -152,11 +180,20 @@ class LipTrackCalculator : public CalculatorBase {
                const bool detected, const cv::Scalar& color, cv::Mat* viz_mat);  
   void Transmit(mediapipe::CalculatorContext* cc, bool is_speaker_change, int64 timestamp);
   ::mediapipe::Status ProcessScene(bool is_end_of_scene, ::mediapipe::CalculatorContext* cc);
+  // Outputs the state between two scenes as a checkpoint.
+  ::mediapipe::Status OutputCheckpoint(::mediapipe::CalculatorContext* cc);
+  ::mediapipe::Status RestoreCheckpoint(const CalculatorCheckpoint& checkpoint);
 
   // Calculator options.
   LipTrackCalculatorOptions options_;
   // Face bounding boxes in last frame.
   std::vector<Detection> face_bbox_;
+  // Scratch buffers of the lip and IOU kernels, reused across frames. The
+  // boxes and ious_ hold the face matching of the current frame only.
+  PointPairs lip_pairs_;
+  std::vector<float> lip_distances_;
+  Boxes cur_boxes_, pre_boxes_;
+  std::vector<float> ious_;
   // Face statistics in previous frames.
   std::map<int32, std::deque<float>> face_statistics_outer_;
   std::map<int32, std::deque<float>> face_statistics_inner_;
@@ -182,6 +219,9 @@ class LipTrackCalculator : public CalculatorBase {
   // Store the input signals.
   std::vector<LipSignal> signal_buff_;
   bool pre_stop_by_scene_change_;
+  // Inputs before this timestamp were processed before the checkpoint that
+  // this run is restored from.
+  Timestamp resume_timestamp_ = Timestamp::Unstarted();
 }; // end with inheritance
 
 REGISTER_CALCULATOR(LipTrackCalculator);
@@ -207,6 +247,18 @@ LipTrackCalculator::LipTrackCalculator() {}
   if (cc->Outputs().HasTag(kOutputContour)) {
     cc->Outputs().Tag(kOutputContour).Set<ImageFrame>();
   }
+  if (cc->Outputs().HasTag(kOutputAnnotations)) {
+    cc->Outputs().Tag(kOutputAnnotations).Set<OverlayAnnotation>();
+  }
+  if (cc->Outputs().HasTag(kOutputStatistics)) {
+    cc->Outputs().Tag(kOutputStatistics).Set<LipStatistics>();
+  }
+  if (cc->Outputs().HasTag(kCheckpoint)) {
+    cc->Outputs().Tag(kCheckpoint).Set<CalculatorCheckpoint>();
+  }
+  if (cc->InputSidePackets().HasTag(kCheckpoint)) {
+    cc->InputSidePackets().Tag(kCheckpoint).Set<CalculatorCheckpoint>().Optional();
+  }
 
   return ::mediapipe::OkStatus();
 }
@@ -218,12 +270,20 @@ LipTrackCalculator::LipTrackCalculator() {}
   last_sence_processed_timestamp_ = Timestamp(0);
   pre_dominate_speaker_id_ = -1;
   pre_stop_by_scene_change_ = false;
+  if (cc->InputSidePackets().HasTag(kCheckpoint) &&
+      !cc->InputSidePackets().Tag(kCheckpoint).IsEmpty()) {
+    MP_RETURN_IF_ERROR(RestoreCheckpoint(
+        cc->InputSidePackets().Tag(kCheckpoint).Get<CalculatorCheckpoint>()));
+  }
 
   return ::mediapipe::OkStatus();
 }
 
 ::mediapipe::Status LipTrackCalculator::Process(
     mediapipe::CalculatorContext* cc) {
+  if (cc->InputTimestamp() < resume_timestamp_) {
+    return ::mediapipe::OkStatus();
+  }
   // Processes a scene when shot boundary or time period is larger than min_speaker_span.
   bool is_end_of_scene = false;
   if (cc->Inputs().HasTag(kInputShotBoundaries) &&
@@ -237,6 +297,12 @@ LipTrackCalculator::LipTrackCalculator() {}
     || (!signal_buff_.empty() && is_end_of_scene);
   if (process_scene) {
     MP_RETURN_IF_ERROR(ProcessScene(is_end_of_scene, cc));
+    // Nothing of the processed scene is left but the last speaker, so this
+    // is where a later run can resume.
+    MP_RETURN_IF_ERROR(OutputCheckpoint(cc));
+  } else if (cc->Outputs().HasTag(kCheckpoint)) {
+    cc->Outputs().Tag(kCheckpoint).SetNextTimestampBound(
+        cc->InputTimestamp().NextAllowedInStream());
   }
 
   if (!cc->Inputs().Tag(kInputVideo).Value().IsEmpty()) {
@@ -250,7 +316,10 @@ LipTrackCalculator::LipTrackCalculator() {}
       frame_format_ = frame.Format();
     }
     LipSignal signal;
-    mediapipe::formats::MatView(&frame).copyTo(signal.frame);
+    // The frame is only needed to render CONTOUR_INFORMATION_FRAME.
+    if (cc->Outputs().HasTag(kOutputContour)) {
+      mediapipe::formats::MatView(&frame).copyTo(signal.frame);
+    }
     signal.timestamp = cc->InputTimestamp().Value();
 
     if (!cc->Inputs().Tag(kInputLandmark).Value().IsEmpty() && !cc->Inputs().Tag(kInputDetection).Value().IsEmpty()) {
@@ -310,11 +379,25 @@ LipTrackCalculator::LipTrackCalculator() {}
     MP_RETURN_IF_ERROR(GetStatistics(input_landmark_lists, kLipLeftOuterCornerIdx, kLipRightOuterCornerIdx,
     kLipOuterUpperIdx, kLipOuterLowerIdx, &statistics_outer));
 
+    // IOU of every face with every face of the last frame.
+    cur_boxes_.Clear();
+    pre_boxes_.Clear();
+    for (const auto& bbox : input_detections)
+      AddBox(bbox, &cur_boxes_);
+    for (const auto& bbox : face_bbox_)
+      AddBox(bbox, &pre_boxes_);
+    ious_.resize(cur_boxes_.size() * pre_boxes_.size());
+    OverlapMatrix(cur_boxes_, pre_boxes_, ious_.data());
+
+    // Only built for graphs that read it, e.g. the trace graphs.
+    std::unique_ptr<LipStatistics> lip_statistics;
+    if (cc->Outputs().HasTag(kOutputStatistics)) {
+      lip_statistics = ::absl::make_unique<LipStatistics>();
+    }
     int cur_speaker_id = -1;
     for (int cur_face_idx = 0; cur_face_idx < input_detections.size(); ++cur_face_idx) {
-      auto& bbox = input_detections[cur_face_idx];
       // Check whether the face appeared before
-      int previous_face_idx = MatchFace(bbox);
+      int previous_face_idx = MatchFace(&ious_[cur_face_idx * pre_boxes_.size()]);
       cur_face_statistics_inner.insert(std::pair< int32, std::deque<float> >(cur_face_idx, std::deque<float>()));
       cur_face_statistics_outer.insert(std::pair< int32, std::deque<float> >(cur_face_idx, std::deque<float>()));
       // If the face appeared, add the new data to the previous deque and update meta_faces.
@@ -360,7 +443,21 @@ LipTrackCalculator::LipTrackCalculator() {}
 
       if (is_active_speaker)
         cur_speaker_id = cur_face_idx;
+
+      if (lip_statistics) {
+        auto* face_statistics = lip_statistics->add_face();
+        face_statistics->set_face_index(cur_face_idx);
+        face_statistics->set_track_id(cur_meta_face_indices[cur_face_idx]);
+        face_statistics->set_inner_ratio(statistics_inner[cur_face_idx]);
+        face_statistics->set_outer_ratio(statistics_outer[cur_face_idx]);
+        face_statistics->set_is_active(is_active_speaker);
+      }
     } // end cur_face_idx
+
+    if (lip_statistics) {
+      cc->Outputs().Tag(kOutputStatistics).Add(lip_statistics.release(),
+                                               Timestamp(signal.timestamp));
+    }
       
     if (cur_speaker_id != -1) {
       int meta_face = cur_meta_face_indices[cur_speaker_id];
@@ -419,10 +516,9 @@ LipTrackCalculator::LipTrackCalculator() {}
       auto empty_detection = ::absl::make_unique<std::vector<Detection>>();
       auto& signal = signal_buff_[buff_position];
 
-      // Optionally output the visualization frames of lit contour and related information.
-      if (cc->Outputs().HasTag(kOutputContour)) 
-        MP_RETURN_IF_ERROR(OutputVizFrames(empty_landmarklist, *empty_detection.get(),
-          *empty_detection.get(), signal.frame, cc, signal.timestamp));
+      // Optionally output the visualization of lit contour and related information.
+      MP_RETURN_IF_ERROR(OutputDebugSignals(empty_landmarklist, *empty_detection.get(),
+        *empty_detection.get(), signal.frame, cc, signal.timestamp));
       
       cc->Outputs().Tag(kOutputROI).Add(empty_detection.release(), Timestamp(signal.timestamp));
     }
@@ -511,9 +607,8 @@ LipTrackCalculator::LipTrackCalculator() {}
     // Dominate speaker apears in this frame
     if (face_id != -1) {
       output_detection->push_back(detections[face_id]);
-      // Optionally output the visualization frames of lit contour and related information.
-      if (cc->Outputs().HasTag(kOutputContour)) 
-        MP_RETURN_IF_ERROR(OutputVizFrames(landmark_lists, detections, *output_detection.get(), signal.frame, cc, signal.timestamp));
+      // Optionally output the visualization of lit contour and related information.
+      MP_RETURN_IF_ERROR(OutputDebugSignals(landmark_lists, detections, *output_detection.get(), signal.frame, cc, signal.timestamp));
       // Update dominate_speaker_detection.
       dominate_speaker_detection[0] = detections[face_id];
     }
@@ -521,10 +616,9 @@ LipTrackCalculator::LipTrackCalculator() {}
       output_detection->push_back(dominate_speaker_detection[0]);
       std::vector<NormalizedLandmarkList> empty_landmarklist;
       std::vector<Detection> empty_detecton;
-      // Optionally output the visualization frames of lit contour and related information.
-      if (cc->Outputs().HasTag(kOutputContour)) 
-        MP_RETURN_IF_ERROR(OutputVizFrames(empty_landmarklist, 
-          empty_detecton, empty_detecton, signal.frame, cc, signal.timestamp));
+      // Optionally output the visualization of lit contour and related information.
+      MP_RETURN_IF_ERROR(OutputDebugSignals(empty_landmarklist, 
+        empty_detecton, empty_detecton, signal.frame, cc, signal.timestamp));
     }
 
     cc->Outputs().Tag(kOutputROI).Add(output_detection.release(), Timestamp(signal.timestamp));
@@ -543,26 +637,81 @@ LipTrackCalculator::LipTrackCalculator() {}
   return ::mediapipe::OkStatus(); 
 } 
 
-float LipTrackCalculator::GetDistance(const NormalizedLandmark& mark_1,
-                                      const NormalizedLandmark& mark_2) {                            
-  return std::sqrt(std::pow((mark_1.x()-mark_2.x())*frame_width_, 2) 
-  + std::pow((mark_1.y()-mark_2.y())*frame_height_, 2)
-  + std::pow(mark_1.z()-mark_2.z(), 2));
+::mediapipe::Status LipTrackCalculator::OutputCheckpoint(
+    ::mediapipe::CalculatorContext* cc) {
+  if (!cc->Outputs().HasTag(kCheckpoint)) {
+    return ::mediapipe::OkStatus();
+  }
+  LipTrackState state;
+  state.set_pre_dominate_speaker_id(pre_dominate_speaker_id_);
+  if (!pre_dominate_speaker_detection_.empty()) {
+    RET_CHECK(pre_dominate_speaker_detection_[0].SerializeToString(
+        state.mutable_pre_dominate_speaker_detection()));
+  }
+  state.set_last_shot_timestamp(last_shot_timestamp_.Value());
+  state.set_last_scene_processed_timestamp(
+      last_sence_processed_timestamp_.Value());
+  state.set_pre_stop_by_scene_change(pre_stop_by_scene_change_);
+
+  auto checkpoint = ::absl::make_unique<CalculatorCheckpoint>();
+  checkpoint->set_resume_timestamp_us(cc->InputTimestamp().Value());
+  RET_CHECK(state.SerializeToString(checkpoint->mutable_state()));
+  cc->Outputs().Tag(kCheckpoint).Add(checkpoint.release(), cc->InputTimestamp());
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status LipTrackCalculator::RestoreCheckpoint(
+    const CalculatorCheckpoint& checkpoint) {
+  LipTrackState state;
+  RET_CHECK(state.ParseFromString(checkpoint.state()))
+      << "Invalid LipTrackCalculator checkpoint.";
+  pre_dominate_speaker_id_ = state.pre_dominate_speaker_id();
+  pre_dominate_speaker_detection_.clear();
+  if (state.has_pre_dominate_speaker_detection()) {
+    Detection detection;
+    RET_CHECK(detection.ParseFromString(state.pre_dominate_speaker_detection()));
+    pre_dominate_speaker_detection_.push_back(detection);
+  }
+  last_shot_timestamp_ = Timestamp(state.last_shot_timestamp());
+  last_sence_processed_timestamp_ =
+      Timestamp(state.last_scene_processed_timestamp());
+  pre_stop_by_scene_change_ = state.pre_stop_by_scene_change();
+  resume_timestamp_ = Timestamp(checkpoint.resume_timestamp_us());
+  return ::mediapipe::OkStatus();
 }
 
 ::mediapipe::Status LipTrackCalculator::GetStatistics(const std::vector<NormalizedLandmarkList>& landmark_lists, 
                     int lip_left_corner, int lip_right_corner, const std::vector<int32>& lip_upper,
                     const std::vector<int32>& lip_lower, std::vector<float>* lip_statistics) {
-  float mouth_width = 0.0f, mouth_height = 0.0f;
+  // For each face, the first pair is the mouth width and the others are the
+  // mouth heights, so the distances of all faces are computed in one pass.
+  const int pairs_per_face = lip_upper.size() + 1;
+  const auto add_pair = [this](const NormalizedLandmarkList& landmark_list,
+                               int idx_1, int idx_2) {
+    const auto& mark_1 = landmark_list.landmark(idx_1);
+    const auto& mark_2 = landmark_list.landmark(idx_2);
+    lip_pairs_.Add(mark_1.x(), mark_1.y(), mark_1.z(), mark_2.x(), mark_2.y(), mark_2.z());
+  };
+  lip_pairs_.Clear();
   for (const auto& landmark_list : landmark_lists) {
     if (landmark_list.landmark_size() < kFaceMeshLandmarks){
       continue;
     }
-    mouth_width = GetDistance(landmark_list.landmark(lip_left_corner),
-                              landmark_list.landmark(lip_right_corner));
+    add_pair(landmark_list, lip_left_corner, lip_right_corner);
     for (auto i = 0; i < lip_upper.size(); ++i) {
-      mouth_height += GetDistance(landmark_list.landmark(lip_upper[i]),
-                              landmark_list.landmark(lip_lower[i]));
+      add_pair(landmark_list, lip_upper[i], lip_lower[i]);
+    }
+  }
+  lip_distances_.resize(lip_pairs_.size());
+  PairDistances(lip_pairs_, frame_width_, frame_height_, lip_distances_.data());
+
+  // As before, the height sum is not reset between faces, so a face starts
+  // from the average height of the previous one.
+  float mouth_height = 0.0f;
+  for (int first = 0; first < lip_pairs_.size(); first += pairs_per_face) {
+    const float mouth_width = lip_distances_[first];
+    for (int i = first + 1; i < first + pairs_per_face; ++i) {
+      mouth_height += lip_distances_[i];
     }
     // Average the height is better since it may need more points in the future.
     mouth_height /= (float)lip_upper.size();
@@ -572,12 +721,11 @@ float LipTrackCalculator::GetDistance(const NormalizedLandmark& mark_1,
   return ::mediapipe::OkStatus();
 }
 
-int LipTrackCalculator::MatchFace(const Detection& face_bbox) {
+int LipTrackCalculator::MatchFace(const float* ious) {
   int32 idx = -1;
   float iou = 0, maxi_iou = 0;
   for (auto i = 0; i < face_bbox_.size(); ++i) {
-    auto& bbox = face_bbox_[i];
-    iou = GetIOU(bbox, face_bbox);
+    iou = ious[i];
     if (iou < options_.iou_threshold())
       continue;
     if (iou > maxi_iou) {
@@ -588,24 +736,20 @@ int LipTrackCalculator::MatchFace(const Detection& face_bbox) {
   return idx;
 }
 
-cv::Rect2f LipTrackCalculator::DetectionToRect(const Detection& bbox) {
-  cv::Rect2f cv_bbox;
-  cv_bbox.x = bbox.location_data().relative_bounding_box().xmin();
-  cv_bbox.y = bbox.location_data().relative_bounding_box().ymin();
-  cv_bbox.width = bbox.location_data().relative_bounding_box().width();
-  cv_bbox.height = bbox.location_data().relative_bounding_box().height();
-
-  return cv_bbox;
+void LipTrackCalculator::AddBox(const Detection& bbox, Boxes* boxes) {
+  const auto& box = bbox.location_data().relative_bounding_box();
+  boxes->Add(box.xmin(), box.ymin(), box.width(), box.height());
 }
 
 float LipTrackCalculator::GetIOU(const Detection& bbox_1, const Detection& bbox_2) {
-  cv::Rect2f cv_bbox_1, cv_bbox_2, intersecting_region, union_region;
-  cv_bbox_1 = DetectionToRect(bbox_1);
-  cv_bbox_2 = DetectionToRect(bbox_2);
-
-  intersecting_region = cv_bbox_1 & cv_bbox_2;
-  union_region = cv_bbox_1 | cv_bbox_2;
-  return intersecting_region.area() / union_region.area();
+  // Local boxes, so that the face matching state in cur_boxes_ and
+  // pre_boxes_ stays intact wherever this is called.
+  Boxes boxes_1, boxes_2;
+  AddBox(bbox_1, &boxes_1);
+  AddBox(bbox_2, &boxes_2);
+  float iou;
+  OverlapMatrix(boxes_1, boxes_2, &iou);
+  return iou;
 }
 
 void LipTrackCalculator::GetMeanAndVariance(const std::deque<float>& face_lip_statistics,
@@ -674,6 +818,23 @@ void LipTrackCalculator::GetMeanAndVariance(const std::deque<float>& face_lip_st
   return ::mediapipe::OkStatus();
 }
 
+::mediapipe::Status LipTrackCalculator::OutputDebugSignals(
+    const std::vector<NormalizedLandmarkList>& input_landmark_lists,
+    const std::vector<Detection>& detected_bbox,
+    const std::vector<Detection>& active_speaker_bbox,
+    const cv::Mat& scene_frame, CalculatorContext* cc,
+    int64 timestamp) {
+  if (cc->Outputs().HasTag(kOutputContour)) {
+    MP_RETURN_IF_ERROR(OutputVizFrames(input_landmark_lists, detected_bbox,
+      active_speaker_bbox, scene_frame, cc, timestamp));
+  }
+  if (cc->Outputs().HasTag(kOutputAnnotations)) {
+    OutputAnnotations(input_landmark_lists, detected_bbox,
+      active_speaker_bbox, cc, timestamp);
+  }
+  return ::mediapipe::OkStatus();
+}
+
 ::mediapipe::Status LipTrackCalculator::OutputVizFrames(
     const std::vector<NormalizedLandmarkList>& input_landmark_lists,
     const std::vector<Detection>& detected_bbox,
@@ -701,6 +862,54 @@ void LipTrackCalculator::GetMeanAndVariance(const std::deque<float>& face_lip_st
   return ::mediapipe::OkStatus();
 }
 
+void LipTrackCalculator::OutputAnnotations(
+    const std::vector<NormalizedLandmarkList>& input_landmark_lists,
+    const std::vector<Detection>& detected_bbox,
+    const std::vector<Detection>& active_speaker_bbox,
+    CalculatorContext* cc, int64 timestamp) {
+  auto annotation = absl::make_unique<OverlayAnnotation>();
+  const auto set_color = [](const cv::Scalar& scalar, Color* color) {
+    color->set_r(scalar[0]);
+    color->set_g(scalar[1]);
+    color->set_b(scalar[2]);
+  };
+  const auto add_boxes = [&](const std::vector<Detection>& bboxes,
+                             const bool detected, const cv::Scalar& color) {
+    for (int i = 0; i < bboxes.size(); ++i) {
+      const auto& face = bboxes[i].location_data().relative_bounding_box();
+      auto* box = annotation->add_box();
+      box->mutable_location_normalized()->set_x(face.xmin());
+      box->mutable_location_normalized()->set_y(face.ymin());
+      box->mutable_location_normalized()->set_width(face.width());
+      box->mutable_location_normalized()->set_height(face.height());
+      set_color(color, box->mutable_color());
+      if (!detected) {
+        box->set_label(absl::StrCat("Face_", i));
+      }
+    }
+  };
+
+  if (!input_landmark_lists.empty()) {
+    for (const auto& landmark_list : input_landmark_lists) {
+      if (landmark_list.landmark_size() < kFaceMeshLandmarks) {
+        continue;
+      }
+      for (const auto* contour : {&kLipInnerContourIdx, &kLipOuterContourIdx}) {
+        for (const auto idx : *contour) {
+          auto* point = annotation->add_point();
+          point->set_x(landmark_list.landmark(idx).x());
+          point->set_y(landmark_list.landmark(idx).y());
+          set_color(kGreen, point->mutable_color());
+        }
+      }
+    }
+    add_boxes(detected_bbox, false, kGreen);
+    add_boxes(active_speaker_bbox, true, kRed);
+  }
+
+  cc->Outputs().Tag(kOutputAnnotations).Add(annotation.release(), Timestamp(timestamp));
+}
+
 cv::Point2f LipTrackCalculator::LandmarkToPoint(const int idx, 
                 const NormalizedLandmarkList& landmark_list) {
   return cv::Point2f(landmark_list.landmark(idx).x()*frame_width_, 
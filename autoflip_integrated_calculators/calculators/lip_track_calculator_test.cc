@@ -42,6 +42,9 @@ constexpr char kInputLandmark[] = "LANDMARKS";
 constexpr char kInputROI[] = "DETECTIONS";
 constexpr char kOutputROI[] = "DETECTIONS_SPEAKERS";
 constexpr char kOutputShot[] = "IS_SPEAKER_CHANGE";
+constexpr char kOutputAnnotations[] = "ANNOTATIONS";
+constexpr char kOutputStatistics[] = "LIP_STATISTICS";
+constexpr char kCheckpoint[] = "CHECKPOINT";
 
 const int32 kImagewidth = 800; 
 const int32 kImageheight = 600;
@@ -297,6 +300,93 @@ TEST(LipTrackCalculatorTest, SpeakerSpanAndClose) {
   CheckOutputs(scene_num, gt_output_nums, output, runner.get());
 }
 
+// Check annotation output. Two frames, one landmarksList (face), one speaker
+TEST(LipTrackCalculatorTest, Annotations) {
+  auto config = MakeConfig(kConfig, 2, 3000);
+  config.add_output_stream("ANNOTATIONS:speaker_annotations");
+  auto runner = ::absl::make_unique<CalculatorRunner>(config);
+  SetInputs(kLandmaksValueTwoSame, kTimeStampTwo, kRoiValueTwoSame, runner.get());
+  MP_ASSERT_OK(runner->Run());
+
+  const std::vector<Packet>& output_annotations =
+      runner->Outputs().Tag(kOutputAnnotations).packets;
+  ASSERT_EQ(2, output_annotations.size());
+  for (const auto& packet : output_annotations) {
+    const auto& annotation = packet.Get<OverlayAnnotation>();
+    // Inner and outer lip contours of one face.
+    EXPECT_EQ(kInnerLandmarksIdx.size() + kOuterLandmarksIdx.size(),
+              annotation.point_size());
+    // Detected face and active speaker.
+    ASSERT_EQ(2, annotation.box_size());
+    EXPECT_EQ("Face_0", annotation.box(0).label());
+    EXPECT_FLOAT_EQ(kRoiValueTwoSame[0][0],
+                    annotation.box(1).location_normalized().x());
+    EXPECT_EQ(255, annotation.box(1).color().r());
+  }
+}
+
+// Check lip statistics output. Two frames with one open mouth each.
+TEST(LipTrackCalculatorTest, LipStatistics) {
+  auto config = MakeConfig(kConfig, 2, 3000);
+  config.add_output_stream("LIP_STATISTICS:lip_statistics");
+  auto runner = ::absl::make_unique<CalculatorRunner>(config);
+  SetInputs(kLandmaksValueTwoSame, kTimeStampTwo, kRoiValueTwoSame, runner.get());
+  MP_ASSERT_OK(runner->Run());
+
+  const std::vector<Packet>& output_statistics =
+      runner->Outputs().Tag(kOutputStatistics).packets;
+  ASSERT_EQ(2, output_statistics.size());
+  for (int i = 0; i < output_statistics.size(); ++i) {
+    EXPECT_EQ(Timestamp(kTimeStampTwo[i]), output_statistics[i].Timestamp());
+    const auto& statistics = output_statistics[i].Get<LipStatistics>();
+    ASSERT_EQ(1, statistics.face_size());
+    EXPECT_EQ(0, statistics.face(0).face_index());
+    // The face of the second frame matches the one of the first frame.
+    EXPECT_EQ(0, statistics.face(0).track_id());
+    EXPECT_GT(statistics.face(0).inner_ratio(), 0);
+    EXPECT_GT(statistics.face(0).outer_ratio(), 0);
+  }
+}
+
+// Check checkpoint output and restore. The run restored from the checkpoint
+// after the first frame outputs the same speaker and speaker change for the
+// second frame as the full run.
+TEST(LipTrackCalculatorTest, ResumesFromCheckpoint) {
+  auto config = MakeConfig(kConfig, 1);
+  config.add_output_stream("CHECKPOINT:checkpoint");
+  config.add_input_side_packet("CHECKPOINT:restored_checkpoint");
+  auto full_run = ::absl::make_unique<CalculatorRunner>(config);
+  SetInputs(kLandmaksValueTwoSame, kTimeStampTwo, kRoiValueTwoDiff, full_run.get());
+  MP_ASSERT_OK(full_run->Run());
+
+  const std::vector<Packet>& checkpoints =
+      full_run->Outputs().Tag(kCheckpoint).packets;
+  ASSERT_EQ(1, checkpoints.size());
+  const auto& checkpoint = checkpoints[0].Get<CalculatorCheckpoint>();
+  EXPECT_EQ(kTimeStampTwo[1], checkpoint.resume_timestamp_us());
+
+  auto resumed_run = ::absl::make_unique<CalculatorRunner>(config);
+  resumed_run->MutableSidePackets()->Tag(kCheckpoint) =
+      MakePacket<CalculatorCheckpoint>(checkpoint);
+  SetInputs(kLandmaksValueTwoSame, kTimeStampTwo, kRoiValueTwoDiff, resumed_run.get());
+  MP_ASSERT_OK(resumed_run->Run());
+
+  const std::vector<Packet>& output_rois =
+      resumed_run->Outputs().Tag(kOutputROI).packets;
+  ASSERT_EQ(1, output_rois.size());
+  EXPECT_EQ(Timestamp(kTimeStampTwo[1]), output_rois[0].Timestamp());
+  const auto& speakers = output_rois[0].Get<std::vector<Detection>>();
+  ASSERT_EQ(1, speakers.size());
+  EXPECT_FLOAT_EQ(kRoiValueTwoDiff[1][0],
+                  speakers[0].location_data().relative_bounding_box().xmin());
+
+  // The speaker of the restored scene differs from the new one.
+  const std::vector<Packet>& output_shot_boundary =
+      resumed_run->Outputs().Tag(kOutputShot).packets;
+  ASSERT_EQ(1, output_shot_boundary.size());
+  EXPECT_TRUE(output_shot_boundary[0].Get<bool>());
+}
+
 }  // namespace
 }  // namespace autoflip
 }  // namespace mediapipe
@@ -0,0 +1,102 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/live_latency_budget.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "mediapipe/calculators/core/flow_limiter_calculator.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/adaptive_thinner_calculator.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_track_calculator.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/scene_cropping_calculator.pb.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/ret_check.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kFlowLimiter[] = "FlowLimiterCalculator";
+constexpr char kSceneCropping[] = "SceneCroppingCalculator";
+constexpr char kLipTrack[] = "LipTrackCalculator";
+constexpr char kAdaptiveThinner[] = "AdaptiveThinnerCalculator";
+
+// Shares of the budget, see the header.
+constexpr double kSpeakerShare = 0.4;
+constexpr double kSceneShare = 0.4;
+
+constexpr int kMinBudgetFrames = 5;
+
+std::vector<CalculatorGraphConfig::Node*> NodesOf(
+    const std::string& calculator, CalculatorGraphConfig* config) {
+  std::vector<CalculatorGraphConfig::Node*> nodes;
+  for (auto& node : *config->mutable_node()) {
+    if (node.calculator() == calculator) {
+      nodes.push_back(&node);
+    }
+  }
+  return nodes;
+}
+
+}  // namespace
+
+::mediapipe::Status ApplyLatencyBudget(double budget_seconds, double fps,
+                                       CalculatorGraphConfig* config) {
+  RET_CHECK_GT(fps, 0);
+  const int budget_frames = std::floor(budget_seconds * fps);
+  RET_CHECK_GE(budget_frames, kMinBudgetFrames)
+      << "A budget of " << budget_seconds << " s holds only " << budget_frames
+      << " frames at " << fps << " fps.";
+
+  const auto limiters = NodesOf(kFlowLimiter, config);
+  RET_CHECK_EQ(limiters.size(), 1)
+      << "Graph must have exactly one " << kFlowLimiter << " node.";
+  const auto croppers = NodesOf(kSceneCropping, config);
+  RET_CHECK_EQ(croppers.size(), 1)
+      << "Graph must have exactly one " << kSceneCropping << " node.";
+
+  auto* limiter_options = limiters[0]->mutable_options()->MutableExtension(
+      FlowLimiterCalculatorOptions::ext);
+  limiter_options->set_max_in_flight(budget_frames);
+  limiter_options->set_max_in_queue(0);
+
+  croppers[0]
+      ->mutable_options()
+      ->MutableExtension(SceneCroppingCalculatorOptions::ext)
+      ->set_max_scene_size(
+          std::max(1, static_cast<int>(budget_frames * kSceneShare)));
+
+  const int64 speaker_span_us =
+      std::llround(budget_seconds * kSpeakerShare * 1000000);
+  for (auto* node : NodesOf(kLipTrack, config)) {
+    node->mutable_options()
+        ->MutableExtension(LipTrackCalculatorOptions::ext)
+        ->set_min_speaker_span(speaker_span_us);
+  }
+  for (auto* node : NodesOf(kAdaptiveThinner, config)) {
+    auto* options = node->mutable_options()->MutableExtension(
+        AdaptiveThinnerCalculatorOptions::ext);
+    options->set_max_period_us(
+        std::min(options->max_period_us(), speaker_span_us));
+    options->set_min_period_us(
+        std::min(options->min_period_us(), options->max_period_us()));
+  }
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,44 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_LIVE_LATENCY_BUDGET_H_
+#define MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_LIVE_LATENCY_BUDGET_H_
+
+#include "mediapipe/framework/calculator.pb.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// Sets the nodes of a live graph, such as autoflip_graph_live.pbtxt, that
+// hold frames back so that a frame arriving at |fps| leaves the graph within
+// |budget_seconds|. The budget is split as follows:
+//  - 40% for the speaker decision: min_speaker_span of LipTrackCalculator,
+//    and max_period_us of AdaptiveThinnerCalculator, so that each decision
+//    sees at least one key frame;
+//  - 40% for the scene buffer: max_scene_size of SceneCroppingCalculator;
+//  - the rest for processing.
+// max_in_flight of FlowLimiterCalculator is set to the frames of the whole
+// budget, and max_in_queue to 0, so that frames beyond it are dropped.
+//
+// Fails unless |config| has exactly one FlowLimiterCalculator and one
+// SceneCroppingCalculator node, or if the budget holds fewer than 5 frames.
+// LipTrackCalculator and AdaptiveThinnerCalculator nodes are optional.
+::mediapipe::Status ApplyLatencyBudget(double budget_seconds, double fps,
+                                       CalculatorGraphConfig* config);
+
+}  // namespace autoflip
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_LIVE_LATENCY_BUDGET_H_
@@ -0,0 +1,121 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/live_latency_budget.h"
+
+#include "mediapipe/calculators/core/flow_limiter_calculator.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/adaptive_thinner_calculator.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/lip_track_calculator.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/scene_cropping_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kGraph[] = R"(
+    input_stream: "input_video"
+    node {
+      calculator: "FlowLimiterCalculator"
+      input_stream: "input_video"
+      input_stream: "FINISHED:cropped_frames"
+      input_stream_info: { tag_index: "FINISHED" back_edge: true }
+      output_stream: "video_raw"
+    }
+    node {
+      calculator: "AdaptiveThinnerCalculator"
+      input_stream: "VIDEO:0:video_raw"
+      output_stream: "VIDEO:0:video_raw_downsampled"
+      options: {
+        [mediapipe.autoflip.AdaptiveThinnerCalculatorOptions.ext]: {
+          min_period_us: 66666
+          max_period_us: 1000000
+        }
+      }
+    }
+    node {
+      calculator: "LipTrackCalculator"
+      input_stream: "VIDEO:video_raw_downsampled"
+      output_stream: "IS_SPEAKER_CHANGE:speaker_change"
+    }
+    node {
+      calculator: "SceneCroppingCalculator"
+      input_stream: "VIDEO_FRAMES:video_raw"
+      output_stream: "CROPPED_FRAMES:cropped_frames"
+      options: {
+        [mediapipe.autoflip.SceneCroppingCalculatorOptions.ext]: {
+          max_scene_size: 600
+        }
+      }
+    }
+    output_stream: "cropped_frames")";
+
+TEST(LiveLatencyBudgetTest, SplitsTheBudget) {
+  auto config = ParseTextProtoOrDie<CalculatorGraphConfig>(kGraph);
+  MP_ASSERT_OK(ApplyLatencyBudget(1.0, 30, &config));
+
+  const auto& limiter =
+      config.node(0).options().GetExtension(FlowLimiterCalculatorOptions::ext);
+  EXPECT_EQ(30, limiter.max_in_flight());
+  EXPECT_EQ(0, limiter.max_in_queue());
+  const auto& thinner = config.node(1).options().GetExtension(
+      AdaptiveThinnerCalculatorOptions::ext);
+  EXPECT_EQ(400000, thinner.max_period_us());
+  EXPECT_EQ(66666, thinner.min_period_us());
+  EXPECT_EQ(400000, config.node(2)
+                        .options()
+                        .GetExtension(LipTrackCalculatorOptions::ext)
+                        .min_speaker_span());
+  EXPECT_EQ(12, config.node(3)
+                    .options()
+                    .GetExtension(SceneCroppingCalculatorOptions::ext)
+                    .max_scene_size());
+}
+
+TEST(LiveLatencyBudgetTest, ShortBudgetLowersTheMinimumPeriod) {
+  auto config = ParseTextProtoOrDie<CalculatorGraphConfig>(kGraph);
+  MP_ASSERT_OK(ApplyLatencyBudget(0.125, 60, &config));
+
+  const auto& thinner = config.node(1).options().GetExtension(
+      AdaptiveThinnerCalculatorOptions::ext);
+  EXPECT_EQ(50000, thinner.max_period_us());
+  EXPECT_EQ(50000, thinner.min_period_us());
+  EXPECT_EQ(2, config.node(3)
+                   .options()
+                   .GetExtension(SceneCroppingCalculatorOptions::ext)
+                   .max_scene_size());
+}
+
+TEST(LiveLatencyBudgetTest, RejectsBudgetsOfTooFewFrames) {
+  auto config = ParseTextProtoOrDie<CalculatorGraphConfig>(kGraph);
+  EXPECT_FALSE(ApplyLatencyBudget(0.1, 30, &config).ok());
+  EXPECT_FALSE(ApplyLatencyBudget(1.0, 0, &config).ok());
+}
+
+TEST(LiveLatencyBudgetTest, RequiresLimiterAndCropper) {
+  auto config = ParseTextProtoOrDie<CalculatorGraphConfig>(kGraph);
+  config.mutable_node()->DeleteSubrange(0, 1);
+  EXPECT_FALSE(ApplyLatencyBudget(1.0, 30, &config).ok());
+
+  config = ParseTextProtoOrDie<CalculatorGraphConfig>(kGraph);
+  config.mutable_node()->DeleteSubrange(3, 1);
+  EXPECT_FALSE(ApplyLatencyBudget(1.0, 30, &config).ok());
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -16,12 +16,14 @@
 
 #include "absl/memory/memory.h"
 #include "absl/types/span.h"
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
 #include "mediapipe/examples/desktop/autoflip/calculators/pad_lapped_tensor_buffer_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/framework/profiler/circular_buffer.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/framework/types.h"
@@ -33,6 +35,7 @@ const char kBufferSize[] = "BUFFER_SIZE";
 const char kOverlap[] = "OVERLAP";
 const char kTimestampOffset[] = "TIMESTAMP_OFFSET";
 const char kCalculatorOptions[] = "CALCULATOR_OPTIONS";
+const char kCheckpoint[] = "CHECKPOINT";
 const int kNumOfPadding = 25;
 const int kPaddingAdjust = 50;
 
@@ -57,12 +60,18 @@ namespace tf = tensorflow;
 // calculator has the padding setting. It will pad before the video with the first
 // frame and pad after the video with the last frame. 
 //
+// If the optional CHECKPOINT output stream is connected, the buffer is
+// emitted as an autoflip::CalculatorCheckpoint after every output batch. A
+// run restored from the optional CHECKPOINT input side packet continues with
+// that buffer and drops the inputs that were already buffered.
+//
 // Example config:
 // node {
 //   calculator: "PadLappedTensorBufferCalculator"
 //   input_stream: "input_tensor"
 //   output_stream: "output_tensor"
 //   output_stream: "output_timestamp"
+//   output_stream: "CHECKPOINT:checkpoint"  (optional)
 //   options {
 //     [mediapipe.LappedTensorBufferCalculatorOptions.ext] {
 //       buffer_size: 100
@@ -86,12 +95,19 @@ class PadLappedTensorBufferCalculator : public CalculatorBase {
   // calculator options.
   ::mediapipe::Status AddBatchDimension(tf::Tensor* input_tensor);
   ::mediapipe::Status ProcessBuffer(CalculatorContext* cc);
+  // Outputs the buffer as a checkpoint if the CHECKPOINT stream is connected.
+  ::mediapipe::Status OutputCheckpoint(CalculatorContext* cc);
+  // Restores the buffer from a checkpoint.
+  ::mediapipe::Status RestoreCheckpoint(
+      const autoflip::CalculatorCheckpoint& checkpoint);
 
   int steps_until_output_;
   int buffer_size_;
   int overlap_;
   int timestamp_offset_;
   int num_of_frames_;
+  // Inputs before this timestamp are already in the restored buffer.
+  Timestamp resume_timestamp_ = Timestamp::Unstarted();
 
   std::unique_ptr<CircularBuffer<Timestamp>> timestamp_buffer_;
   std::unique_ptr<CircularBuffer<tf::Tensor>> buffer_;
@@ -107,8 +123,17 @@ REGISTER_CALCULATOR(PadLappedTensorBufferCalculator);
   cc->Inputs().Index(0).Set<tf::Tensor>(
       // tensorflow::Tensor stream.
   );
-  RET_CHECK_EQ(cc->Outputs().NumEntries(), 2)
+  RET_CHECK_EQ(cc->Outputs().NumEntries(""), 2)
       << "Only two outputs stream is supported.";
+  if (cc->Outputs().HasTag(kCheckpoint)) {
+    cc->Outputs().Tag(kCheckpoint).Set<autoflip::CalculatorCheckpoint>();
+  }
+  if (cc->InputSidePackets().HasTag(kCheckpoint)) {
+    cc->InputSidePackets()
+        .Tag(kCheckpoint)
+        .Set<autoflip::CalculatorCheckpoint>()
+        .Optional();
+  }
 
   if (cc->InputSidePackets().HasTag(kBufferSize)) {
     cc->InputSidePackets().Tag(kBufferSize).Set<int>();
@@ -163,12 +188,22 @@ REGISTER_CALCULATOR(PadLappedTensorBufferCalculator);
   buffer_ = absl::make_unique<CircularBuffer<tf::Tensor>>(buffer_size_);
   steps_until_output_ = buffer_size_ - kNumOfPadding;
   num_of_frames_ = 0;
+  if (cc->InputSidePackets().HasTag(kCheckpoint) &&
+      !cc->InputSidePackets().Tag(kCheckpoint).IsEmpty()) {
+    MP_RETURN_IF_ERROR(RestoreCheckpoint(
+        cc->InputSidePackets()
+            .Tag(kCheckpoint)
+            .Get<autoflip::CalculatorCheckpoint>()));
+  }
 
   return ::mediapipe::OkStatus();
 }
 
 ::mediapipe::Status PadLappedTensorBufferCalculator::Process(
     CalculatorContext* cc) {
+  if (cc->InputTimestamp() < resume_timestamp_) {
+    return ::mediapipe::OkStatus();
+  }
   // These are cheap, shallow copies.
   tensorflow::Tensor input_tensor(
       cc->Inputs().Index(0).Get<tensorflow::Tensor>());
@@ -187,12 +222,23 @@ REGISTER_CALCULATOR(PadLappedTensorBufferCalculator);
   timestamp_buffer_->push_back(cc->InputTimestamp());
   --steps_until_output_;
 
+  bool is_output = false;
   if (steps_until_output_ <= 0) {
     MP_RETURN_IF_ERROR(ProcessBuffer(cc));
+    is_output = true;
   }
 
   num_of_frames_ ++;
 
+  if (cc->Outputs().HasTag(kCheckpoint)) {
+    if (is_output) {
+      MP_RETURN_IF_ERROR(OutputCheckpoint(cc));
+    } else {
+      cc->Outputs().Tag(kCheckpoint).SetNextTimestampBound(
+          cc->InputTimestamp().NextAllowedInStream());
+    }
+  }
+
   return ::mediapipe::OkStatus();
 }
 
@@ -260,4 +306,49 @@ REGISTER_CALCULATOR(PadLappedTensorBufferCalculator);
   return ::mediapipe::OkStatus();
 }
 
+::mediapipe::Status PadLappedTensorBufferCalculator::OutputCheckpoint(
+    CalculatorContext* cc) {
+  PadLappedTensorBufferState state;
+  state.set_steps_until_output(steps_until_output_);
+  state.set_num_of_frames(num_of_frames_);
+  auto timestamp = timestamp_buffer_->begin();
+  for (auto tensor = buffer_->begin(); tensor != buffer_->end();
+       ++tensor, ++timestamp) {
+    tf::TensorProto proto;
+    tensor->AsProtoTensorContent(&proto);
+    RET_CHECK(proto.SerializeToString(state.add_tensor()));
+    state.add_timestamp(timestamp->Value());
+  }
+  auto checkpoint = ::absl::make_unique<autoflip::CalculatorCheckpoint>();
+  checkpoint->set_resume_timestamp_us(
+      cc->InputTimestamp().NextAllowedInStream().Value());
+  RET_CHECK(state.SerializeToString(checkpoint->mutable_state()));
+  cc->Outputs().Tag(kCheckpoint).Add(checkpoint.release(),
+                                     cc->InputTimestamp());
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status PadLappedTensorBufferCalculator::RestoreCheckpoint(
+    const autoflip::CalculatorCheckpoint& checkpoint) {
+  PadLappedTensorBufferState state;
+  RET_CHECK(state.ParseFromString(checkpoint.state()))
+      << "Invalid PadLappedTensorBufferCalculator checkpoint.";
+  RET_CHECK_EQ(state.tensor_size(), state.timestamp_size());
+  RET_CHECK_LE(state.tensor_size(), buffer_size_)
+      << "Checkpoint of a different buffer_size.";
+  for (int i = 0; i < state.tensor_size(); ++i) {
+    tf::TensorProto proto;
+    tf::Tensor tensor;
+    RET_CHECK(proto.ParseFromString(state.tensor(i)) &&
+              tensor.FromProto(proto))
+        << "Invalid tensor in PadLappedTensorBufferCalculator checkpoint.";
+    buffer_->push_back(tensor);
+    timestamp_buffer_->push_back(Timestamp(state.timestamp(i)));
+  }
+  steps_until_output_ = state.steps_until_output();
+  num_of_frames_ = state.num_of_frames();
+  resume_timestamp_ = Timestamp(checkpoint.resume_timestamp_us());
+  return ::mediapipe::OkStatus();
+}
+
 }  // namespace mediapipe
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "absl/memory/memory.h"
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
 #include "mediapipe/examples/desktop/autoflip/calculators/pad_lapped_tensor_buffer_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/calculator_runner.h"
@@ -28,6 +29,7 @@ namespace {
 
 const int kNumOfPadding = 25;
 const int kFramesPerProcess = 50;
+constexpr char kCheckpoint[] = "CHECKPOINT";
 
 namespace tf = ::tensorflow;
 
@@ -46,6 +48,17 @@ class PadLappedTensorBufferCalculatorTest : public ::testing::Test {
   std::unique_ptr<CalculatorRunner> runner_;
 };
 
+std::unique_ptr<CalculatorRunner> MakeCheckpointRunner() {
+  CalculatorGraphConfig::Node config;
+  config.set_calculator("PadLappedTensorBufferCalculator");
+  config.add_input_stream("input_tensor");
+  config.add_output_stream("output_tensor");
+  config.add_output_stream("output_timestamp");
+  config.add_output_stream("CHECKPOINT:checkpoint");
+  config.add_input_side_packet("CHECKPOINT:restored_checkpoint");
+  return ::absl::make_unique<CalculatorRunner>(config);
+}
+
 void SetupInputs(const int num_timesteps, CalculatorRunner* runner) {
     for (int i = 0; i < num_timesteps; ++i) {
     auto input = ::absl::make_unique<tensorflow::Tensor>(
@@ -192,5 +205,45 @@ TEST_F(PadLappedTensorBufferCalculatorTest, LargeInput) {
   CheckOutputs(num_output, runner_.get());
 }
 
+TEST(PadLappedTensorBufferCalculatorCheckpointTest, ResumesFromCheckpoint) {
+  const int num_timesteps = 150;
+  auto full_run = MakeCheckpointRunner();
+  SetupInputs(num_timesteps, full_run.get());
+  ASSERT_TRUE(full_run->Run().ok());
+  const auto& checkpoints = full_run->Outputs().Tag(kCheckpoint).packets;
+  // One checkpoint per batch that is output before Close.
+  ASSERT_EQ(2, checkpoints.size());
+  const auto& checkpoint =
+      checkpoints[0].Get<autoflip::CalculatorCheckpoint>();
+  EXPECT_EQ(kFramesPerProcess + kNumOfPadding,
+            checkpoint.resume_timestamp_us());
+
+  // The restored run gets the whole input again, and outputs the same
+  // batches as the full run after the checkpoint.
+  auto resumed_run = MakeCheckpointRunner();
+  resumed_run->MutableSidePackets()->Tag(kCheckpoint) =
+      MakePacket<autoflip::CalculatorCheckpoint>(checkpoint);
+  SetupInputs(num_timesteps, resumed_run.get());
+  ASSERT_TRUE(resumed_run->Run().ok());
+
+  const auto& expected = full_run->Outputs().Index(1).packets;
+  const auto& actual = resumed_run->Outputs().Index(1).packets;
+  ASSERT_EQ(expected.size() - 1, actual.size());
+  for (int i = 0; i < actual.size(); ++i) {
+    EXPECT_EQ(expected[i + 1].Timestamp(), actual[i].Timestamp());
+    EXPECT_EQ(expected[i + 1].Get<std::vector<Timestamp>>(),
+              actual[i].Get<std::vector<Timestamp>>());
+    const auto& expected_tensor =
+        full_run->Outputs().Index(0).packets[i + 1].Get<tf::Tensor>();
+    const auto& actual_tensor =
+        resumed_run->Outputs().Index(0).packets[i].Get<tf::Tensor>();
+    ASSERT_EQ(expected_tensor.NumElements(), actual_tensor.NumElements());
+    for (int j = 0; j < actual_tensor.NumElements(); ++j) {
+      EXPECT_EQ(expected_tensor.flat<float>()(j),
+                actual_tensor.flat<float>()(j));
+    }
+  }
+}
+
 }  // namespace
 }  // namespace mediapipe
@@ -0,0 +1,176 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/perf_baseline.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "mediapipe/framework/port/integral_types.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+std::string Prefix(const PerfMeasurement& measurement) {
+  return absl::StrCat(measurement.case_name(), " ", measurement.graph(), ": ");
+}
+
+int ToFrame(int64 timestamp_us, double fps) {
+  return static_cast<int>(std::round(timestamp_us * fps / 1000000.0));
+}
+
+bool IsComplete(const PerfMeasurement& measurement) {
+  return measurement.has_first_crop_latency_ms() &&
+         std::isfinite(measurement.first_crop_latency_ms()) &&
+         std::isfinite(measurement.frames_per_second());
+}
+
+}  // namespace
+
+void CheckMeasurement(const PerfMeasurement& measurement,
+                      std::vector<std::string>* failures) {
+  if (!measurement.has_first_crop_latency_ms()) {
+    failures->push_back(
+        absl::StrCat(Prefix(measurement), "no crop emitted"));
+  } else if (!std::isfinite(measurement.first_crop_latency_ms())) {
+    failures->push_back(absl::StrFormat("%sfirst crop after %f ms",
+                                        Prefix(measurement),
+                                        measurement.first_crop_latency_ms()));
+  }
+  if (!std::isfinite(measurement.frames_per_second())) {
+    failures->push_back(absl::StrFormat("%s%f fps", Prefix(measurement),
+                                        measurement.frames_per_second()));
+  }
+}
+
+void CompareToBaseline(const PerfBaseline& baseline,
+                       const PerfBaseline& measured, double tolerance,
+                       std::vector<std::string>* failures) {
+  std::map<std::pair<std::string, std::string>, const PerfMeasurement*>
+      baseline_of;
+  for (const auto& measurement : baseline.measurement()) {
+    baseline_of[{measurement.case_name(), measurement.graph()}] =
+        &measurement;
+  }
+  for (const auto& measurement : measured.measurement()) {
+    const auto found =
+        baseline_of.find({measurement.case_name(), measurement.graph()});
+    if (found == baseline_of.end()) {
+      continue;
+    }
+    const PerfMeasurement& base = *found->second;
+    if (!IsComplete(base)) {
+      failures->push_back(absl::StrCat(Prefix(measurement),
+                                       "invalid baseline, update it"));
+      continue;
+    }
+    if (!IsComplete(measurement)) {
+      failures->push_back(absl::StrCat(Prefix(measurement),
+                                       "incomplete measurement, no "
+                                       "comparison with the baseline"));
+      continue;
+    }
+    if (measurement.frames_per_second() <
+        base.frames_per_second() * (1 - tolerance)) {
+      failures->push_back(absl::StrFormat(
+          "%s%.1f fps, baseline %.1f fps", Prefix(measurement),
+          measurement.frames_per_second(), base.frames_per_second()));
+    }
+    if (measurement.first_crop_latency_ms() >
+        base.first_crop_latency_ms() * (1 + tolerance)) {
+      failures->push_back(absl::StrFormat(
+          "%sfirst crop after %.0f ms, baseline %.0f ms", Prefix(measurement),
+          measurement.first_crop_latency_ms(), base.first_crop_latency_ms()));
+    }
+    if (measurement.peak_rss_kb() > base.peak_rss_kb() * (1 + tolerance)) {
+      failures->push_back(absl::StrFormat(
+          "%speak RSS %d kB, baseline %d kB", Prefix(measurement),
+          measurement.peak_rss_kb(), base.peak_rss_kb()));
+    }
+  }
+}
+
+void CheckGroundTruth(const SyntheticVideoGroundTruth& truth,
+                      const PerfMeasurement& measurement,
+                      int tolerance_frames, float speaker_tolerance,
+                      std::vector<std::string>* failures) {
+  std::vector<int> detected;
+  for (const int64 timestamp_us : measurement.shot_change_us()) {
+    detected.push_back(ToFrame(timestamp_us, truth.fps()));
+  }
+  std::vector<int> cuts;
+  for (const auto& shot : truth.shot()) {
+    cuts.push_back(shot.first_frame());
+  }
+  const auto near = [tolerance_frames](int a, int b) {
+    return std::abs(a - b) <= tolerance_frames;
+  };
+  // The first frame is no cut, but detectors may report it as one.
+  for (int i = 1; i < cuts.size(); ++i) {
+    bool found = false;
+    for (const int frame : detected) {
+      found |= near(frame, cuts[i]);
+    }
+    if (!found) {
+      failures->push_back(absl::StrFormat("%smissed the cut at frame %d",
+                                          Prefix(measurement), cuts[i]));
+    }
+  }
+  for (const int frame : detected) {
+    bool found = false;
+    for (const int cut : cuts) {
+      found |= near(frame, cut);
+    }
+    if (!found) {
+      failures->push_back(absl::StrFormat("%sshot change at frame %d is no cut",
+                                          Prefix(measurement), frame));
+    }
+  }
+
+  if (!measurement.has_speakers()) {
+    return;
+  }
+  for (const auto& shot : truth.shot()) {
+    if (shot.scene() != SyntheticVideoGroundTruth::Shot::TALKING_FACES) {
+      continue;
+    }
+    int num_speakers = 0;
+    int num_correct = 0;
+    for (const auto& speaker : measurement.speaker()) {
+      const int frame = ToFrame(speaker.timestamp_us(), truth.fps());
+      if (frame < shot.first_frame() ||
+          frame >= shot.first_frame() + shot.num_frames()) {
+        continue;
+      }
+      ++num_speakers;
+      num_correct += std::abs(speaker.center_x() - shot.speaker_center_x()) <=
+                     speaker_tolerance;
+    }
+    if (2 * num_correct <= num_speakers || num_speakers == 0) {
+      failures->push_back(absl::StrFormat(
+          "%s%d of %d active speakers of the shot at frame %d on the talking "
+          "face",
+          Prefix(measurement), num_correct, num_speakers,
+          shot.first_frame()));
+    }
+  }
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,58 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_PERF_BASELINE_H_
+#define MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_PERF_BASELINE_H_
+
+#include <string>
+#include <vector>
+
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// Checks of the performance suite. Each check appends one human readable
+// line per failure to |failures|, prefixed with the case and the graph.
+
+// Checks that the run of |measurement| emitted a crop and that its frames
+// per second and latency to the first crop are finite. Only measurements
+// that pass can serve as a baseline.
+void CheckMeasurement(const PerfMeasurement& measurement,
+                      std::vector<std::string>* failures);
+
+// Compares |measured| with |baseline|, matching measurements by case name
+// and graph. The frames per second may not drop, and the latency to the
+// first crop and the peak RSS may not grow, by more than |tolerance|, a
+// fraction of the baseline value. Measurements without a baseline pass;
+// measurements or baselines that fail CheckMeasurement() fail.
+void CompareToBaseline(const PerfBaseline& baseline,
+                       const PerfBaseline& measured, double tolerance,
+                       std::vector<std::string>* failures);
+
+// Checks the detections of |measurement| against the synthetic video it ran
+// on. Every cut must be detected within |tolerance_frames| frames, and every
+// detected shot change must be that close to a cut or to the first frame.
+// If the graph reports active speakers, more than half of those of each
+// TALKING_FACES shot must be centered within |speaker_tolerance| of the
+// talking face.
+void CheckGroundTruth(const SyntheticVideoGroundTruth& truth,
+                      const PerfMeasurement& measurement,
+                      int tolerance_frames, float speaker_tolerance,
+                      std::vector<std::string>* failures);
+
+}  // namespace autoflip
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_PERF_BASELINE_H_
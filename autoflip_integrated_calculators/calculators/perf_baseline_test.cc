@@ -0,0 +1,151 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/perf_baseline.h"
+
+#include <limits>
+
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/integral_types.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+using ::testing::HasSubstr;
+using ::testing::IsEmpty;
+using ::testing::SizeIs;
+
+PerfMeasurement Measurement(const std::string& case_name, double fps,
+                            double latency_ms, int64 rss_kb) {
+  PerfMeasurement measurement;
+  measurement.set_case_name(case_name);
+  measurement.set_graph("autoflip_graph.pbtxt");
+  measurement.set_frames_per_second(fps);
+  measurement.set_first_crop_latency_ms(latency_ms);
+  measurement.set_peak_rss_kb(rss_kb);
+  return measurement;
+}
+
+// Three shots of 30 frames at 30 fps, the first one with a talking face.
+SyntheticVideoGroundTruth Truth() {
+  SyntheticVideoGroundTruth truth;
+  truth.set_fps(30);
+  truth.set_num_frames(90);
+  for (int i = 0; i < 3; ++i) {
+    auto* shot = truth.add_shot();
+    shot->set_first_frame(30 * i);
+    shot->set_num_frames(30);
+    shot->set_scene(static_cast<SyntheticVideoGroundTruth::Shot::Scene>(i));
+  }
+  truth.mutable_shot(0)->set_speaker_center_x(0.3);
+  return truth;
+}
+
+int64 FrameUs(int frame) { return frame * 1000000LL / 30; }
+
+TEST(PerfBaselineTest, WithinTolerance) {
+  PerfBaseline baseline, measured;
+  *baseline.add_measurement() = Measurement("640x360", 100, 1000, 500000);
+  *measured.add_measurement() = Measurement("640x360", 91, 1090, 540000);
+  // No baseline yet.
+  *measured.add_measurement() = Measurement("1280x720", 1, 1000000, 10000000);
+  std::vector<std::string> failures;
+  CompareToBaseline(baseline, measured, 0.1, &failures);
+  EXPECT_THAT(failures, IsEmpty());
+}
+
+TEST(PerfBaselineTest, Regressions) {
+  PerfBaseline baseline, measured;
+  *baseline.add_measurement() = Measurement("640x360", 100, 1000, 500000);
+  *measured.add_measurement() = Measurement("640x360", 80, 1200, 600000);
+  std::vector<std::string> failures;
+  CompareToBaseline(baseline, measured, 0.1, &failures);
+  ASSERT_THAT(failures, SizeIs(3));
+  EXPECT_THAT(failures[0], HasSubstr("80.0 fps, baseline 100.0 fps"));
+  EXPECT_THAT(failures[1], HasSubstr("first crop after 1200 ms"));
+  EXPECT_THAT(failures[2], HasSubstr("peak RSS 600000 kB"));
+}
+
+TEST(PerfBaselineTest, IncompleteMeasurements) {
+  PerfMeasurement no_crop = Measurement("640x360", 100, 0, 500000);
+  no_crop.clear_first_crop_latency_ms();
+  const PerfMeasurement infinite = Measurement(
+      "1280x720", 100, std::numeric_limits<double>::infinity(), 500000);
+  std::vector<std::string> failures;
+  CheckMeasurement(Measurement("640x360", 100, 1000, 500000), &failures);
+  EXPECT_THAT(failures, IsEmpty());
+  CheckMeasurement(no_crop, &failures);
+  CheckMeasurement(infinite, &failures);
+  ASSERT_THAT(failures, SizeIs(2));
+  EXPECT_THAT(failures[0], HasSubstr("no crop emitted"));
+  EXPECT_THAT(failures[1], HasSubstr("first crop after inf ms"));
+
+  // An infinite baseline would let any later latency pass.
+  PerfBaseline baseline, measured;
+  *baseline.add_measurement() = infinite;
+  *baseline.add_measurement() = Measurement("640x360", 100, 1000, 500000);
+  *measured.add_measurement() = Measurement("1280x720", 100, 1e9, 500000);
+  *measured.add_measurement() = no_crop;
+  failures.clear();
+  CompareToBaseline(baseline, measured, 0.1, &failures);
+  ASSERT_THAT(failures, SizeIs(2));
+  EXPECT_THAT(failures[0], HasSubstr("invalid baseline"));
+  EXPECT_THAT(failures[1], HasSubstr("incomplete measurement"));
+}
+
+TEST(PerfBaselineTest, MatchingDetections) {
+  PerfMeasurement measurement = Measurement("640x360", 100, 1000, 500000);
+  // A detection on the first frame is tolerated.
+  for (const int frame : {0, 31, 59}) {
+    measurement.add_shot_change_us(FrameUs(frame));
+  }
+  measurement.set_has_speakers(true);
+  for (const float x : {0.31f, 0.29f, 0.7f}) {
+    auto* speaker = measurement.add_speaker();
+    speaker->set_timestamp_us(FrameUs(10));
+    speaker->set_center_x(x);
+  }
+  std::vector<std::string> failures;
+  CheckGroundTruth(Truth(), measurement, 1, 0.1, &failures);
+  EXPECT_THAT(failures, IsEmpty());
+}
+
+TEST(PerfBaselineTest, WrongDetections) {
+  PerfMeasurement measurement = Measurement("640x360", 100, 1000, 500000);
+  for (const int frame : {30, 45}) {
+    measurement.add_shot_change_us(FrameUs(frame));
+  }
+  measurement.set_has_speakers(true);
+  auto* speaker = measurement.add_speaker();
+  speaker->set_timestamp_us(FrameUs(10));
+  speaker->set_center_x(0.7);
+  std::vector<std::string> failures;
+  CheckGroundTruth(Truth(), measurement, 1, 0.1, &failures);
+  ASSERT_THAT(failures, SizeIs(3));
+  EXPECT_THAT(failures[0], HasSubstr("missed the cut at frame 60"));
+  EXPECT_THAT(failures[1], HasSubstr("shot change at frame 45 is no cut"));
+  EXPECT_THAT(failures[2], HasSubstr("0 of 1 active speakers"));
+
+  // Graphs without speakers are only checked for shots.
+  measurement.set_has_speakers(false);
+  failures.clear();
+  CheckGroundTruth(Truth(), measurement, 1, 0.1, &failures);
+  EXPECT_THAT(failures, SizeIs(2));
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -16,6 +16,7 @@
 #include <cmath>
 
 #include "mediapipe/examples/desktop/autoflip/calculators/shot_boundary_decoder_calculator.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/simd_kernels.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/status.h"
@@ -37,6 +38,9 @@ namespace autoflip {
 // change. Settings to control the shot change logic are presented in the
 // options proto.
 // 
+// With output_only_on_change, the timestamp bound of IS_SHOT_CHANGE still
+// advances with every decoded frame.
+//
 // The details of TransNetV2: https://github.com/soCzech/TransNetV2. 
 //
 // Example config:
@@ -60,7 +64,6 @@ class ShotBoundaryDecoderCalculator : public CalculatorBase {
   ::mediapipe::Status Process(CalculatorContext* cc) override;
 
  private:
-  double Sigmoid(float output);
   // Transmits signal to next calculator.
   void Transmit(mediapipe::CalculatorContext* cc, 
               bool is_shot_change, Timestamp time);
@@ -99,7 +102,13 @@ REGISTER_CALCULATOR(ShotBoundaryDecoderCalculator);
     << "Input PREDICTION size is not correct.";
   RET_CHECK_EQ(input_timestamps.size(), kInputSize)
     << "Input TIME size is not correct.";  
-  
+
+  // A frame is a shot change if the sigmoid of its prediction is above the
+  // threshold, which is decided for the whole window at once.
+  bool is_shot_change[kPredictionEnd - kPredictionBegin];
+  LogitsAboveProbability(input_predictions.data() + kPredictionBegin,
+                         kPredictionEnd - kPredictionBegin,
+                         options_.threshold(), is_shot_change);
   for (int i = kPredictionBegin; i < kPredictionEnd; ++i) {
     const auto& time = input_timestamps[i];
     const auto& next_time = input_timestamps[i+1];
@@ -110,20 +119,13 @@ REGISTER_CALCULATOR(ShotBoundaryDecoderCalculator);
     if (next_time == Timestamp::Done())
       break;
 
-    auto prediction =  Sigmoid(input_predictions[i]);
-    bool is_shot_change = prediction > options_.threshold();
-    Transmit(cc, is_shot_change, next_time);
+    Transmit(cc, is_shot_change[i - kPredictionBegin], next_time);
   }
       
 
   return ::mediapipe::OkStatus();
 }
 
-// The sigmoid function
-double ShotBoundaryDecoderCalculator:: Sigmoid(float output) {
-  return 1 / (1 + exp(-output));
-}
-
 void ShotBoundaryDecoderCalculator::Transmit(mediapipe::CalculatorContext* cc,
         bool is_shot_change, Timestamp time) {
   if ((time - last_shot_timestamp_).Seconds() <
@@ -142,6 +144,12 @@ void ShotBoundaryDecoderCalculator::Transmit(mediapipe::CalculatorContext* cc,
         .Tag(kOutputShotChange)
         .AddPacket(Adopt(std::make_unique<bool>(false).release())
                        .At(time));
+  } else {
+    // Nothing is sent, but a node that syncs on the shot changes, such as
+    // the BOOST input of AdaptiveThinnerCalculator, may go past this frame.
+    cc->Outputs()
+        .Tag(kOutputShotChange)
+        .SetNextTimestampBound(time.NextAllowedInStream());
   }
 }
 
@@ -12,12 +12,17 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <cmath>
+#include <deque>
 #include <map>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/image_frame_pool.h"
 #include "mediapipe/examples/desktop/autoflip/calculators/shot_boundary_visualization_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image_frame.h"
@@ -34,15 +39,33 @@ using mediapipe::PacketTypeSet;
 constexpr char kInputVideo[] = "VIDEO";
 constexpr char kInputShotChange[] = "IS_SHOT_CHANGE";
 constexpr char kOutputBoundary[] = "BOUNDARY_INFORMATION_FRAME";
+constexpr char kOutputAnnotations[] = "ANNOTATIONS";
 
 const cv::Scalar kWhite = cv::Scalar(255.0, 255.0, 255.0);  // text
 const cv::Scalar kRed = cv::Scalar(255.0, 0.0, 0.0); // state 2
 const cv::Scalar kGreen = cv::Scalar(0.0, 255.0, 0.0); // state 1
 
+// Normalized positions of the boundary marks.
+const float kTextX = 0.02, kTextY = 0.05;
+const float kNoBoundaryX = 0.05, kNoBoundaryY = 0.15;
+const float kBoundaryX = 0.05, kBoundaryY = 0.2;
+// Radius of the state circle, in pixels.
+const int kStateRadius = 20;
+// Number of rendered frame buffers kept for reuse.
+const int kMaxPooledFrames = 4;
+
 namespace mediapipe {
 namespace autoflip {
 
-// This calculator visualizes the shot boundary signal.
+// This calculator visualizes the shot boundary signal. It either renders
+// BOUNDARY_INFORMATION_FRAME itself or, to avoid copying every frame, outputs
+// the same marks as ANNOTATIONS for DebugOverlayCalculator. At least one of
+// the two outputs is required.
+//
+// To keep rendering cheap, BOUNDARY_INFORMATION_FRAME can be downscaled to
+// target_width and sampled every n-th frame or around shot boundaries only,
+// and the marks are cached as an overlay until the boundary count changes.
+// ANNOTATIONS are emitted for every frame regardless of the sampling.
 //
 // Example:
 //  node {
@@ -50,6 +73,14 @@ namespace autoflip {
 //    input_stream: "VIDEO:camera_frames"
 //    input_stream: "IS_SHOT_CHANGE:shot_change"
 //    output_stream: "BOUNDARY_INFORMATION_FRAME:boundary_information_frames"
+//    output_stream: "ANNOTATIONS:boundary_annotations"
+//    options: {
+//      [mediapipe.autoflip.ShotBoundaryVisualizationCalculatorOptions.ext]: {
+//        target_width: 480
+//        boundary_window_before_us: 1000000
+//        boundary_window_after_us: 1000000
+//      }
+//    }
 //  }
 class ShotBoundaryVisualizationCalculator : public mediapipe::CalculatorBase {
  public:
@@ -62,15 +93,45 @@ class ShotBoundaryVisualizationCalculator : public mediapipe::CalculatorBase {
   mediapipe::Status Process(mediapipe::CalculatorContext* cc) override;
 
  private:
-   ::mediapipe::Status DrawBoundaryMarks(cv::Mat* viz_mat);
+  // A sampled frame waiting for a boundary within boundary_window_before_us.
+  struct PendingFrame {
+    Packet frame;
+    int num_boundary;
+    int state;
+  };
+
+  // Returns true if frames are only rendered around shot boundaries.
+  bool IsWindowed() const;
+  // Renders |frame| with the given boundary state to BOUNDARY_INFORMATION_FRAME.
+  ::mediapipe::Status RenderFrame(const Packet& frame, int num_boundary,
+                                  int state, mediapipe::CalculatorContext* cc);
+  ::mediapipe::Status DrawBoundaryMarks(int num_boundary, int state,
+                                        cv::Mat* viz_mat);
+  // Re-renders the cached overlay if the number of boundaries changed.
+  ::mediapipe::Status UpdateOverlay(int num_boundary, int state,
+                                    const cv::Mat& viz_mat);
+  // Fills annotation with the marks drawn by DrawBoundaryMarks.
+  void BuildBoundaryAnnotation(OverlayAnnotation* annotation);
   // Calculator options.
-  // ShotBoundaryVisualizationCalculatorOptions options_;
+  ShotBoundaryVisualizationCalculatorOptions options_;
   int num_boundary_;
   int state_;
-  // Dimensions of video frame.
-  int frame_width_ = -1;
-  int frame_height_ = -1;
-  ImageFormat::Format frame_format_ = ImageFormat::UNKNOWN;
+  // Dimensions of rendered frames.
+  int output_width_ = -1;
+  int output_height_ = -1;
+  // Number of input frames so far.
+  int64 frame_count_ = 0;
+  // Time of the last shot boundary.
+  Timestamp last_boundary_timestamp_ = Timestamp::Unset();
+  // Sampled frames within boundary_window_before_us of the current frame.
+  std::deque<PendingFrame> pending_frames_;
+  // Recycles the rendered frame buffers.
+  std::shared_ptr<ImageFramePool> pool_;
+  // Pre-rendered marks covering the top rows of the frame, the mask of their
+  // pixels and the boundary count they were rendered for.
+  cv::Mat overlay_;
+  cv::Mat overlay_mask_;
+  int overlay_num_boundary_ = -1;
 };
 
 REGISTER_CALCULATOR(ShotBoundaryVisualizationCalculator);
@@ -80,24 +141,53 @@ REGISTER_CALCULATOR(ShotBoundaryVisualizationCalculator);
   cc->Inputs().Tag(kInputVideo).Set<ImageFrame>();
   cc->Inputs().Tag(kInputShotChange).Set<bool>();
 
-  cc->Outputs().Tag(kOutputBoundary).Set<ImageFrame>();
+  RET_CHECK(cc->Outputs().HasTag(kOutputBoundary) ||
+            cc->Outputs().HasTag(kOutputAnnotations))
+      << "At least one of BOUNDARY_INFORMATION_FRAME and ANNOTATIONS is required.";
+  if (cc->Outputs().HasTag(kOutputBoundary)) {
+    cc->Outputs().Tag(kOutputBoundary).Set<ImageFrame>();
+  }
+  if (cc->Outputs().HasTag(kOutputAnnotations)) {
+    cc->Outputs().Tag(kOutputAnnotations).Set<OverlayAnnotation>();
+  }
   return ::mediapipe::OkStatus();
 }
 
 mediapipe::Status ShotBoundaryVisualizationCalculator::Open(
     mediapipe::CalculatorContext* cc) {
+  options_ = cc->Options<ShotBoundaryVisualizationCalculatorOptions>();
+  RET_CHECK_GE(options_.target_width(), 0)
+      << "target_width must not be negative.";
+  RET_CHECK_GT(options_.output_every_n_frames(), 0)
+      << "output_every_n_frames must be positive.";
+  RET_CHECK_GE(options_.boundary_window_before_us(), 0)
+      << "boundary_window_before_us must not be negative.";
+  RET_CHECK_GE(options_.boundary_window_after_us(), 0)
+      << "boundary_window_after_us must not be negative.";
   num_boundary_ = 0;
   state_ = 0;
+  pool_ = ImageFramePool::Create(kMaxPooledFrames);
   return ::mediapipe::OkStatus();
 }
 
+bool ShotBoundaryVisualizationCalculator::IsWindowed() const {
+  return options_.boundary_window_before_us() > 0 ||
+         options_.boundary_window_after_us() > 0;
+}
+
 ::mediapipe::Status ShotBoundaryVisualizationCalculator::Process(
     mediapipe::CalculatorContext* cc) {
   const auto& frame = cc->Inputs().Tag(kInputVideo).Get<ImageFrame>();
-  if (frame_width_ < 0) {
-    frame_width_ = frame.Width();
-    frame_height_ = frame.Height();
-    frame_format_ = frame.Format();
+  if (output_width_ < 0) {
+    output_width_ = frame.Width();
+    output_height_ = frame.Height();
+    if (options_.target_width() > 0) {
+      // Keep the height even for the video encoders.
+      output_width_ = options_.target_width();
+      output_height_ = std::max(
+          2, 2 * static_cast<int>(std::round(
+                     0.5 * frame.Height() * output_width_ / frame.Width())));
+    }
   }
 
   bool is_shot_change = false;
@@ -109,38 +199,141 @@ mediapipe::Status ShotBoundaryVisualizationCalculator::Open(
   if (is_shot_change) {
     num_boundary_++;
     state_ = ~state_;
+    last_boundary_timestamp_ = cc->InputTimestamp();
   }  
 
-  auto viz_frame = absl::make_unique<ImageFrame>(
-    frame_format_, frame_width_, frame_height_);
+  if (cc->Outputs().HasTag(kOutputAnnotations)) {
+    auto annotation = absl::make_unique<OverlayAnnotation>();
+    BuildBoundaryAnnotation(annotation.get());
+    cc->Outputs().Tag(kOutputAnnotations).Add(annotation.release(), cc->InputTimestamp());
+  }
+
+  if (!cc->Outputs().HasTag(kOutputBoundary)) {
+    return ::mediapipe::OkStatus();
+  }
+
+  // Frames held for the window before a boundary are rendered with the
+  // state they arrived with.
+  const int64 window_start = cc->InputTimestamp().Value() -
+                             options_.boundary_window_before_us();
+  while (!pending_frames_.empty() &&
+         pending_frames_.front().frame.Timestamp().Value() < window_start) {
+    pending_frames_.pop_front();
+  }
+  if (is_shot_change) {
+    for (const auto& pending : pending_frames_) {
+      MP_RETURN_IF_ERROR(RenderFrame(pending.frame, pending.num_boundary,
+                                     pending.state, cc));
+    }
+    pending_frames_.clear();
+  }
+
+  const bool is_sampled =
+      frame_count_++ % options_.output_every_n_frames() == 0;
+  if (!is_sampled) {
+    return ::mediapipe::OkStatus();
+  }
+  const bool in_window_after =
+      last_boundary_timestamp_ != Timestamp::Unset() &&
+      cc->InputTimestamp().Value() - last_boundary_timestamp_.Value() <=
+          options_.boundary_window_after_us();
+  if (!IsWindowed() || in_window_after) {
+    return RenderFrame(cc->Inputs().Tag(kInputVideo).Value(), num_boundary_,
+                       state_, cc);
+  }
+  if (options_.boundary_window_before_us() > 0) {
+    pending_frames_.push_back(
+        {cc->Inputs().Tag(kInputVideo).Value(), num_boundary_, state_});
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status ShotBoundaryVisualizationCalculator::RenderFrame(
+    const Packet& frame_packet, int num_boundary, int state,
+    mediapipe::CalculatorContext* cc) {
+  const auto& frame = frame_packet.Get<ImageFrame>();
+  auto viz_frame =
+      pool_->GetFrame(frame.Format(), output_width_, output_height_);
   cv::Mat viz_mat = formats::MatView(viz_frame.get());
-  mediapipe::formats::MatView(&frame).copyTo(viz_mat);
-  MP_RETURN_IF_ERROR(DrawBoundaryMarks(&viz_mat));
+  const cv::Mat input_mat = formats::MatView(&frame);
+  if (input_mat.size() == viz_mat.size()) {
+    input_mat.copyTo(viz_mat);
+  } else {
+    cv::resize(input_mat, viz_mat, viz_mat.size(), 0, 0, cv::INTER_AREA);
+  }
 
-  cc->Outputs().Tag(kOutputBoundary).Add(viz_frame.release(), cc->InputTimestamp());
+  if (options_.cache_overlay()) {
+    MP_RETURN_IF_ERROR(UpdateOverlay(num_boundary, state, viz_mat));
+    overlay_.copyTo(viz_mat.rowRange(0, overlay_.rows), overlay_mask_);
+  } else {
+    MP_RETURN_IF_ERROR(DrawBoundaryMarks(num_boundary, state, &viz_mat));
+  }
+
+  cc->Outputs().Tag(kOutputBoundary).Add(viz_frame.release(),
+                                         frame_packet.Timestamp());
   return ::mediapipe::OkStatus();
 }
 
-::mediapipe::Status ShotBoundaryVisualizationCalculator::DrawBoundaryMarks(cv::Mat* viz_mat) {
-  float text_x = 0.02, text_y = 0.05,
-        no_bounday_x = 0.05, no_bounday_y = 0.15,
-        bounday_x = 0.05, bounday_y = 0.2;
+::mediapipe::Status ShotBoundaryVisualizationCalculator::UpdateOverlay(
+    int num_boundary, int state, const cv::Mat& viz_mat) {
+  if (num_boundary == overlay_num_boundary_) {
+    return ::mediapipe::OkStatus();
+  }
+  // The marks only cover the rows above the lower state circle.
+  const int rows = std::min(
+      viz_mat.rows,
+      static_cast<int>(std::ceil(kBoundaryY * viz_mat.rows)) + kStateRadius + 1);
+  overlay_ = cv::Mat::zeros(rows, viz_mat.cols, viz_mat.type());
+  MP_RETURN_IF_ERROR(DrawBoundaryMarks(num_boundary, state, &overlay_));
+  cv::inRange(overlay_, cv::Scalar::all(0), cv::Scalar::all(0), overlay_mask_);
+  cv::bitwise_not(overlay_mask_, overlay_mask_);
+  overlay_num_boundary_ = num_boundary;
+  return ::mediapipe::OkStatus();
+}
 
-  std::string text = cv::format("Total number of shot boundary detected: %d.", num_boundary_);
-  cv::putText(*viz_mat, text, cv::Point2f(frame_width_*(text_x), frame_height_*(text_y)), 
+::mediapipe::Status ShotBoundaryVisualizationCalculator::DrawBoundaryMarks(
+    int num_boundary, int state, cv::Mat* viz_mat) {
+  // Positions are relative to the full frame, which |viz_mat| may only
+  // cover the top rows of.
+  const int frame_width = output_width_, frame_height = output_height_;
+  std::string text = cv::format("Total number of shot boundary detected: %d.", num_boundary);
+  cv::putText(*viz_mat, text, cv::Point2f(frame_width*(kTextX), frame_height*(kTextY)), 
         cv::FONT_HERSHEY_COMPLEX, 0.8, kWhite);
 
-  if (state_) {
-    cv::circle(*viz_mat, cv::Point2f(frame_width_*(bounday_x), frame_height_*(bounday_y)), 
-              20, kGreen, CV_FILLED);
+  if (state) {
+    cv::circle(*viz_mat, cv::Point2f(frame_width*(kBoundaryX), frame_height*(kBoundaryY)), 
+              kStateRadius, kGreen, CV_FILLED);
   }
   else {
-    cv::circle(*viz_mat, cv::Point2f(frame_width_*(no_bounday_x), frame_height_*(no_bounday_y)), 
-              20, kRed, CV_FILLED);
+    cv::circle(*viz_mat, cv::Point2f(frame_width*(kNoBoundaryX), frame_height*(kNoBoundaryY)), 
+              kStateRadius, kRed, CV_FILLED);
   }
   return ::mediapipe::OkStatus();
 }
 
+void ShotBoundaryVisualizationCalculator::BuildBoundaryAnnotation(
+    OverlayAnnotation* annotation) {
+  auto* text = annotation->add_text();
+  text->set_text(cv::format("Total number of shot boundary detected: %d.", num_boundary_));
+  text->set_x(kTextX);
+  text->set_y(kTextY);
+  text->mutable_color()->set_r(255);
+  text->mutable_color()->set_g(255);
+  text->mutable_color()->set_b(255);
+
+  auto* point = annotation->add_point();
+  point->set_radius(kStateRadius);
+  if (state_) {
+    point->set_x(kBoundaryX);
+    point->set_y(kBoundaryY);
+    point->mutable_color()->set_g(255);
+  }
+  else {
+    point->set_x(kNoBoundaryX);
+    point->set_y(kNoBoundaryY);
+    point->mutable_color()->set_r(255);
+  }
+}
 
 }  // namespace autoflip
 }  // namespace mediapipe
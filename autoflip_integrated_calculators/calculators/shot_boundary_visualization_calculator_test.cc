@@ -0,0 +1,136 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <vector>
+
+#include "mediapipe/examples/desktop/autoflip/calculators/shot_boundary_visualization_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kInputVideo[] = "VIDEO";
+constexpr char kInputShotChange[] = "IS_SHOT_CHANGE";
+constexpr char kOutputBoundary[] = "BOUNDARY_INFORMATION_FRAME";
+
+const int kImageWidth = 800;
+const int kImageHeight = 600;
+const int kNumFrames = 10;
+const int64 kFramePeriodUs = 100000;
+
+constexpr char kConfig[] = R"(
+    calculator: "ShotBoundaryVisualizationCalculator"
+    input_stream: "VIDEO:video"
+    input_stream: "IS_SHOT_CHANGE:shot_change"
+    output_stream: "BOUNDARY_INFORMATION_FRAME:boundary_information_frames")";
+
+// Adds kNumFrames gray frames, with a shot boundary at |boundary_frame|.
+std::unique_ptr<CalculatorRunner> MakeRunner(
+    const ShotBoundaryVisualizationCalculatorOptions& options,
+    int boundary_frame) {
+  auto config = ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig);
+  *config.mutable_options()->MutableExtension(
+      ShotBoundaryVisualizationCalculatorOptions::ext) = options;
+  auto runner = ::absl::make_unique<CalculatorRunner>(config);
+  for (int i = 0; i < kNumFrames; ++i) {
+    const Timestamp timestamp(i * kFramePeriodUs);
+    auto frame = ::absl::make_unique<ImageFrame>(ImageFormat::SRGB,
+                                                 kImageWidth, kImageHeight);
+    formats::MatView(frame.get()).setTo(cv::Scalar(50, 50, 50));
+    runner->MutableInputs()->Tag(kInputVideo).packets.push_back(
+        Adopt(frame.release()).At(timestamp));
+    runner->MutableInputs()->Tag(kInputShotChange).packets.push_back(
+        MakePacket<bool>(i == boundary_frame).At(timestamp));
+  }
+  return runner;
+}
+
+std::vector<int64> OutputTimestamps(const CalculatorRunner& runner) {
+  std::vector<int64> timestamps;
+  for (const auto& packet : runner.Outputs().Tag(kOutputBoundary).packets) {
+    timestamps.push_back(packet.Timestamp().Value());
+  }
+  return timestamps;
+}
+
+TEST(ShotBoundaryVisualizationCalculatorTest, RendersAtTargetWidth) {
+  ShotBoundaryVisualizationCalculatorOptions options;
+  options.set_target_width(400);
+  auto runner = MakeRunner(options, /* boundary_frame = */ 5);
+  MP_ASSERT_OK(runner->Run());
+
+  const auto& output_packets = runner->Outputs().Tag(kOutputBoundary).packets;
+  ASSERT_EQ(kNumFrames, output_packets.size());
+  for (const auto& packet : output_packets) {
+    EXPECT_EQ(400, packet.Get<ImageFrame>().Width());
+    EXPECT_EQ(300, packet.Get<ImageFrame>().Height());
+  }
+}
+
+TEST(ShotBoundaryVisualizationCalculatorTest, OutputsEveryNFrames) {
+  ShotBoundaryVisualizationCalculatorOptions options;
+  options.set_output_every_n_frames(3);
+  auto runner = MakeRunner(options, /* boundary_frame = */ 5);
+  MP_ASSERT_OK(runner->Run());
+
+  EXPECT_THAT(OutputTimestamps(*runner),
+              testing::ElementsAre(0, 3 * kFramePeriodUs, 6 * kFramePeriodUs,
+                                   9 * kFramePeriodUs));
+}
+
+TEST(ShotBoundaryVisualizationCalculatorTest, OutputsAroundBoundaries) {
+  ShotBoundaryVisualizationCalculatorOptions options;
+  options.set_boundary_window_before_us(2 * kFramePeriodUs);
+  options.set_boundary_window_after_us(kFramePeriodUs);
+  auto runner = MakeRunner(options, /* boundary_frame = */ 5);
+  MP_ASSERT_OK(runner->Run());
+
+  EXPECT_THAT(OutputTimestamps(*runner),
+              testing::ElementsAre(3 * kFramePeriodUs, 4 * kFramePeriodUs,
+                                   5 * kFramePeriodUs, 6 * kFramePeriodUs));
+}
+
+TEST(ShotBoundaryVisualizationCalculatorTest, CachedOverlayMatchesDrawing) {
+  ShotBoundaryVisualizationCalculatorOptions options;
+  auto cached_runner = MakeRunner(options, /* boundary_frame = */ 5);
+  MP_ASSERT_OK(cached_runner->Run());
+  options.set_cache_overlay(false);
+  auto drawn_runner = MakeRunner(options, /* boundary_frame = */ 5);
+  MP_ASSERT_OK(drawn_runner->Run());
+
+  const auto& cached = cached_runner->Outputs().Tag(kOutputBoundary).packets;
+  const auto& drawn = drawn_runner->Outputs().Tag(kOutputBoundary).packets;
+  ASSERT_EQ(kNumFrames, cached.size());
+  ASSERT_EQ(kNumFrames, drawn.size());
+  for (int i = 0; i < kNumFrames; ++i) {
+    cv::Mat diff;
+    cv::absdiff(formats::MatView(&cached[i].Get<ImageFrame>()),
+                formats::MatView(&drawn[i].Get<ImageFrame>()), diff);
+    EXPECT_EQ(0, cv::countNonZero(diff.reshape(1))) << "frame " << i;
+  }
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -29,6 +29,7 @@ using mediapipe::PacketTypeSet;
 
 constexpr char kIsShotBoundaryTag[] = "SHOT_BOUNDARY";
 constexpr char kOutputTag[] = "OUTPUT";
+constexpr char kCheckpointTag[] = "CHECKPOINT";
 
 namespace mediapipe {
 namespace autoflip {
@@ -44,6 +45,14 @@ struct ShotSignal {
 // outputs a combined shot change signal. The input signals should
 // be in ordered.
 //
+// The timestamp bound of the output advances with every input, up to the
+// earliest signal that is not fused yet, so that a node syncing on the fused
+// changes does not wait for the next one.
+//
+// If the optional CHECKPOINT output stream is connected, a
+// CalculatorCheckpoint is output after every fused shot change, and a run
+// can be restored from it with the optional CHECKPOINT input side packet.
+//
 // Example (ordered interface):
 //  node {
 //    calculator: "ShotChangeFusingCalculator"
@@ -100,6 +109,11 @@ class ShotChangeFusingCalculator : public mediapipe::CalculatorBase {
   mediapipe::Status ProcessScene(mediapipe::CalculatorContext* cc);
   std::vector<Packet> GetSignalPackets(mediapipe::CalculatorContext* cc);
   void Transmit(mediapipe::CalculatorContext* cc, const int position);
+  // Advances the output bound past the current input, or to the earliest
+  // pending signal.
+  void SetOutputBound(mediapipe::CalculatorContext* cc);
+  mediapipe::Status OutputCheckpoint(mediapipe::CalculatorContext* cc);
+  mediapipe::Status RestoreCheckpoint(const CalculatorCheckpoint& checkpoint);
   ShotChangeFusingCalculatorOptions options_;
   // Key is the id and value is the priority
   std::map<int32, int32> priority_;
@@ -107,6 +121,9 @@ class ShotChangeFusingCalculator : public mediapipe::CalculatorBase {
   bool tag_input_interface_;
   // Last time a shot was detected.
   Timestamp last_shot_timestamp_;
+  // Inputs before this timestamp were fused before the checkpoint that this
+  // run is restored from.
+  Timestamp resume_timestamp_ = Timestamp::Unstarted();
 };
 
 REGISTER_CALCULATOR(ShotChangeFusingCalculator);
@@ -134,6 +151,15 @@ void SetupOrderedInput(mediapipe::CalculatorContract* cc) {
   } else {
     SetupOrderedInput(cc);
   }
+  if (cc->Outputs().HasTag(kCheckpointTag)) {
+    cc->Outputs().Tag(kCheckpointTag).Set<CalculatorCheckpoint>();
+  }
+  if (cc->InputSidePackets().HasTag(kCheckpointTag)) {
+    cc->InputSidePackets()
+        .Tag(kCheckpointTag)
+        .Set<CalculatorCheckpoint>()
+        .Optional();
+  }
   return ::mediapipe::OkStatus();
 }
 
@@ -161,16 +187,30 @@ mediapipe::Status ShotChangeFusingCalculator::Open(
   }
 
   last_shot_timestamp_ = Timestamp(0);
+  if (cc->InputSidePackets().HasTag(kCheckpointTag) &&
+      !cc->InputSidePackets().Tag(kCheckpointTag).IsEmpty()) {
+    MP_RETURN_IF_ERROR(RestoreCheckpoint(
+        cc->InputSidePackets().Tag(kCheckpointTag).Get<CalculatorCheckpoint>()));
+  }
 
   return ::mediapipe::OkStatus();
 }
 
 mediapipe::Status ShotChangeFusingCalculator::Process(
     mediapipe::CalculatorContext* cc) {
+  if (cc->InputTimestamp() < resume_timestamp_) {
+    SetOutputBound(cc);
+    return ::mediapipe::OkStatus();
+  }
   // Flush bufferif it exceeds min_shot_span.
   if (!shot_signals_.empty() 
     && (cc->InputTimestamp() - shot_signals_[0].time).Seconds() > options_.min_shot_span()) {
     MP_RETURN_IF_ERROR(ProcessScene(cc));
+    // No signal is pending, so this is where a later run can resume.
+    MP_RETURN_IF_ERROR(OutputCheckpoint(cc));
+  } else if (cc->Outputs().HasTag(kCheckpointTag)) {
+    cc->Outputs().Tag(kCheckpointTag).SetNextTimestampBound(
+        cc->InputTimestamp().NextAllowedInStream());
   }
 
   ShotSignal signal;
@@ -190,6 +230,7 @@ mediapipe::Status ShotChangeFusingCalculator::Process(
     signal.time = cc->InputTimestamp();
     shot_signals_.push_back(signal);
   }
+  SetOutputBound(cc);
 
   return ::mediapipe::OkStatus();
 }
@@ -223,6 +264,31 @@ mediapipe::Status ShotChangeFusingCalculator::ProcessScene(
   return ::mediapipe::OkStatus();
 }
 
+mediapipe::Status ShotChangeFusingCalculator::OutputCheckpoint(
+    mediapipe::CalculatorContext* cc) {
+  if (!cc->Outputs().HasTag(kCheckpointTag)) {
+    return ::mediapipe::OkStatus();
+  }
+  ShotChangeFusingState state;
+  state.set_last_shot_timestamp(last_shot_timestamp_.Value());
+  auto checkpoint = ::absl::make_unique<CalculatorCheckpoint>();
+  checkpoint->set_resume_timestamp_us(cc->InputTimestamp().Value());
+  RET_CHECK(state.SerializeToString(checkpoint->mutable_state()));
+  cc->Outputs().Tag(kCheckpointTag).Add(checkpoint.release(),
+                                        cc->InputTimestamp());
+  return ::mediapipe::OkStatus();
+}
+
+mediapipe::Status ShotChangeFusingCalculator::RestoreCheckpoint(
+    const CalculatorCheckpoint& checkpoint) {
+  ShotChangeFusingState state;
+  RET_CHECK(state.ParseFromString(checkpoint.state()))
+      << "Invalid ShotChangeFusingCalculator checkpoint.";
+  last_shot_timestamp_ = Timestamp(state.last_shot_timestamp());
+  resume_timestamp_ = Timestamp(checkpoint.resume_timestamp_us());
+  return ::mediapipe::OkStatus();
+}
+
 std::vector<Packet> ShotChangeFusingCalculator::GetSignalPackets(
     mediapipe::CalculatorContext* cc) {
   std::vector<Packet> signal_packets;
@@ -240,6 +306,18 @@ std::vector<Packet> ShotChangeFusingCalculator::GetSignalPackets(
   return signal_packets;
 }
 
+void ShotChangeFusingCalculator::SetOutputBound(
+    mediapipe::CalculatorContext* cc) {
+  const Timestamp bound = shot_signals_.empty()
+                              ? cc->InputTimestamp().NextAllowedInStream()
+                              : shot_signals_[0].time;
+  if (tag_input_interface_) {
+    cc->Outputs().Tag(kOutputTag).SetNextTimestampBound(bound);
+  } else {
+    cc->Outputs().Index(0).SetNextTimestampBound(bound);
+  }
+}
+
 void ShotChangeFusingCalculator::Transmit(
             mediapipe::CalculatorContext* cc, const int position) {
   auto output_signal = ::absl::make_unique<bool>();
@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
 #include "mediapipe/examples/desktop/autoflip/calculators/shot_change_fusing_calculator.pb.h"
@@ -35,6 +36,7 @@ namespace {
 
 constexpr char kIsShotBoundaryTag[] = "SHOT_BOUNDARY";
 constexpr char kOutputTag[] = "OUTPUT";
+constexpr char kCheckpointTag[] = "CHECKPOINT";
 const int kOutputNum = 1;
 
 // Time stamp
@@ -45,6 +47,8 @@ const std::vector<std::vector<bool>> kSignalOneInput{{true}, {false}};
 const std::vector<std::vector<bool>> kSignalTwoInput1{{true, false}, {false, false}};
 const std::vector<std::vector<bool>> kSignalTwoInput2{{true, false}, {false, true}};
 const std::vector<std::vector<bool>> kSignalThreeInput{{true, false, false}, {false, false, false}};
+const std::vector<int64> kTimeStampThree{2000, 4000, 6000};
+const std::vector<std::vector<bool>> kSignalTwoShots{{true, false}, {false, false}, {false, true}};
 
 
 const char kConfigOne[] = R"(
@@ -281,6 +285,73 @@ TEST(ShotChangeFusingCalculatorTest, MissId) {
   ASSERT_FALSE(runner->Run().ok());
 }
 
+// Check checkpoint output and restore.
+TEST(ShotChangeFusingCalculatorTest, ResumesFromCheckpoint) {
+  auto config = MakeConfig(kConfigTag, 0);
+  config.add_output_stream("CHECKPOINT:checkpoint");
+  config.add_input_side_packet("CHECKPOINT:restored_checkpoint");
+  auto full_run = ::absl::make_unique<CalculatorRunner>(config);
+  SetInputs(kSignalTwoShots, kTimeStampThree, kIsShotBoundaryTag, full_run.get());
+  MP_ASSERT_OK(full_run->Run());
+  ASSERT_EQ(2, full_run->Outputs().Tag(kOutputTag).packets.size());
+
+  // The first shot is fused when the next input arrives.
+  const auto& checkpoints = full_run->Outputs().Tag(kCheckpointTag).packets;
+  ASSERT_EQ(1, checkpoints.size());
+  const auto& checkpoint = checkpoints[0].Get<CalculatorCheckpoint>();
+  EXPECT_EQ(kTimeStampThree[1], checkpoint.resume_timestamp_us());
+
+  // The restored run only outputs the shot after the checkpoint.
+  auto resumed_run = ::absl::make_unique<CalculatorRunner>(config);
+  resumed_run->MutableSidePackets()->Tag(kCheckpointTag) =
+      MakePacket<CalculatorCheckpoint>(checkpoint);
+  SetInputs(kSignalTwoShots, kTimeStampThree, kIsShotBoundaryTag, resumed_run.get());
+  MP_ASSERT_OK(resumed_run->Run());
+  const auto& output_packets = resumed_run->Outputs().Tag(kOutputTag).packets;
+  ASSERT_EQ(1, output_packets.size());
+  EXPECT_EQ(Timestamp(kTimeStampThree[2]), output_packets[0].Timestamp());
+}
+
+// Check that a node syncing on the fused changes is not held back.
+TEST(ShotChangeFusingCalculatorTest, AdvancesBoundBetweenChanges) {
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(ParseTextProtoOrDie<CalculatorGraphConfig>(
+      absl::StrCat(R"(
+        input_stream: "video"
+        input_stream: "shot_change"
+        node {)",
+                   kConfigOne, R"(}
+        node {
+          calculator: "PassThroughCalculator"
+          input_stream: "video"
+          input_stream: "fusing_change"
+          output_stream: "synced_video"
+          output_stream: "synced_change"
+        })"))));
+  std::vector<Packet> synced_video;
+  MP_ASSERT_OK(graph.ObserveOutputStream(
+      "synced_video", [&synced_video](const Packet& packet) {
+        synced_video.push_back(packet);
+        return ::mediapipe::OkStatus();
+      }));
+  MP_ASSERT_OK(graph.StartRun({}));
+
+  const int kNumFrames = 10;
+  for (int i = 0; i < kNumFrames; ++i) {
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "video", MakePacket<int>(i).At(Timestamp(i))));
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "shot_change", MakePacket<bool>(i == 5).At(Timestamp(i))));
+  }
+  MP_ASSERT_OK(graph.WaitUntilIdle());
+
+  // Every frame is through before the input ends, including the ones after
+  // the only shot change.
+  EXPECT_EQ(kNumFrames, synced_video.size());
+
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+}
 
 }  // namespace
 }  // namespace autoflip
@@ -0,0 +1,215 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/signal_cache.h"
+
+#include <cstdio>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_format.h"
+#include "google/protobuf/util/delimited_message_util.h"
+#include "mediapipe/framework/port/ret_check.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kMagic[] = "AFSIGNAL";
+constexpr int kMagicSize = 8;
+// Index offset and magic.
+constexpr int kTrailerSize = 8 + kMagicSize;
+
+constexpr uint64 kFnvOffsetBasis = 14695981039346656037ULL;
+constexpr uint64 kFnvPrime = 1099511628211ULL;
+
+}  // namespace
+
+::mediapipe::Status ContentHash(const std::string& path, std::string* hash) {
+  std::ifstream input(path, std::ios::in | std::ios::binary);
+  RET_CHECK(input.is_open()) << "Fail to open " << path;
+  std::vector<char> buffer(1 << 20);
+  uint64 value = kFnvOffsetBasis;
+  while (input) {
+    input.read(buffer.data(), buffer.size());
+    const std::streamsize size = input.gcount();
+    for (std::streamsize i = 0; i < size; ++i) {
+      value = (value ^ static_cast<uint8>(buffer[i])) * kFnvPrime;
+    }
+  }
+  RET_CHECK(input.eof()) << "Fail to read " << path;
+  *hash = absl::StrFormat("%016x", value);
+  return ::mediapipe::OkStatus();
+}
+
+std::string SignalCachePath(const std::string& cache_dir,
+                            const std::string& video_hash) {
+  return cache_dir + "/" + video_hash + ".signals";
+}
+
+SignalCacheWriter::~SignalCacheWriter() {
+  if (!temp_path_.empty()) {
+    output_.close();
+    std::remove(temp_path_.c_str());
+  }
+}
+
+::mediapipe::Status SignalCacheWriter::Open(const std::string& path,
+                                            const SignalCacheHeader& header) {
+  path_ = path;
+  temp_path_ = path + ".tmp";
+  output_.open(temp_path_,
+               std::ios::out | std::ios::binary | std::ios::trunc);
+  RET_CHECK(output_.is_open()) << "Fail to open signal cache " << temp_path_;
+  output_.write(kMagic, kMagicSize);
+  RET_CHECK(google::protobuf::util::SerializeDelimitedToOstream(header,
+                                                                &output_))
+      << "Fail to write signal cache " << temp_path_;
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status SignalCacheWriter::Append(
+    const SignalCacheRecord& record) {
+  const int64 num_records = index_.num_records();
+  RET_CHECK(num_records == 0 || record.timestamp_us() > last_timestamp_us_)
+      << "Signal cache records must be in increasing timestamp order.";
+  if (num_records % kIndexInterval == 0) {
+    auto* entry = index_.add_entry();
+    entry->set_timestamp_us(record.timestamp_us());
+    entry->set_offset(output_.tellp());
+  }
+  RET_CHECK(google::protobuf::util::SerializeDelimitedToOstream(record,
+                                                                &output_))
+      << "Fail to write signal cache " << temp_path_;
+  index_.set_num_records(num_records + 1);
+  last_timestamp_us_ = record.timestamp_us();
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status SignalCacheWriter::Finish() {
+  const uint64 index_offset = output_.tellp();
+  RET_CHECK(google::protobuf::util::SerializeDelimitedToOstream(index_,
+                                                                &output_))
+      << "Fail to write signal cache " << temp_path_;
+  char trailer[8];
+  for (int i = 0; i < 8; ++i) {
+    trailer[i] = static_cast<char>(index_offset >> (8 * i));
+  }
+  output_.write(trailer, sizeof(trailer));
+  output_.write(kMagic, kMagicSize);
+  output_.close();
+  RET_CHECK(!output_.fail()) << "Fail to close signal cache " << temp_path_;
+  RET_CHECK_EQ(0, std::rename(temp_path_.c_str(), path_.c_str()))
+      << "Fail to rename " << temp_path_ << " to " << path_;
+  temp_path_.clear();
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status SignalCacheReader::Open(const std::string& path) {
+  path_ = path;
+  input_.open(path, std::ios::in | std::ios::binary);
+  RET_CHECK(input_.is_open()) << "Fail to open signal cache " << path;
+  char magic[kMagicSize];
+  input_.read(magic, kMagicSize);
+  RET_CHECK(input_ && std::string(magic, kMagicSize) == kMagic)
+      << path << " is not a signal cache.";
+
+  // The trailer points to the index, and is only written once the cache is
+  // complete.
+  char trailer[kTrailerSize];
+  input_.seekg(-kTrailerSize, std::ios::end);
+  input_.read(trailer, kTrailerSize);
+  RET_CHECK(input_ && std::string(trailer + 8, kMagicSize) == kMagic)
+      << "Signal cache " << path << " is incomplete.";
+  uint64 index_offset = 0;
+  for (int i = 0; i < 8; ++i) {
+    index_offset |= static_cast<uint64>(static_cast<uint8>(trailer[i]))
+                    << (8 * i);
+  }
+  input_.seekg(index_offset);
+  {
+    google::protobuf::io::IstreamInputStream stream(&input_);
+    RET_CHECK(google::protobuf::util::ParseDelimitedFromZeroCopyStream(
+        &index_, &stream, nullptr))
+        << "Fail to read the index of signal cache " << path;
+  }
+  input_.clear();
+  input_.seekg(kMagicSize);
+  {
+    google::protobuf::io::IstreamInputStream stream(&input_);
+    RET_CHECK(google::protobuf::util::ParseDelimitedFromZeroCopyStream(
+        &header_, &stream, nullptr))
+        << "Fail to read the header of signal cache " << path;
+  }
+  return SeekToEntry(0);
+}
+
+::mediapipe::Status SignalCacheReader::SeekToEntry(int entry) {
+  pending_.reset();
+  stream_.reset();
+  if (entry >= index_.entry_size()) {
+    remaining_records_ = 0;
+    return ::mediapipe::OkStatus();
+  }
+  input_.clear();
+  input_.seekg(index_.entry(entry).offset());
+  RET_CHECK(input_) << "Fail to seek in signal cache " << path_;
+  stream_ = absl::make_unique<google::protobuf::io::IstreamInputStream>(
+      &input_);
+  remaining_records_ =
+      index_.num_records() -
+      static_cast<int64>(entry) * SignalCacheWriter::kIndexInterval;
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status SignalCacheReader::Seek(int64 timestamp_us) {
+  // Last entry at or before the timestamp.
+  int entry = 0;
+  while (entry + 1 < index_.entry_size() &&
+         index_.entry(entry + 1).timestamp_us() <= timestamp_us) {
+    ++entry;
+  }
+  MP_RETURN_IF_ERROR(SeekToEntry(entry));
+  auto record = absl::make_unique<SignalCacheRecord>();
+  bool has_record = false;
+  do {
+    MP_RETURN_IF_ERROR(Next(record.get(), &has_record));
+  } while (has_record && record->timestamp_us() < timestamp_us);
+  if (has_record) {
+    pending_ = std::move(record);
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status SignalCacheReader::Next(SignalCacheRecord* record,
+                                            bool* has_record) {
+  if (pending_) {
+    *record = *pending_;
+    pending_.reset();
+    *has_record = true;
+    return ::mediapipe::OkStatus();
+  }
+  *has_record = remaining_records_ > 0;
+  if (!*has_record) {
+    return ::mediapipe::OkStatus();
+  }
+  RET_CHECK(google::protobuf::util::ParseDelimitedFromZeroCopyStream(
+      record, stream_.get(), nullptr))
+      << "Fail to read signal cache " << path_;
+  --remaining_records_;
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,116 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_SIGNAL_CACHE_H_
+#define MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_SIGNAL_CACHE_H_
+
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "google/protobuf/io/zero_copy_stream_impl.h"
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// A signal cache holds the per-frame signals the detectors of the AutoFlip
+// graph computed for one video, so that the video can be cropped again, e.g.
+// to another aspect ratio, without running the detectors. It is keyed by a
+// content hash of the video and laid out as:
+//
+//   magic, SignalCacheHeader, SignalCacheRecord..., SignalCacheIndex,
+//   offset of the index (8 bytes, little endian), magic
+//
+// with the messages length-delimited. The index at the end lets a reader
+// check that the cache is complete and seek to a timestamp. Caches are
+// written next to their final path and renamed once complete, so a run that
+// fails never leaves a partial cache behind.
+
+// Sets |hash| to the 64-bit FNV-1a hash of the contents of the file at
+// |path|, as 16 hex digits. Reads the whole file.
+::mediapipe::Status ContentHash(const std::string& path, std::string* hash);
+
+// Returns the path of the cache of the video with |video_hash| in
+// |cache_dir|.
+std::string SignalCachePath(const std::string& cache_dir,
+                            const std::string& video_hash);
+
+class SignalCacheWriter {
+ public:
+  // Records between two index entries.
+  static constexpr int kIndexInterval = 256;
+
+  SignalCacheWriter() {}
+  SignalCacheWriter(const SignalCacheWriter&) = delete;
+  SignalCacheWriter& operator=(const SignalCacheWriter&) = delete;
+  // Removes the partial cache if Finish() was not called.
+  ~SignalCacheWriter();
+
+  ::mediapipe::Status Open(const std::string& path,
+                           const SignalCacheHeader& header);
+  // Records must be appended in increasing timestamp order.
+  ::mediapipe::Status Append(const SignalCacheRecord& record);
+  // Writes the index and moves the cache to its path.
+  ::mediapipe::Status Finish();
+
+ private:
+  std::string path_;
+  std::string temp_path_;
+  std::ofstream output_;
+  SignalCacheIndex index_;
+  int64 last_timestamp_us_ = 0;
+};
+
+class SignalCacheReader {
+ public:
+  SignalCacheReader() {}
+  SignalCacheReader(const SignalCacheReader&) = delete;
+  SignalCacheReader& operator=(const SignalCacheReader&) = delete;
+
+  // Opens the cache and positions the reader at its first record. Fails if
+  // the cache is incomplete.
+  ::mediapipe::Status Open(const std::string& path);
+
+  const SignalCacheHeader& header() const { return header_; }
+  int64 num_records() const { return index_.num_records(); }
+
+  // Positions the reader at the first record at or after |timestamp_us|.
+  ::mediapipe::Status Seek(int64 timestamp_us);
+
+  // Reads the next record into |record|. Sets |has_record| to false at the
+  // end of the cache.
+  ::mediapipe::Status Next(SignalCacheRecord* record, bool* has_record);
+
+ private:
+  // Positions the reader at index entry |entry|.
+  ::mediapipe::Status SeekToEntry(int entry);
+
+  std::string path_;
+  std::ifstream input_;
+  std::unique_ptr<google::protobuf::io::IstreamInputStream> stream_;
+  SignalCacheHeader header_;
+  SignalCacheIndex index_;
+  // Records left to read after the current position.
+  int64 remaining_records_ = 0;
+  // Record read ahead by Seek().
+  std::unique_ptr<SignalCacheRecord> pending_;
+};
+
+}  // namespace autoflip
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_SIGNAL_CACHE_H_
@@ -0,0 +1,239 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/signal_cache.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// IO labels.
+constexpr char kInputFilePath[] = "INPUT_FILE_PATH";
+constexpr char kCacheDir[] = "CACHE_DIR";
+constexpr char kInputVideo[] = "VIDEO";
+constexpr char kShotChange[] = "IS_SHOT_CHANGE";
+constexpr char kRegions[] = "REGIONS";
+constexpr char kStaticFeatures[] = "STATIC_FEATURES";
+constexpr char kKeyFrames[] = "KEY_FRAMES";
+
+// This calculator replays the signal cache that SignalCacheWriterCalculator
+// recorded for the video at INPUT_FILE_PATH, in place of the detectors. The
+// frames of the video are its clock: for each VIDEO packet, the cached
+// signals up to its timestamp are output, and the frame is passed to
+// KEY_FRAMES if the detectors ran on it, so that SignalFusingCalculator and
+// SceneCroppingCalculator see the same inputs as in the recorded run.
+//
+// The outputs are the tags of the writer: IS_SHOT_CHANGE:<i>, REGIONS:<i>
+// and STATIC_FEATURES, each of which must have been recorded, and the
+// optional KEY_FRAMES. Open fails if there is no complete cache for the
+// video in CACHE_DIR.
+//
+// Example:
+//  node {
+//    calculator: "SignalCacheReaderCalculator"
+//    input_side_packet: "INPUT_FILE_PATH:input_video_path"
+//    input_side_packet: "CACHE_DIR:signal_cache_dir"
+//    input_stream: "VIDEO:video_raw"
+//    output_stream: "KEY_FRAMES:key_frames"
+//    output_stream: "IS_SHOT_CHANGE:0:shot_change"
+//    output_stream: "REGIONS:0:face_regions"
+//    output_stream: "STATIC_FEATURES:borders"
+//  }
+class SignalCacheReaderCalculator : public CalculatorBase {
+ public:
+  SignalCacheReaderCalculator() {}
+  SignalCacheReaderCalculator(const SignalCacheReaderCalculator&) = delete;
+  SignalCacheReaderCalculator& operator=(const SignalCacheReaderCalculator&) =
+      delete;
+
+  static ::mediapipe::Status GetContract(mediapipe::CalculatorContract* cc);
+  ::mediapipe::Status Open(mediapipe::CalculatorContext* cc) override;
+  ::mediapipe::Status Process(mediapipe::CalculatorContext* cc) override;
+  ::mediapipe::Status Close(mediapipe::CalculatorContext* cc) override;
+
+ private:
+  // Outputs the signals of |record|.
+  void OutputSignals(const SignalCacheRecord& record,
+                     mediapipe::CalculatorContext* cc);
+
+  SignalCacheReader reader_;
+  // Output stream of each cached stream, or nullptr if it is not connected.
+  std::vector<OutputStreamShard*> outputs_;
+  // Next record after the last processed frame.
+  std::unique_ptr<SignalCacheRecord> next_;
+  bool has_started_ = false;
+};
+
+REGISTER_CALCULATOR(SignalCacheReaderCalculator);
+
+::mediapipe::Status SignalCacheReaderCalculator::GetContract(
+    mediapipe::CalculatorContract* cc) {
+  cc->InputSidePackets().Tag(kInputFilePath).Set<std::string>();
+  cc->InputSidePackets().Tag(kCacheDir).Set<std::string>();
+  cc->Inputs().Tag(kInputVideo).SetAny();
+  if (cc->Outputs().HasTag(kKeyFrames)) {
+    cc->Outputs().Tag(kKeyFrames).SetSameAs(&cc->Inputs().Tag(kInputVideo));
+  }
+  for (int i = 0; i < cc->Outputs().NumEntries(kShotChange); ++i) {
+    cc->Outputs().Get(kShotChange, i).Set<bool>();
+  }
+  for (int i = 0; i < cc->Outputs().NumEntries(kRegions); ++i) {
+    cc->Outputs().Get(kRegions, i).Set<DetectionSet>();
+  }
+  if (cc->Outputs().HasTag(kStaticFeatures)) {
+    cc->Outputs().Tag(kStaticFeatures).Set<StaticFeatures>();
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status SignalCacheReaderCalculator::Open(
+    mediapipe::CalculatorContext* cc) {
+  const auto& cache_dir =
+      cc->InputSidePackets().Tag(kCacheDir).Get<std::string>();
+  RET_CHECK(!cache_dir.empty()) << "Signal cache directory is empty.";
+  const auto& video_path =
+      cc->InputSidePackets().Tag(kInputFilePath).Get<std::string>();
+  std::string video_hash;
+  MP_RETURN_IF_ERROR(ContentHash(video_path, &video_hash));
+  MP_RETURN_IF_ERROR(reader_.Open(SignalCachePath(cache_dir, video_hash)))
+      << "No signal cache for " << video_path
+      << "; record one with SignalCacheWriterCalculator first.";
+  const auto& header = reader_.header();
+  RET_CHECK_EQ(header.video_hash(), video_hash)
+      << "Signal cache was recorded for another video.";
+
+  int num_connected = 0;
+  for (const auto& stream : header.stream()) {
+    const std::vector<std::string> tag_index = absl::StrSplit(stream, ':');
+    int index = 0;
+    RET_CHECK(tag_index.size() == 2 && absl::SimpleAtoi(tag_index[1], &index))
+        << "Invalid signal cache stream " << stream;
+    const std::string& tag = tag_index[0];
+    if (index < cc->Outputs().NumEntries(tag)) {
+      outputs_.push_back(&cc->Outputs().Get(tag, index));
+      ++num_connected;
+    } else {
+      outputs_.push_back(nullptr);
+    }
+  }
+  const int num_signal_outputs = cc->Outputs().NumEntries(kShotChange) +
+                                 cc->Outputs().NumEntries(kRegions) +
+                                 cc->Outputs().NumEntries(kStaticFeatures);
+  RET_CHECK_EQ(num_connected, num_signal_outputs)
+      << "Signal cache does not hold every output stream.";
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status SignalCacheReaderCalculator::Process(
+    mediapipe::CalculatorContext* cc) {
+  const int64 timestamp = cc->InputTimestamp().Value();
+  if (!has_started_) {
+    // Signals before the first frame have nothing to crop.
+    MP_RETURN_IF_ERROR(reader_.Seek(timestamp));
+    has_started_ = true;
+  }
+  bool is_key_frame = false;
+  while (true) {
+    if (!next_) {
+      auto record = absl::make_unique<SignalCacheRecord>();
+      bool has_record = false;
+      MP_RETURN_IF_ERROR(reader_.Next(record.get(), &has_record));
+      if (!has_record) {
+        break;
+      }
+      next_ = std::move(record);
+    }
+    if (next_->timestamp_us() > timestamp) {
+      break;
+    }
+    is_key_frame |=
+        next_->key_frame() && next_->timestamp_us() == timestamp;
+    OutputSignals(*next_, cc);
+    next_.reset();
+  }
+
+  // Consumers do not have to wait for the next cached signal or key frame.
+  const Timestamp bound = cc->InputTimestamp().NextAllowedInStream();
+  if (cc->Outputs().HasTag(kKeyFrames)) {
+    if (is_key_frame) {
+      cc->Outputs().Tag(kKeyFrames).AddPacket(
+          cc->Inputs().Tag(kInputVideo).Value());
+    } else {
+      cc->Outputs().Tag(kKeyFrames).SetNextTimestampBound(bound);
+    }
+  }
+  for (auto* output : outputs_) {
+    if (output != nullptr) {
+      output->SetNextTimestampBound(bound);
+    }
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status SignalCacheReaderCalculator::Close(
+    mediapipe::CalculatorContext* cc) {
+  // Signals after the last frame, e.g. a shot change reported for it.
+  if (next_) {
+    OutputSignals(*next_, cc);
+    next_.reset();
+  }
+  bool has_record = true;
+  while (has_started_) {
+    SignalCacheRecord record;
+    MP_RETURN_IF_ERROR(reader_.Next(&record, &has_record));
+    if (!has_record) {
+      break;
+    }
+    OutputSignals(record, cc);
+  }
+  return ::mediapipe::OkStatus();
+}
+
+void SignalCacheReaderCalculator::OutputSignals(
+    const SignalCacheRecord& record, mediapipe::CalculatorContext* cc) {
+  const Timestamp timestamp(record.timestamp_us());
+  for (const auto& signal : record.signal()) {
+    if (signal.stream() < 0 || signal.stream() >= outputs_.size() ||
+        outputs_[signal.stream()] == nullptr) {
+      continue;
+    }
+    auto* output = outputs_[signal.stream()];
+    switch (signal.value_case()) {
+      case SignalCacheRecord::Signal::kFlag:
+        output->Add(new bool(signal.flag()), timestamp);
+        break;
+      case SignalCacheRecord::Signal::kRegions:
+        output->Add(new DetectionSet(signal.regions()), timestamp);
+        break;
+      case SignalCacheRecord::Signal::kStaticFeatures:
+        output->Add(new StaticFeatures(signal.static_features()), timestamp);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
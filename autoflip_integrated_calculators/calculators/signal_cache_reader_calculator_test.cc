@@ -0,0 +1,178 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/signal_cache.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kInputFilePath[] = "INPUT_FILE_PATH";
+constexpr char kCacheDir[] = "CACHE_DIR";
+constexpr char kInputVideo[] = "VIDEO";
+constexpr char kShotChange[] = "IS_SHOT_CHANGE";
+constexpr char kRegions[] = "REGIONS";
+constexpr char kKeyFrames[] = "KEY_FRAMES";
+
+constexpr char kConfig[] = R"(
+    calculator: "SignalCacheReaderCalculator"
+    input_side_packet: "INPUT_FILE_PATH:input_video_path"
+    input_side_packet: "CACHE_DIR:signal_cache_dir"
+    input_stream: "VIDEO:video"
+    output_stream: "KEY_FRAMES:key_frames"
+    output_stream: "IS_SHOT_CHANGE:0:shot_change"
+    output_stream: "REGIONS:0:face_regions")";
+
+constexpr char kConfigWithMissingStream[] = R"(
+    calculator: "SignalCacheReaderCalculator"
+    input_side_packet: "INPUT_FILE_PATH:input_video_path"
+    input_side_packet: "CACHE_DIR:signal_cache_dir"
+    input_stream: "VIDEO:video"
+    output_stream: "IS_SHOT_CHANGE:0:shot_change"
+    output_stream: "REGIONS:1:text_regions")";
+
+const int kNumFrames = 10;
+
+std::string WriteVideo(const std::string& name) {
+  const std::string path = ::testing::TempDir() + "/" + name;
+  std::ofstream video(path, std::ios::out | std::ios::binary);
+  video << "signal cache reader test video " << name;
+  return path;
+}
+
+// Records a shot change at frame 5, regions on the key frames, every third
+// frame, and a shot change after the last frame.
+void WriteCache(const std::string& video_path) {
+  std::string hash;
+  MP_ASSERT_OK(ContentHash(video_path, &hash));
+  SignalCacheHeader header;
+  header.set_video_hash(hash);
+  header.add_stream("IS_SHOT_CHANGE:0");
+  header.add_stream("REGIONS:0");
+  SignalCacheWriter writer;
+  MP_ASSERT_OK(
+      writer.Open(SignalCachePath(::testing::TempDir(), hash), header));
+  for (int i = 0; i <= kNumFrames; ++i) {
+    SignalCacheRecord record;
+    record.set_timestamp_us(i * 1000);
+    record.set_key_frame(i % 3 == 0);
+    auto* shot_change = record.add_signal();
+    shot_change->set_stream(0);
+    shot_change->set_flag(i == 5 || i == kNumFrames);
+    if (i % 3 == 0) {
+      auto* regions = record.add_signal();
+      regions->set_stream(1);
+      regions->mutable_regions()->add_detections()->set_score(i);
+    }
+    MP_ASSERT_OK(writer.Append(record));
+  }
+  MP_ASSERT_OK(writer.Finish());
+}
+
+std::unique_ptr<CalculatorRunner> MakeRunner(const std::string& config,
+                                             const std::string& video_path) {
+  auto runner = ::absl::make_unique<CalculatorRunner>(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(config));
+  runner->MutableSidePackets()->Tag(kInputFilePath) =
+      MakePacket<std::string>(video_path);
+  runner->MutableSidePackets()->Tag(kCacheDir) =
+      MakePacket<std::string>(::testing::TempDir());
+  return runner;
+}
+
+void AddFrames(int first, CalculatorRunner* runner) {
+  for (int i = first; i < kNumFrames; ++i) {
+    runner->MutableInputs()->Tag(kInputVideo).packets.push_back(
+        MakePacket<int>(i).At(Timestamp(i * 1000)));
+  }
+}
+
+TEST(SignalCacheReaderCalculatorTest, ReplaysSignals) {
+  const std::string video_path = WriteVideo("replays_signals.mp4");
+  WriteCache(video_path);
+  auto runner = MakeRunner(kConfig, video_path);
+  AddFrames(0, runner.get());
+  MP_ASSERT_OK(runner->Run());
+
+  const auto& key_frames = runner->Outputs().Tag(kKeyFrames).packets;
+  ASSERT_EQ(4, key_frames.size());
+  for (int i = 0; i < key_frames.size(); ++i) {
+    EXPECT_EQ(i * 3, key_frames[i].Get<int>());
+    EXPECT_EQ(Timestamp(i * 3000), key_frames[i].Timestamp());
+  }
+  // Including the shot change reported after the last frame.
+  const auto& shot_changes = runner->Outputs().Get(kShotChange, 0).packets;
+  ASSERT_EQ(kNumFrames + 1, shot_changes.size());
+  for (int i = 0; i <= kNumFrames; ++i) {
+    EXPECT_EQ(Timestamp(i * 1000), shot_changes[i].Timestamp());
+    EXPECT_EQ(i == 5 || i == kNumFrames, shot_changes[i].Get<bool>());
+  }
+  const auto& regions = runner->Outputs().Get(kRegions, 0).packets;
+  ASSERT_EQ(4, regions.size());
+  for (int i = 0; i < regions.size(); ++i) {
+    EXPECT_EQ(Timestamp(i * 3000), regions[i].Timestamp());
+    EXPECT_EQ(i * 3, regions[i].Get<DetectionSet>().detections(0).score());
+  }
+}
+
+TEST(SignalCacheReaderCalculatorTest, StartsAtFirstFrame) {
+  const std::string video_path = WriteVideo("starts_at_first_frame.mp4");
+  WriteCache(video_path);
+  auto runner = MakeRunner(kConfig, video_path);
+  AddFrames(4, runner.get());
+  MP_ASSERT_OK(runner->Run());
+
+  const auto& shot_changes = runner->Outputs().Get(kShotChange, 0).packets;
+  ASSERT_EQ(kNumFrames - 3, shot_changes.size());
+  EXPECT_EQ(Timestamp(4000), shot_changes[0].Timestamp());
+  const auto& key_frames = runner->Outputs().Tag(kKeyFrames).packets;
+  ASSERT_EQ(2, key_frames.size());
+  EXPECT_EQ(6, key_frames[0].Get<int>());
+  EXPECT_EQ(9, key_frames[1].Get<int>());
+}
+
+TEST(SignalCacheReaderCalculatorTest, FailsWithoutCache) {
+  const std::string video_path = WriteVideo("fails_without_cache.mp4");
+  std::string hash;
+  MP_ASSERT_OK(ContentHash(video_path, &hash));
+  std::remove(SignalCachePath(::testing::TempDir(), hash).c_str());
+  auto runner = MakeRunner(kConfig, video_path);
+  AddFrames(0, runner.get());
+  EXPECT_FALSE(runner->Run().ok());
+}
+
+TEST(SignalCacheReaderCalculatorTest, FailsOnStreamNotInCache) {
+  const std::string video_path = WriteVideo("fails_on_missing_stream.mp4");
+  WriteCache(video_path);
+  auto runner = MakeRunner(kConfigWithMissingStream, video_path);
+  AddFrames(0, runner.get());
+  EXPECT_FALSE(runner->Run().ok());
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
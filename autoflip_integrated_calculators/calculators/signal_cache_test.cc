@@ -0,0 +1,166 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/signal_cache.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+// More records than one index interval, so that seeking uses the index.
+const int kNumRecords = 600;
+const int64 kFramePeriodUs = 33333;
+
+std::string TestPath(const std::string& name) {
+  return ::testing::TempDir() + "/signal_cache_test." + name;
+}
+
+void WriteFile(const std::string& path, const std::string& contents) {
+  std::ofstream output(path, std::ios::out | std::ios::binary);
+  output << contents;
+}
+
+SignalCacheRecord MakeRecord(int frame) {
+  SignalCacheRecord record;
+  record.set_timestamp_us(frame * kFramePeriodUs);
+  record.set_key_frame(frame % 6 == 0);
+  auto* signal = record.add_signal();
+  signal->set_stream(0);
+  signal->set_flag(frame % 100 == 0);
+  signal = record.add_signal();
+  signal->set_stream(1);
+  signal->mutable_regions()->add_detections()->set_score(frame);
+  return record;
+}
+
+void WriteCache(const std::string& path) {
+  SignalCacheHeader header;
+  header.set_video_hash("0123456789abcdef");
+  header.add_stream("IS_SHOT_CHANGE:0");
+  header.add_stream("REGIONS:0");
+  SignalCacheWriter writer;
+  MP_ASSERT_OK(writer.Open(path, header));
+  for (int i = 0; i < kNumRecords; ++i) {
+    MP_ASSERT_OK(writer.Append(MakeRecord(i)));
+  }
+  MP_ASSERT_OK(writer.Finish());
+}
+
+TEST(SignalCacheTest, HashesContents) {
+  WriteFile(TestPath("a"), "some video");
+  WriteFile(TestPath("b"), "some video");
+  WriteFile(TestPath("c"), "another video");
+  std::string hash_a, hash_b, hash_c;
+  MP_ASSERT_OK(ContentHash(TestPath("a"), &hash_a));
+  MP_ASSERT_OK(ContentHash(TestPath("b"), &hash_b));
+  MP_ASSERT_OK(ContentHash(TestPath("c"), &hash_c));
+  EXPECT_EQ(16, hash_a.size());
+  EXPECT_EQ(hash_a, hash_b);
+  EXPECT_NE(hash_a, hash_c);
+  EXPECT_FALSE(ContentHash(TestPath("missing"), &hash_a).ok());
+}
+
+TEST(SignalCacheTest, ReadsWhatWasWritten) {
+  const std::string path = TestPath("signals");
+  WriteCache(path);
+
+  SignalCacheReader reader;
+  MP_ASSERT_OK(reader.Open(path));
+  EXPECT_EQ("0123456789abcdef", reader.header().video_hash());
+  ASSERT_EQ(2, reader.header().stream_size());
+  EXPECT_EQ("REGIONS:0", reader.header().stream(1));
+  EXPECT_EQ(kNumRecords, reader.num_records());
+  SignalCacheRecord record;
+  bool has_record = false;
+  for (int i = 0; i < kNumRecords; ++i) {
+    MP_ASSERT_OK(reader.Next(&record, &has_record));
+    ASSERT_TRUE(has_record);
+    EXPECT_EQ(MakeRecord(i).SerializeAsString(), record.SerializeAsString());
+  }
+  MP_ASSERT_OK(reader.Next(&record, &has_record));
+  EXPECT_FALSE(has_record);
+}
+
+TEST(SignalCacheTest, SeeksToTimestamp) {
+  const std::string path = TestPath("signals");
+  WriteCache(path);
+
+  SignalCacheReader reader;
+  MP_ASSERT_OK(reader.Open(path));
+  SignalCacheRecord record;
+  bool has_record = false;
+  // Between two records, past the first index interval.
+  MP_ASSERT_OK(reader.Seek(400 * kFramePeriodUs - 1));
+  MP_ASSERT_OK(reader.Next(&record, &has_record));
+  ASSERT_TRUE(has_record);
+  EXPECT_EQ(400 * kFramePeriodUs, record.timestamp_us());
+  // Backwards, and then to the end.
+  MP_ASSERT_OK(reader.Seek(10 * kFramePeriodUs));
+  MP_ASSERT_OK(reader.Next(&record, &has_record));
+  ASSERT_TRUE(has_record);
+  EXPECT_EQ(10 * kFramePeriodUs, record.timestamp_us());
+  MP_ASSERT_OK(reader.Seek(kNumRecords * kFramePeriodUs));
+  MP_ASSERT_OK(reader.Next(&record, &has_record));
+  EXPECT_FALSE(has_record);
+}
+
+TEST(SignalCacheTest, RejectsOutOfOrderRecords) {
+  const std::string path = TestPath("out_of_order");
+  SignalCacheWriter writer;
+  MP_ASSERT_OK(writer.Open(path, SignalCacheHeader()));
+  MP_ASSERT_OK(writer.Append(MakeRecord(2)));
+  EXPECT_FALSE(writer.Append(MakeRecord(1)).ok());
+}
+
+TEST(SignalCacheTest, UnfinishedCacheIsNotPublished) {
+  const std::string path = TestPath("unfinished");
+  std::remove(path.c_str());
+  {
+    SignalCacheWriter writer;
+    MP_ASSERT_OK(writer.Open(path, SignalCacheHeader()));
+    MP_ASSERT_OK(writer.Append(MakeRecord(0)));
+  }
+  SignalCacheReader reader;
+  EXPECT_FALSE(reader.Open(path).ok());
+  EXPECT_FALSE(std::ifstream(path + ".tmp").is_open());
+}
+
+TEST(SignalCacheTest, RejectsTruncatedCache) {
+  const std::string path = TestPath("signals");
+  WriteCache(path);
+  std::string contents;
+  {
+    std::ifstream input(path, std::ios::in | std::ios::binary);
+    contents.assign(std::istreambuf_iterator<char>(input),
+                    std::istreambuf_iterator<char>());
+  }
+  WriteFile(path, contents.substr(0, contents.size() / 2));
+  SignalCacheReader reader;
+  EXPECT_FALSE(reader.Open(path).ok());
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,161 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/signal_cache.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// IO labels.
+constexpr char kInputFilePath[] = "INPUT_FILE_PATH";
+constexpr char kCacheDir[] = "CACHE_DIR";
+constexpr char kShotChange[] = "IS_SHOT_CHANGE";
+constexpr char kRegions[] = "REGIONS";
+constexpr char kStaticFeatures[] = "STATIC_FEATURES";
+constexpr char kKeyFrames[] = "KEY_FRAMES";
+
+// This calculator records the per-frame signals of the AutoFlip detectors
+// into a signal cache (see signal_cache.h) in CACHE_DIR, keyed by the content
+// hash of the video at INPUT_FILE_PATH. SignalCacheReaderCalculator replays
+// the cache, so that the video can be cropped again with other
+// SignalFusingCalculator or SceneCroppingCalculator options at the speed of
+// decoding and cropping. The video is read once more in Open to hash it.
+//
+// Any number of streams can be recorded for each tag; they are replayed on
+// the same tag and index of SignalCacheReaderCalculator:
+//   IS_SHOT_CHANGE:<i>   bool, e.g. the shot and fused shot changes.
+//   REGIONS:<i>          DetectionSet, e.g. face, text or object regions.
+//   STATIC_FEATURES      StaticFeatures from BorderDetectionCalculator.
+//   KEY_FRAMES           Frames the detectors ran on, of any type. Only
+//                        their timestamps are recorded.
+//
+// The cache only appears in CACHE_DIR once the graph has finished without
+// errors.
+//
+// Example:
+//  node {
+//    calculator: "SignalCacheWriterCalculator"
+//    input_side_packet: "INPUT_FILE_PATH:input_video_path"
+//    input_side_packet: "CACHE_DIR:signal_cache_dir"
+//    input_stream: "IS_SHOT_CHANGE:0:shot_change"
+//    input_stream: "REGIONS:0:face_regions"
+//    input_stream: "STATIC_FEATURES:borders"
+//    input_stream: "KEY_FRAMES:video_frames_scaled_downsampled"
+//  }
+class SignalCacheWriterCalculator : public CalculatorBase {
+ public:
+  SignalCacheWriterCalculator() {}
+  SignalCacheWriterCalculator(const SignalCacheWriterCalculator&) = delete;
+  SignalCacheWriterCalculator& operator=(const SignalCacheWriterCalculator&) =
+      delete;
+
+  static ::mediapipe::Status GetContract(mediapipe::CalculatorContract* cc);
+  ::mediapipe::Status Open(mediapipe::CalculatorContext* cc) override;
+  ::mediapipe::Status Process(mediapipe::CalculatorContext* cc) override;
+  ::mediapipe::Status Close(mediapipe::CalculatorContext* cc) override;
+
+ private:
+  SignalCacheWriter writer_;
+  // Tag and index of each recorded stream, in header order.
+  std::vector<std::pair<std::string, int>> streams_;
+};
+
+REGISTER_CALCULATOR(SignalCacheWriterCalculator);
+
+::mediapipe::Status SignalCacheWriterCalculator::GetContract(
+    mediapipe::CalculatorContract* cc) {
+  cc->InputSidePackets().Tag(kInputFilePath).Set<std::string>();
+  cc->InputSidePackets().Tag(kCacheDir).Set<std::string>();
+  for (int i = 0; i < cc->Inputs().NumEntries(kShotChange); ++i) {
+    cc->Inputs().Get(kShotChange, i).Set<bool>();
+  }
+  for (int i = 0; i < cc->Inputs().NumEntries(kRegions); ++i) {
+    cc->Inputs().Get(kRegions, i).Set<DetectionSet>();
+  }
+  if (cc->Inputs().HasTag(kStaticFeatures)) {
+    cc->Inputs().Tag(kStaticFeatures).Set<StaticFeatures>();
+  }
+  if (cc->Inputs().HasTag(kKeyFrames)) {
+    cc->Inputs().Tag(kKeyFrames).SetAny();
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status SignalCacheWriterCalculator::Open(
+    mediapipe::CalculatorContext* cc) {
+  const auto& cache_dir =
+      cc->InputSidePackets().Tag(kCacheDir).Get<std::string>();
+  RET_CHECK(!cache_dir.empty()) << "Signal cache directory is empty.";
+  SignalCacheHeader header;
+  MP_RETURN_IF_ERROR(ContentHash(
+      cc->InputSidePackets().Tag(kInputFilePath).Get<std::string>(),
+      header.mutable_video_hash()));
+  for (const char* tag : {kShotChange, kRegions, kStaticFeatures}) {
+    for (int i = 0; i < cc->Inputs().NumEntries(tag); ++i) {
+      streams_.emplace_back(tag, i);
+      header.add_stream(absl::StrCat(tag, ":", i));
+    }
+  }
+  return writer_.Open(SignalCachePath(cache_dir, header.video_hash()),
+                      header);
+}
+
+::mediapipe::Status SignalCacheWriterCalculator::Process(
+    mediapipe::CalculatorContext* cc) {
+  SignalCacheRecord record;
+  for (int i = 0; i < streams_.size(); ++i) {
+    const auto& packet =
+        cc->Inputs().Get(streams_[i].first, streams_[i].second).Value();
+    if (packet.IsEmpty()) {
+      continue;
+    }
+    auto* signal = record.add_signal();
+    signal->set_stream(i);
+    if (streams_[i].first == kShotChange) {
+      signal->set_flag(packet.Get<bool>());
+    } else if (streams_[i].first == kRegions) {
+      *signal->mutable_regions() = packet.Get<DetectionSet>();
+    } else {
+      *signal->mutable_static_features() = packet.Get<StaticFeatures>();
+    }
+  }
+  record.set_key_frame(cc->Inputs().HasTag(kKeyFrames) &&
+                       !cc->Inputs().Tag(kKeyFrames).IsEmpty());
+  if (record.signal_size() == 0 && !record.key_frame()) {
+    return ::mediapipe::OkStatus();
+  }
+  record.set_timestamp_us(cc->InputTimestamp().Value());
+  return writer_.Append(record);
+}
+
+::mediapipe::Status SignalCacheWriterCalculator::Close(
+    mediapipe::CalculatorContext* cc) {
+  // A failed run may have missed signals; its partial cache is dropped.
+  if (!cc->GraphStatus().ok()) {
+    return ::mediapipe::OkStatus();
+  }
+  return writer_.Finish();
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,148 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/signal_cache.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kInputFilePath[] = "INPUT_FILE_PATH";
+constexpr char kCacheDir[] = "CACHE_DIR";
+constexpr char kShotChange[] = "IS_SHOT_CHANGE";
+constexpr char kRegions[] = "REGIONS";
+constexpr char kStaticFeatures[] = "STATIC_FEATURES";
+constexpr char kKeyFrames[] = "KEY_FRAMES";
+
+constexpr char kConfig[] = R"(
+    calculator: "SignalCacheWriterCalculator"
+    input_side_packet: "INPUT_FILE_PATH:input_video_path"
+    input_side_packet: "CACHE_DIR:signal_cache_dir"
+    input_stream: "IS_SHOT_CHANGE:0:shot_change"
+    input_stream: "IS_SHOT_CHANGE:1:fusing_change"
+    input_stream: "REGIONS:0:face_regions"
+    input_stream: "STATIC_FEATURES:borders"
+    input_stream: "KEY_FRAMES:key_frames")";
+
+const int kNumFrames = 10;
+
+std::string VideoPath() {
+  return ::testing::TempDir() + "/signal_cache_writer_calculator_test.mp4";
+}
+
+std::unique_ptr<CalculatorRunner> MakeRunner() {
+  {
+    std::ofstream video(VideoPath(), std::ios::out | std::ios::binary);
+    video << "signal cache writer test video";
+  }
+  auto runner = ::absl::make_unique<CalculatorRunner>(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  runner->MutableSidePackets()->Tag(kInputFilePath) =
+      MakePacket<std::string>(VideoPath());
+  runner->MutableSidePackets()->Tag(kCacheDir) =
+      MakePacket<std::string>(::testing::TempDir());
+  return runner;
+}
+
+std::string CachePath() {
+  std::string hash;
+  MP_EXPECT_OK(ContentHash(VideoPath(), &hash));
+  return SignalCachePath(::testing::TempDir(), hash);
+}
+
+TEST(SignalCacheWriterCalculatorTest, RecordsSignals) {
+  auto runner = MakeRunner();
+  auto* inputs = runner->MutableInputs();
+  // Frames 0 to 8 have signals, key frames are every third, frame 9 has
+  // nothing and is not recorded.
+  for (int i = 0; i < kNumFrames - 1; ++i) {
+    const Timestamp timestamp(i * 1000);
+    inputs->Get(kShotChange, 0).packets.push_back(
+        MakePacket<bool>(i == 4).At(timestamp));
+    inputs->Get(kShotChange, 1).packets.push_back(
+        MakePacket<bool>(i == 5).At(timestamp));
+    StaticFeatures borders;
+    borders.add_border()->mutable_border_position()->set_height(i);
+    inputs->Tag(kStaticFeatures).packets.push_back(
+        MakePacket<StaticFeatures>(borders).At(timestamp));
+    if (i % 3 == 0) {
+      DetectionSet regions;
+      regions.add_detections()->set_score(i);
+      inputs->Get(kRegions, 0).packets.push_back(
+          MakePacket<DetectionSet>(regions).At(timestamp));
+      inputs->Tag(kKeyFrames).packets.push_back(
+          MakePacket<int>(i).At(timestamp));
+    }
+  }
+  MP_ASSERT_OK(runner->Run());
+
+  SignalCacheReader reader;
+  MP_ASSERT_OK(reader.Open(CachePath()));
+  const auto& header = reader.header();
+  ASSERT_EQ(4, header.stream_size());
+  EXPECT_EQ("IS_SHOT_CHANGE:0", header.stream(0));
+  EXPECT_EQ("IS_SHOT_CHANGE:1", header.stream(1));
+  EXPECT_EQ("REGIONS:0", header.stream(2));
+  EXPECT_EQ("STATIC_FEATURES:0", header.stream(3));
+  ASSERT_EQ(kNumFrames - 1, reader.num_records());
+
+  SignalCacheRecord record;
+  bool has_record = false;
+  for (int i = 0; i < kNumFrames - 1; ++i) {
+    MP_ASSERT_OK(reader.Next(&record, &has_record));
+    ASSERT_TRUE(has_record);
+    EXPECT_EQ(i * 1000, record.timestamp_us());
+    EXPECT_EQ(i % 3 == 0, record.key_frame());
+    ASSERT_EQ(i % 3 == 0 ? 4 : 3, record.signal_size());
+    EXPECT_EQ(i == 4, record.signal(0).flag());
+    EXPECT_EQ(i == 5, record.signal(1).flag());
+    const auto& borders = record.signal(record.signal_size() - 1);
+    EXPECT_EQ(3, borders.stream());
+    EXPECT_EQ(i, borders.static_features().border(0).border_position()
+                     .height());
+    if (i % 3 == 0) {
+      EXPECT_EQ(2, record.signal(2).stream());
+      EXPECT_EQ(i, record.signal(2).regions().detections(0).score());
+    }
+  }
+}
+
+TEST(SignalCacheWriterCalculatorTest, DropsCacheOfFailedRun) {
+  auto runner = MakeRunner();
+  std::remove(CachePath().c_str());
+  // Out of order packets fail the run.
+  runner->MutableInputs()->Get(kShotChange, 0).packets.push_back(
+      MakePacket<bool>(true).At(Timestamp(2000)));
+  runner->MutableInputs()->Get(kShotChange, 0).packets.push_back(
+      MakePacket<bool>(true).At(Timestamp(1000)));
+  EXPECT_FALSE(runner->Run().ok());
+  EXPECT_FALSE(std::ifstream(CachePath()).is_open());
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
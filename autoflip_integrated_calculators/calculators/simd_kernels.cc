@@ -0,0 +1,238 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/simd_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__wasm_simd128__)
+#include <wasm_simd128.h>
+#endif
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+#if defined(__wasm_simd128__)
+constexpr int kLanes = 4;
+#else
+constexpr int kLanes = 1;
+#endif
+
+// Scalar kernels, used for the elements after the last full SIMD vector and
+// for every element in builds without SIMD128.
+
+float PairDistance(const PointPairs& pairs, int i, float scale_x,
+                   float scale_y) {
+  const float dx = (pairs.x1[i] - pairs.x2[i]) * scale_x;
+  const float dy = (pairs.y1[i] - pairs.y2[i]) * scale_y;
+  const float dz = pairs.z1[i] - pairs.z2[i];
+  return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+float Overlap(float x1, float y1, float w1, float h1, const Boxes& boxes,
+              int i) {
+  const float right1 = x1 + w1, bottom1 = y1 + h1;
+  const float x2 = boxes.xmin[i], y2 = boxes.ymin[i];
+  const float right2 = x2 + boxes.width[i], bottom2 = y2 + boxes.height[i];
+  const float intersection_width =
+      std::max(0.0f, std::min(right1, right2) - std::max(x1, x2));
+  const float intersection_height =
+      std::max(0.0f, std::min(bottom1, bottom2) - std::max(y1, y2));
+  const float bounding_width = std::max(right1, right2) - std::min(x1, x2);
+  const float bounding_height = std::max(bottom1, bottom2) - std::min(y1, y2);
+  return (intersection_width * intersection_height) /
+         (bounding_width * bounding_height);
+}
+
+void ClampBox(Boxes* boxes, int i) {
+  const float xmin = boxes->xmin[i], ymin = boxes->ymin[i];
+  const float x = std::max(0.0f, xmin);
+  const float y = std::max(0.0f, ymin);
+  boxes->width[i] = std::min(boxes->width[i] - x + xmin, 1.0f - x);
+  boxes->height[i] = std::min(boxes->height[i] - y + ymin, 1.0f - y);
+  boxes->xmin[i] = x;
+  boxes->ymin[i] = y;
+}
+
+// Returns log(p / (1 - p)), which is -inf for p <= 0 and +inf for p >= 1, so
+// that no logit or every logit is above it.
+float Logit(double probability) {
+  if (probability <= 0.0) {
+    return -std::numeric_limits<float>::infinity();
+  }
+  if (probability >= 1.0) {
+    return std::numeric_limits<float>::infinity();
+  }
+  return static_cast<float>(std::log(probability) - std::log1p(-probability));
+}
+
+}  // namespace
+
+bool SimdKernelsEnabled() { return kLanes > 1; }
+
+void PointPairs::Add(float from_x, float from_y, float from_z, float to_x,
+                     float to_y, float to_z) {
+  x1.push_back(from_x);
+  y1.push_back(from_y);
+  z1.push_back(from_z);
+  x2.push_back(to_x);
+  y2.push_back(to_y);
+  z2.push_back(to_z);
+}
+
+void PointPairs::Clear() {
+  for (auto* values : {&x1, &y1, &z1, &x2, &y2, &z2}) {
+    values->clear();
+  }
+}
+
+void Boxes::Add(float x, float y, float w, float h) {
+  xmin.push_back(x);
+  ymin.push_back(y);
+  width.push_back(w);
+  height.push_back(h);
+}
+
+void Boxes::Clear() {
+  for (auto* values : {&xmin, &ymin, &width, &height}) {
+    values->clear();
+  }
+}
+
+void PairDistances(const PointPairs& pairs, float scale_x, float scale_y,
+                   float* distances) {
+  const int size = pairs.size();
+  int i = 0;
+#if defined(__wasm_simd128__)
+  const v128_t sx = wasm_f32x4_splat(scale_x);
+  const v128_t sy = wasm_f32x4_splat(scale_y);
+  for (; i + kLanes <= size; i += kLanes) {
+    const v128_t dx = wasm_f32x4_mul(
+        wasm_f32x4_sub(wasm_v128_load(&pairs.x1[i]),
+                       wasm_v128_load(&pairs.x2[i])),
+        sx);
+    const v128_t dy = wasm_f32x4_mul(
+        wasm_f32x4_sub(wasm_v128_load(&pairs.y1[i]),
+                       wasm_v128_load(&pairs.y2[i])),
+        sy);
+    const v128_t dz = wasm_f32x4_sub(wasm_v128_load(&pairs.z1[i]),
+                                     wasm_v128_load(&pairs.z2[i]));
+    const v128_t squared = wasm_f32x4_add(
+        wasm_f32x4_add(wasm_f32x4_mul(dx, dx), wasm_f32x4_mul(dy, dy)),
+        wasm_f32x4_mul(dz, dz));
+    wasm_v128_store(distances + i, wasm_f32x4_sqrt(squared));
+  }
+#endif
+  for (; i < size; ++i) {
+    distances[i] = PairDistance(pairs, i, scale_x, scale_y);
+  }
+}
+
+void OverlapMatrix(const Boxes& rows, const Boxes& cols, float* overlaps) {
+  const int num_cols = cols.size();
+  for (int row = 0; row < rows.size(); ++row) {
+    const float x1 = rows.xmin[row], y1 = rows.ymin[row];
+    const float w1 = rows.width[row], h1 = rows.height[row];
+    float* out = overlaps + row * num_cols;
+    int i = 0;
+#if defined(__wasm_simd128__)
+    const v128_t left1 = wasm_f32x4_splat(x1);
+    const v128_t top1 = wasm_f32x4_splat(y1);
+    const v128_t right1 = wasm_f32x4_splat(x1 + w1);
+    const v128_t bottom1 = wasm_f32x4_splat(y1 + h1);
+    const v128_t zero = wasm_f32x4_splat(0.0f);
+    for (; i + kLanes <= num_cols; i += kLanes) {
+      const v128_t left2 = wasm_v128_load(&cols.xmin[i]);
+      const v128_t top2 = wasm_v128_load(&cols.ymin[i]);
+      const v128_t right2 =
+          wasm_f32x4_add(left2, wasm_v128_load(&cols.width[i]));
+      const v128_t bottom2 =
+          wasm_f32x4_add(top2, wasm_v128_load(&cols.height[i]));
+      const v128_t intersection_width = wasm_f32x4_max(
+          zero, wasm_f32x4_sub(wasm_f32x4_min(right1, right2),
+                               wasm_f32x4_max(left1, left2)));
+      const v128_t intersection_height = wasm_f32x4_max(
+          zero, wasm_f32x4_sub(wasm_f32x4_min(bottom1, bottom2),
+                               wasm_f32x4_max(top1, top2)));
+      const v128_t bounding_width = wasm_f32x4_sub(
+          wasm_f32x4_max(right1, right2), wasm_f32x4_min(left1, left2));
+      const v128_t bounding_height = wasm_f32x4_sub(
+          wasm_f32x4_max(bottom1, bottom2), wasm_f32x4_min(top1, top2));
+      wasm_v128_store(
+          out + i,
+          wasm_f32x4_div(
+              wasm_f32x4_mul(intersection_width, intersection_height),
+              wasm_f32x4_mul(bounding_width, bounding_height)));
+    }
+#endif
+    for (; i < num_cols; ++i) {
+      out[i] = Overlap(x1, y1, w1, h1, cols, i);
+    }
+  }
+}
+
+void ClampToUnitSquare(Boxes* boxes) {
+  const int size = boxes->size();
+  int i = 0;
+#if defined(__wasm_simd128__)
+  const v128_t zero = wasm_f32x4_splat(0.0f);
+  const v128_t one = wasm_f32x4_splat(1.0f);
+  for (; i + kLanes <= size; i += kLanes) {
+    const v128_t xmin = wasm_v128_load(&boxes->xmin[i]);
+    const v128_t ymin = wasm_v128_load(&boxes->ymin[i]);
+    const v128_t x = wasm_f32x4_max(zero, xmin);
+    const v128_t y = wasm_f32x4_max(zero, ymin);
+    const v128_t width = wasm_f32x4_min(
+        wasm_f32x4_add(
+            wasm_f32x4_sub(wasm_v128_load(&boxes->width[i]), x), xmin),
+        wasm_f32x4_sub(one, x));
+    const v128_t height = wasm_f32x4_min(
+        wasm_f32x4_add(
+            wasm_f32x4_sub(wasm_v128_load(&boxes->height[i]), y), ymin),
+        wasm_f32x4_sub(one, y));
+    wasm_v128_store(&boxes->xmin[i], x);
+    wasm_v128_store(&boxes->ymin[i], y);
+    wasm_v128_store(&boxes->width[i], width);
+    wasm_v128_store(&boxes->height[i], height);
+  }
+#endif
+  for (; i < size; ++i) {
+    ClampBox(boxes, i);
+  }
+}
+
+void LogitsAboveProbability(const float* logits, int size, double probability,
+                            bool* is_above) {
+  const float threshold = Logit(probability);
+  int i = 0;
+#if defined(__wasm_simd128__)
+  const v128_t thresholds = wasm_f32x4_splat(threshold);
+  for (; i + kLanes <= size; i += kLanes) {
+    const int mask = wasm_i32x4_bitmask(
+        wasm_f32x4_gt(wasm_v128_load(logits + i), thresholds));
+    for (int lane = 0; lane < kLanes; ++lane) {
+      is_above[i + lane] = (mask >> lane) & 1;
+    }
+  }
+#endif
+  for (; i < size; ++i) {
+    is_above[i] = logits[i] > threshold;
+  }
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,77 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_SIMD_KERNELS_H_
+#define MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_SIMD_KERNELS_H_
+
+#include <vector>
+
+namespace mediapipe {
+namespace autoflip {
+
+// Per-frame geometry kernels of the AutoFlip calculators. Inputs are kept in
+// structure-of-arrays layout so that each SIMD lane holds one element. When
+// compiled with -msimd128 (bazel build --define wasm_simd=true) the kernels
+// use WebAssembly SIMD128, four lanes at a time; otherwise they run the
+// scalar loops. Both paths perform the same float operations in the same
+// order and give the same results.
+
+// Returns true if the kernels were compiled with WebAssembly SIMD128.
+bool SimdKernelsEnabled();
+
+// Pairs of 3D points, e.g. face mesh landmarks in normalized coordinates.
+struct PointPairs {
+  std::vector<float> x1, y1, z1;
+  std::vector<float> x2, y2, z2;
+
+  void Add(float from_x, float from_y, float from_z, float to_x, float to_y,
+           float to_z);
+  void Clear();
+  int size() const { return x1.size(); }
+};
+
+// Axis-aligned boxes, e.g. relative bounding boxes of detections.
+struct Boxes {
+  std::vector<float> xmin, ymin, width, height;
+
+  void Add(float x, float y, float w, float h);
+  void Clear();
+  int size() const { return xmin.size(); }
+};
+
+// Writes the distance between the points of each pair to |distances|, which
+// must hold pairs.size() values. x and y differences are scaled by |scale_x|
+// and |scale_y|, e.g. the frame size, and z differences are not.
+void PairDistances(const PointPairs& pairs, float scale_x, float scale_y,
+                   float* distances);
+
+// Writes the overlap of every box in |rows| with every box in |cols| to
+// |overlaps|, row-major, which must hold rows.size() * cols.size() values.
+// The overlap is the intersection area divided by the area of the bounding
+// box of both boxes, as cv::Rect2f (a & b).area() / (a | b).area() gives for
+// boxes of positive size.
+void OverlapMatrix(const Boxes& rows, const Boxes& cols, float* overlaps);
+
+// Clips |boxes| in place to the unit square.
+void ClampToUnitSquare(Boxes* boxes);
+
+// Sets is_above[i] if sigmoid(logits[i]) > |probability|, without evaluating
+// the sigmoid: the logits are compared with the logit of |probability|.
+void LogitsAboveProbability(const float* logits, int size, double probability,
+                            bool* is_above);
+
+}  // namespace autoflip
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_SIMD_KERNELS_H_
@@ -0,0 +1,122 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Measures the per-call cost of the kernels of simd_kernels.h on a fixed
+// synthetic input, so that a scalar and a SIMD128 wasm build of this binary
+// can be compared under Node on the same data.
+//
+// Example, with the binary built by Emscripten once as is and once with
+// --define wasm_simd=true:
+//   node scalar/simd_kernels_benchmark.js --iterations=100000
+//   node simd/simd_kernels_benchmark.js --iterations=100000
+
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/simd_kernels.h"
+#include "mediapipe/framework/port/commandlineflags.h"
+
+DEFINE_int32(iterations, 100000, "Number of calls timed per kernel.");
+DEFINE_int32(num_faces, 6, "Number of faces per frame.");
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+// Lip pairs per face, the mouth width and three heights for each of the
+// inner and outer contours, as LipTrackCalculator measures them.
+const int kLipPairsPerFace = 8;
+// Prediction window of ShotBoundaryDecoderCalculator.
+const int kPredictionWindow = 50;
+
+float Coordinate(int i, int salt) {
+  return std::fmod(0.37f * i + 0.11f * salt, 1.0f);
+}
+
+// Returns the nanoseconds per call of |kernel|. |checksum| keeps the results
+// alive.
+double NanosPerCall(const std::function<float()>& kernel, float* checksum) {
+  const absl::Time start = absl::Now();
+  for (int i = 0; i < FLAGS_iterations; ++i) {
+    *checksum += kernel();
+  }
+  return absl::ToDoubleNanoseconds(absl::Now() - start) / FLAGS_iterations;
+}
+
+void RunBenchmark() {
+  PointPairs pairs;
+  for (int i = 0; i < FLAGS_num_faces * kLipPairsPerFace; ++i) {
+    pairs.Add(Coordinate(i, 0), Coordinate(i, 1), Coordinate(i, 2),
+              Coordinate(i, 3), Coordinate(i, 4), Coordinate(i, 5));
+  }
+  std::vector<float> distances(pairs.size());
+
+  Boxes faces, tracks;
+  for (int i = 0; i < FLAGS_num_faces; ++i) {
+    faces.Add(Coordinate(i, 0), Coordinate(i, 1), 0.2f, 0.3f);
+    tracks.Add(Coordinate(i, 2), Coordinate(i, 3), 0.25f, 0.25f);
+  }
+  std::vector<float> overlaps(faces.size() * tracks.size());
+
+  std::vector<float> logits;
+  for (int i = 0; i < kPredictionWindow; ++i) {
+    logits.push_back(8.0f * Coordinate(i, 0) - 4.0f);
+  }
+  bool is_above[kPredictionWindow];
+
+  float checksum = 0.0f;
+  std::cout << absl::StrFormat("simd128: %s, %d faces\n",
+                               SimdKernelsEnabled() ? "yes" : "no",
+                               FLAGS_num_faces);
+  std::cout << absl::StrFormat("%-24s %12s\n", "kernel", "ns/call");
+  std::cout << absl::StrFormat(
+      "%-24s %12.1f\n", "PairDistances", NanosPerCall([&]() {
+        PairDistances(pairs, 640.0f, 360.0f, distances.data());
+        return distances[0];
+      }, &checksum));
+  std::cout << absl::StrFormat(
+      "%-24s %12.1f\n", "OverlapMatrix", NanosPerCall([&]() {
+        OverlapMatrix(faces, tracks, overlaps.data());
+        return overlaps[0];
+      }, &checksum));
+  std::cout << absl::StrFormat(
+      "%-24s %12.1f\n", "ClampToUnitSquare", NanosPerCall([&]() {
+        // Clamping is idempotent, so the same boxes are clamped every time.
+        ClampToUnitSquare(&faces);
+        return faces.width[0];
+      }, &checksum));
+  std::cout << absl::StrFormat(
+      "%-24s %12.1f\n", "LogitsAboveProbability", NanosPerCall([&]() {
+        LogitsAboveProbability(logits.data(), kPredictionWindow, 0.5,
+                               is_above);
+        return is_above[0] ? 1.0f : 0.0f;
+      }, &checksum));
+  std::cout << absl::StrFormat("checksum %g\n", checksum);
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
+
+int main(int argc, char** argv) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  ::mediapipe::autoflip::RunBenchmark();
+  return 0;
+}
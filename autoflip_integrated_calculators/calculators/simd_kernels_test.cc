@@ -0,0 +1,130 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/simd_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+// Not a multiple of the SIMD width, so that both the vector loop and the
+// scalar tail are covered.
+const int kSize = 11;
+
+float Coordinate(int i, int salt) {
+  return std::fmod(0.37f * i + 0.11f * salt, 1.0f);
+}
+
+Boxes MakeBoxes(int size, int salt) {
+  Boxes boxes;
+  for (int i = 0; i < size; ++i) {
+    boxes.Add(Coordinate(i, salt) - 0.2f, Coordinate(i, salt + 1) - 0.2f,
+              0.1f + 0.5f * Coordinate(i, salt + 2),
+              0.1f + 0.5f * Coordinate(i, salt + 3));
+  }
+  return boxes;
+}
+
+TEST(SimdKernelsTest, PairDistances) {
+  PointPairs pairs;
+  for (int i = 0; i < kSize; ++i) {
+    pairs.Add(Coordinate(i, 0), Coordinate(i, 1), Coordinate(i, 2),
+              Coordinate(i, 3), Coordinate(i, 4), Coordinate(i, 5));
+  }
+  std::vector<float> distances(kSize);
+  PairDistances(pairs, 640.0f, 360.0f, distances.data());
+  for (int i = 0; i < kSize; ++i) {
+    const double expected = std::sqrt(
+        std::pow((pairs.x1[i] - pairs.x2[i]) * 640.0, 2) +
+        std::pow((pairs.y1[i] - pairs.y2[i]) * 360.0, 2) +
+        std::pow(pairs.z1[i] - pairs.z2[i], 2));
+    EXPECT_NEAR(expected, distances[i], 1e-3) << "pair " << i;
+  }
+}
+
+TEST(SimdKernelsTest, OverlapMatrixMatchesOpenCvRects) {
+  const Boxes rows = MakeBoxes(3, 0);
+  const Boxes cols = MakeBoxes(kSize, 5);
+  std::vector<float> overlaps(rows.size() * cols.size());
+  OverlapMatrix(rows, cols, overlaps.data());
+  for (int row = 0; row < rows.size(); ++row) {
+    const cv::Rect2f rect_1(rows.xmin[row], rows.ymin[row], rows.width[row],
+                            rows.height[row]);
+    for (int col = 0; col < cols.size(); ++col) {
+      const cv::Rect2f rect_2(cols.xmin[col], cols.ymin[col],
+                              cols.width[col], cols.height[col]);
+      EXPECT_NEAR((rect_1 & rect_2).area() / (rect_1 | rect_2).area(),
+                  overlaps[row * cols.size() + col], 1e-6)
+          << "row " << row << " col " << col;
+    }
+  }
+}
+
+TEST(SimdKernelsTest, OverlapOfSameBoxIsOne) {
+  const Boxes boxes = MakeBoxes(kSize, 2);
+  std::vector<float> overlaps(kSize * kSize);
+  OverlapMatrix(boxes, boxes, overlaps.data());
+  for (int i = 0; i < kSize; ++i) {
+    EXPECT_FLOAT_EQ(1.0f, overlaps[i * kSize + i]);
+  }
+}
+
+TEST(SimdKernelsTest, ClampToUnitSquare) {
+  Boxes boxes = MakeBoxes(kSize, 1);
+  boxes.Add(-0.5f, 0.8f, 2.0f, 0.5f);
+  const Boxes input = boxes;
+  ClampToUnitSquare(&boxes);
+  for (int i = 0; i < input.size(); ++i) {
+    const float x = std::max(0.0f, input.xmin[i]);
+    const float y = std::max(0.0f, input.ymin[i]);
+    EXPECT_FLOAT_EQ(x, boxes.xmin[i]);
+    EXPECT_FLOAT_EQ(y, boxes.ymin[i]);
+    EXPECT_FLOAT_EQ(std::min(input.width[i] - x + input.xmin[i], 1 - x),
+                    boxes.width[i]);
+    EXPECT_FLOAT_EQ(std::min(input.height[i] - y + input.ymin[i], 1 - y),
+                    boxes.height[i]);
+  }
+  EXPECT_FLOAT_EQ(1.0f, boxes.width.back());
+  EXPECT_FLOAT_EQ(0.2f, boxes.height.back());
+}
+
+TEST(SimdKernelsTest, LogitsAboveProbabilityMatchesSigmoid) {
+  std::vector<float> logits;
+  for (int i = 0; i < kSize; ++i) {
+    logits.push_back(-3.0f + 0.6f * i);
+  }
+  bool is_above[kSize];
+  for (const double probability : {0.2, 0.5, 0.9}) {
+    LogitsAboveProbability(logits.data(), kSize, probability, is_above);
+    for (int i = 0; i < kSize; ++i) {
+      EXPECT_EQ(1 / (1 + std::exp(-logits[i])) > probability, is_above[i])
+          << "logit " << logits[i] << " probability " << probability;
+    }
+  }
+  LogitsAboveProbability(logits.data(), kSize, 1.0, is_above);
+  EXPECT_EQ(kSize, std::count(is_above, is_above + kSize, false));
+  LogitsAboveProbability(logits.data(), kSize, 0.0, is_above);
+  EXPECT_EQ(kSize, std::count(is_above, is_above + kSize, true));
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
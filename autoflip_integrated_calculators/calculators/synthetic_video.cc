@@ -0,0 +1,187 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/synthetic_video.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/opencv_video_inc.h"
+#include "mediapipe/framework/port/ret_check.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr double kPi = 3.14159265358979;
+// Horizontal centers of the two faces, before they drift.
+constexpr float kFaceCenterX[] = {0.3f, 0.7f};
+constexpr double kDriftAmplitude = 0.03;
+constexpr double kDriftPeriodSeconds = 3;
+constexpr double kMouthHz = 4;
+
+// Background of each shot; neighbouring shots always differ.
+const cv::Scalar kBackgrounds[] = {
+    {90, 60, 40}, {40, 110, 70}, {60, 60, 150},
+    {130, 120, 50}, {110, 50, 110}, {70, 100, 140}};
+const cv::Scalar kSkin(140, 175, 215);
+const cv::Scalar kDark(40, 30, 30);
+const cv::Scalar kLight(235, 235, 235);
+
+void DrawTalkingFaces(const SyntheticVideoSpec& spec, double seconds,
+                      int talking_face, cv::Mat* frame) {
+  const double h = spec.height;
+  for (int face = 0; face < 2; ++face) {
+    const double drift = kDriftAmplitude *
+                         std::sin(2 * kPi * seconds / kDriftPeriodSeconds +
+                                  face);
+    const cv::Point center((kFaceCenterX[face] + drift) * spec.width,
+                           0.42 * h);
+    // Shoulders, head, eyes and mouth.
+    cv::rectangle(*frame,
+                  cv::Point(center.x - 0.2 * h, center.y + 0.2 * h),
+                  cv::Point(center.x + 0.2 * h, h), kDark, cv::FILLED);
+    cv::ellipse(*frame, center, cv::Size(0.11 * h, 0.15 * h), 0, 0, 360,
+                kSkin, cv::FILLED);
+    for (const int side : {-1, 1}) {
+      cv::circle(*frame,
+                 cv::Point(center.x + side * 0.045 * h, center.y - 0.03 * h),
+                 std::max(1.0, 0.015 * h), kDark, cv::FILLED);
+    }
+    double mouth_height = 0.004 * h;
+    if (face == talking_face) {
+      mouth_height +=
+          0.03 * h * (0.5 + 0.5 * std::sin(2 * kPi * kMouthHz * seconds));
+    }
+    cv::ellipse(*frame, cv::Point(center.x, center.y + 0.075 * h),
+                cv::Size(0.045 * h, std::max(1.0, mouth_height)), 0, 0, 360,
+                kDark, cv::FILLED);
+  }
+}
+
+void DrawText(const SyntheticVideoSpec& spec, const std::string& text,
+              double x, double y, double scale, cv::Mat* frame) {
+  const double font_scale = scale * spec.height / 360.0;
+  cv::putText(*frame, text, cv::Point(x * spec.width, y * spec.height),
+              cv::FONT_HERSHEY_SIMPLEX, font_scale, kLight,
+              std::max(1, static_cast<int>(2 * font_scale)));
+}
+
+void DrawScrollingText(const SyntheticVideoSpec& spec, int frame_in_shot,
+                       cv::Mat* frame) {
+  const double line_spacing = 0.1;
+  const double offset = frame_in_shot * 0.01;
+  const int first_line = static_cast<int>(offset / line_spacing);
+  for (int line = first_line; line < first_line + 12; ++line) {
+    const double y = 0.1 + line * line_spacing - offset;
+    DrawText(spec, absl::StrCat("Synthetic caption line ", line), 0.08, y,
+             0.8, frame);
+  }
+}
+
+void DrawStaticSlide(const SyntheticVideoSpec& spec, int shot,
+                     cv::Mat* frame) {
+  cv::rectangle(*frame, cv::Point(0, 0),
+                cv::Point(spec.width, 0.2 * spec.height), kDark, cv::FILLED);
+  DrawText(spec, absl::StrCat("Slide ", shot), 0.05, 0.14, 1.2, frame);
+  for (int bullet = 0; bullet < 4; ++bullet) {
+    DrawText(spec, absl::StrCat("- Bullet point ", bullet), 0.1,
+             0.35 + 0.15 * bullet, 0.9, frame);
+  }
+}
+
+}  // namespace
+
+SyntheticVideoGroundTruth SyntheticGroundTruth(
+    const SyntheticVideoSpec& spec) {
+  SyntheticVideoGroundTruth truth;
+  truth.set_width(spec.width);
+  truth.set_height(spec.height);
+  truth.set_fps(spec.fps);
+  truth.set_num_frames(spec.num_frames);
+  int num_talking_shots = 0;
+  for (int first = 0, index = 0; first < spec.num_frames;
+       first += spec.shot_frames, ++index) {
+    auto* shot = truth.add_shot();
+    shot->set_first_frame(first);
+    shot->set_num_frames(std::min(spec.shot_frames, spec.num_frames - first));
+    shot->set_scene(
+        static_cast<SyntheticVideoGroundTruth::Shot::Scene>(index % 3));
+    if (shot->scene() == SyntheticVideoGroundTruth::Shot::TALKING_FACES) {
+      shot->set_speaker_center_x(kFaceCenterX[num_talking_shots++ % 2]);
+    }
+  }
+  return truth;
+}
+
+void RenderSyntheticFrame(const SyntheticVideoSpec& spec, int index,
+                          cv::Mat* frame) {
+  const int shot = index / spec.shot_frames;
+  const int frame_in_shot = index % spec.shot_frames;
+  frame->create(spec.height, spec.width, CV_8UC3);
+  frame->setTo(kBackgrounds[shot % 6]);
+  switch (shot % 3) {
+    case SyntheticVideoGroundTruth::Shot::TALKING_FACES:
+      DrawTalkingFaces(spec, index / spec.fps, (shot / 3) % 2, frame);
+      break;
+    case SyntheticVideoGroundTruth::Shot::SCROLLING_TEXT:
+      DrawScrollingText(spec, frame_in_shot, frame);
+      break;
+    case SyntheticVideoGroundTruth::Shot::STATIC_SLIDE:
+      DrawStaticSlide(spec, shot, frame);
+      break;
+  }
+}
+
+::mediapipe::Status WriteSyntheticVideo(const SyntheticVideoSpec& spec,
+                                        const std::string& video_path,
+                                        const std::string& yuv_path) {
+  RET_CHECK(spec.width % 2 == 0 && spec.height % 2 == 0)
+      << "Synthetic video dimensions must be even.";
+  RET_CHECK_GT(spec.shot_frames, 0);
+  cv::VideoWriter writer;
+  if (!video_path.empty()) {
+    writer.open(video_path, cv::VideoWriter::fourcc('m', 'p', '4', 'v'),
+                spec.fps, cv::Size(spec.width, spec.height));
+    RET_CHECK(writer.isOpened()) << "Fail to open video file " << video_path;
+  }
+  std::ofstream yuv;
+  if (!yuv_path.empty()) {
+    yuv.open(yuv_path, std::ios::out | std::ios::binary);
+    RET_CHECK(yuv.is_open()) << "Fail to open " << yuv_path;
+  }
+  cv::Mat frame, i420;
+  for (int i = 0; i < spec.num_frames; ++i) {
+    RenderSyntheticFrame(spec, i, &frame);
+    if (writer.isOpened()) {
+      writer.write(frame);
+    }
+    if (yuv.is_open()) {
+      cv::cvtColor(frame, i420, cv::COLOR_BGR2YUV_I420);
+      yuv.write(reinterpret_cast<const char*>(i420.data),
+                i420.total() * i420.elemSize());
+    }
+  }
+  if (yuv.is_open()) {
+    yuv.close();
+    RET_CHECK(!yuv.fail()) << "Fail to write " << yuv_path;
+  }
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,64 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_SYNTHETIC_VIDEO_H_
+#define MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_SYNTHETIC_VIDEO_H_
+
+#include <string>
+
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// Deterministic synthetic videos with a known ground truth, for the
+// performance suite. A video is a sequence of shots of shot_frames frames,
+// separated by hard cuts, with a different background color each. The shots
+// cycle through three scenes:
+//  - TALKING_FACES: two face sprites that drift sideways; one of them talks,
+//    i.e. its mouth opens and closes four times a second. The left face
+//    talks in the first talking shot, the right one in the next, and so on.
+//  - SCROLLING_TEXT: lines of text scrolling up.
+//  - STATIC_SLIDE: a title bar and bullet lines that do not move.
+// The same spec always renders the same pixels.
+
+struct SyntheticVideoSpec {
+  // Both must be even, for I420.
+  int width = 640;
+  int height = 360;
+  double fps = 30;
+  int num_frames = 300;
+  int shot_frames = 60;
+};
+
+// Returns the shots of |spec|.
+SyntheticVideoGroundTruth SyntheticGroundTruth(const SyntheticVideoSpec& spec);
+
+// Renders frame |index| of |spec| into |frame| as BGR.
+void RenderSyntheticFrame(const SyntheticVideoSpec& spec, int index,
+                          cv::Mat* frame);
+
+// Writes the frames of |spec| as an mp4 file to |video_path| and as raw
+// I420 frames to |yuv_path|, for graph_runner_benchmark. Either path may be
+// empty to skip that output.
+::mediapipe::Status WriteSyntheticVideo(const SyntheticVideoSpec& spec,
+                                        const std::string& video_path,
+                                        const std::string& yuv_path);
+
+}  // namespace autoflip
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_EXAMPLES_DESKTOP_AUTOFLIP_CALCULATORS_SYNTHETIC_VIDEO_H_
@@ -0,0 +1,110 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/examples/desktop/autoflip/calculators/synthetic_video.h"
+
+#include <fstream>
+
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+bool SameFrames(const cv::Mat& a, const cv::Mat& b) {
+  cv::Mat difference;
+  cv::absdiff(a, b, difference);
+  return cv::countNonZero(difference.reshape(1)) == 0;
+}
+
+SyntheticVideoSpec SmallSpec() {
+  SyntheticVideoSpec spec;
+  spec.width = 160;
+  spec.height = 90;
+  spec.num_frames = 100;
+  spec.shot_frames = 15;
+  return spec;
+}
+
+TEST(SyntheticVideoTest, GroundTruth) {
+  const auto truth = SyntheticGroundTruth(SmallSpec());
+  EXPECT_EQ(100, truth.num_frames());
+  ASSERT_EQ(7, truth.shot_size());
+  EXPECT_EQ(45, truth.shot(3).first_frame());
+  EXPECT_EQ(10, truth.shot(6).num_frames());
+  EXPECT_EQ(SyntheticVideoGroundTruth::Shot::TALKING_FACES,
+            truth.shot(0).scene());
+  EXPECT_EQ(SyntheticVideoGroundTruth::Shot::SCROLLING_TEXT,
+            truth.shot(1).scene());
+  EXPECT_EQ(SyntheticVideoGroundTruth::Shot::STATIC_SLIDE,
+            truth.shot(2).scene());
+  // The talking face alternates between talking shots.
+  EXPECT_FLOAT_EQ(0.3, truth.shot(0).speaker_center_x());
+  EXPECT_FLOAT_EQ(0.7, truth.shot(3).speaker_center_x());
+  EXPECT_FLOAT_EQ(0.3, truth.shot(6).speaker_center_x());
+  EXPECT_FLOAT_EQ(-1, truth.shot(1).speaker_center_x());
+}
+
+TEST(SyntheticVideoTest, RendersDeterministically) {
+  const auto spec = SmallSpec();
+  cv::Mat first, second;
+  for (const int index : {0, 20, 40}) {
+    RenderSyntheticFrame(spec, index, &first);
+    RenderSyntheticFrame(spec, index, &second);
+    EXPECT_EQ(spec.width, first.cols);
+    EXPECT_EQ(spec.height, first.rows);
+    EXPECT_TRUE(SameFrames(first, second));
+  }
+}
+
+TEST(SyntheticVideoTest, OnlySlidesAreStatic) {
+  const auto spec = SmallSpec();
+  cv::Mat a, b;
+  // Static slide.
+  RenderSyntheticFrame(spec, 31, &a);
+  RenderSyntheticFrame(spec, 40, &b);
+  EXPECT_TRUE(SameFrames(a, b));
+  // Scrolling text.
+  RenderSyntheticFrame(spec, 16, &a);
+  RenderSyntheticFrame(spec, 20, &b);
+  EXPECT_FALSE(SameFrames(a, b));
+  // Talking faces.
+  RenderSyntheticFrame(spec, 1, &a);
+  RenderSyntheticFrame(spec, 5, &b);
+  EXPECT_FALSE(SameFrames(a, b));
+}
+
+TEST(SyntheticVideoTest, WritesI420) {
+  const auto spec = SmallSpec();
+  const std::string path = ::testing::TempDir() + "/synthetic_video_test.yuv";
+  MP_ASSERT_OK(WriteSyntheticVideo(spec, "", path));
+  std::ifstream yuv(path, std::ios::in | std::ios::binary | std::ios::ate);
+  ASSERT_TRUE(yuv.is_open());
+  EXPECT_EQ(spec.num_frames * spec.width * spec.height * 3 / 2,
+            static_cast<int64>(yuv.tellg()));
+}
+
+TEST(SyntheticVideoTest, RejectsOddDimensions) {
+  auto spec = SmallSpec();
+  spec.width = 161;
+  EXPECT_FALSE(WriteSyntheticVideo(spec, "", "").ok());
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
@@ -0,0 +1,335 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "google/protobuf/util/delimited_message_util.h"
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/location_data.pb.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace autoflip {
+
+// IO labels.
+constexpr char kInputShotChange[] = "IS_SHOT_CHANGE";
+constexpr char kInputSpeakerChange[] = "IS_SPEAKER_CHANGE";
+constexpr char kInputSpeakers[] = "DETECTIONS_SPEAKERS";
+constexpr char kInputTextRegions[] = "TEXT_REGIONS";
+constexpr char kInputLipStatistics[] = "LIP_STATISTICS";
+constexpr char kOutputFilePath[] = "OUTPUT_FILE_PATH";
+constexpr char kCheckpoint[] = "CHECKPOINT";
+constexpr char kCheckpointPath[] = "CHECKPOINT_PATH";
+
+// Upstream checkpoints kept while waiting for a downstream one.
+constexpr int kMaxCheckpointHistory = 16;
+
+// This calculator records the decisions of the AutoFlip graph into a compact
+// timeline trace, as a much cheaper alternative to rendering and encoding
+// debug videos. For every timestamp that carries at least one signal, one
+// TraceRecord is appended to the file as a length-delimited proto. Use
+// trace_reader to print or export the trace.
+//
+// All inputs are optional:
+//   IS_SHOT_CHANGE       bool, only true values are recorded.
+//   IS_SPEAKER_CHANGE    bool, only true values are recorded.
+//   DETECTIONS_SPEAKERS  std::vector<Detection> of the dominant speaker.
+//   TEXT_REGIONS         DetectionSet.
+//   LIP_STATISTICS       LipStatistics from LipTrackCalculator.
+//
+// Checkpoints (optional): the CalculatorCheckpoint streams of the stateful
+// calculators of the graph are connected as CHECKPOINT:0..N-1, ordered from
+// upstream to downstream. Whenever the last one emits a checkpoint, the
+// trace is flushed and an AnalysisCheckpoint with the trace size and the
+// latest upstream checkpoints that are compatible with it is written to
+// CHECKPOINT_PATH. A run restored from that AnalysisCheckpoint, given as the
+// CHECKPOINT input side packet, truncates the trace to the checkpoint and
+// appends to it. The calculators are restored from the CalculatorCheckpoints
+// it holds, and the input has to be fed from its input_timestamp_us.
+//
+// Example:
+//  node {
+//    calculator: "TraceWriterCalculator"
+//    input_side_packet: "OUTPUT_FILE_PATH:trace_path"
+//    input_stream: "IS_SHOT_CHANGE:shot_change"
+//    input_stream: "IS_SPEAKER_CHANGE:speaker_change"
+//    input_stream: "DETECTIONS_SPEAKERS:active_speakers_detections"
+//    input_stream: "TEXT_REGIONS:text_regions"
+//    input_stream: "LIP_STATISTICS:lip_statistics"
+//    input_side_packet: "CHECKPOINT_PATH:checkpoint_path"     (optional)
+//    input_side_packet: "CHECKPOINT:restored_checkpoint"      (optional)
+//    input_stream: "CHECKPOINT:0:shot_boundary_checkpoint"    (optional)
+//    input_stream: "CHECKPOINT:1:lip_track_checkpoint"        (optional)
+//  }
+class TraceWriterCalculator : public CalculatorBase {
+ public:
+  TraceWriterCalculator() {}
+  TraceWriterCalculator(const TraceWriterCalculator&) = delete;
+  TraceWriterCalculator& operator=(const TraceWriterCalculator&) = delete;
+
+  static ::mediapipe::Status GetContract(mediapipe::CalculatorContract* cc);
+  ::mediapipe::Status Open(mediapipe::CalculatorContext* cc) override;
+  ::mediapipe::Status Process(mediapipe::CalculatorContext* cc) override;
+  ::mediapipe::Status Close(mediapipe::CalculatorContext* cc) override;
+
+ private:
+  // Returns true and sets |value| if |tag| is connected and has a packet.
+  template <typename T>
+  bool GetInput(mediapipe::CalculatorContext* cc, const std::string& tag,
+                const T** value);
+  // Reopens the trace truncated to the restored checkpoint.
+  ::mediapipe::Status RestoreCheckpoint(const AnalysisCheckpoint& checkpoint);
+  // Writes an AnalysisCheckpoint if the last CHECKPOINT input has a packet.
+  ::mediapipe::Status ProcessCheckpoints(mediapipe::CalculatorContext* cc);
+
+  std::ofstream output_;
+  std::string output_path_;
+  std::string checkpoint_path_;
+  // Checkpoints of the upstream calculators, oldest first.
+  std::vector<std::deque<CalculatorCheckpoint>> checkpoint_history_;
+  // The trace of a restored run already holds the records before this.
+  Timestamp first_record_timestamp_ = Timestamp::Unstarted();
+};
+
+REGISTER_CALCULATOR(TraceWriterCalculator);
+
+::mediapipe::Status TraceWriterCalculator::GetContract(
+    mediapipe::CalculatorContract* cc) {
+  cc->InputSidePackets().Tag(kOutputFilePath).Set<std::string>();
+  if (cc->Inputs().HasTag(kInputShotChange)) {
+    cc->Inputs().Tag(kInputShotChange).Set<bool>();
+  }
+  if (cc->Inputs().HasTag(kInputSpeakerChange)) {
+    cc->Inputs().Tag(kInputSpeakerChange).Set<bool>();
+  }
+  if (cc->Inputs().HasTag(kInputSpeakers)) {
+    cc->Inputs().Tag(kInputSpeakers).Set<std::vector<Detection>>();
+  }
+  if (cc->Inputs().HasTag(kInputTextRegions)) {
+    cc->Inputs().Tag(kInputTextRegions).Set<DetectionSet>();
+  }
+  if (cc->Inputs().HasTag(kInputLipStatistics)) {
+    cc->Inputs().Tag(kInputLipStatistics).Set<LipStatistics>();
+  }
+  for (int i = 0; i < cc->Inputs().NumEntries(kCheckpoint); ++i) {
+    cc->Inputs().Get(kCheckpoint, i).Set<CalculatorCheckpoint>();
+  }
+  if (cc->Inputs().NumEntries(kCheckpoint) > 0) {
+    cc->InputSidePackets().Tag(kCheckpointPath).Set<std::string>();
+  }
+  if (cc->InputSidePackets().HasTag(kCheckpoint)) {
+    cc->InputSidePackets()
+        .Tag(kCheckpoint)
+        .Set<AnalysisCheckpoint>()
+        .Optional();
+  }
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status TraceWriterCalculator::Open(
+    mediapipe::CalculatorContext* cc) {
+  output_path_ = cc->InputSidePackets().Tag(kOutputFilePath).Get<std::string>();
+  RET_CHECK(!output_path_.empty()) << "Output trace path is empty.";
+  if (cc->Inputs().NumEntries(kCheckpoint) > 0) {
+    checkpoint_path_ =
+        cc->InputSidePackets().Tag(kCheckpointPath).Get<std::string>();
+    RET_CHECK(!checkpoint_path_.empty()) << "Checkpoint path is empty.";
+    checkpoint_history_.resize(cc->Inputs().NumEntries(kCheckpoint) - 1);
+  }
+  if (cc->InputSidePackets().HasTag(kCheckpoint) &&
+      !cc->InputSidePackets().Tag(kCheckpoint).IsEmpty()) {
+    return RestoreCheckpoint(
+        cc->InputSidePackets().Tag(kCheckpoint).Get<AnalysisCheckpoint>());
+  }
+  output_.open(output_path_, std::ios::out | std::ios::binary |
+                                 std::ios::trunc);
+  RET_CHECK(output_.is_open()) << "Fail to open trace file " << output_path_;
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status TraceWriterCalculator::RestoreCheckpoint(
+    const AnalysisCheckpoint& checkpoint) {
+  std::string trace(checkpoint.trace_size(), '\0');
+  {
+    std::ifstream input(output_path_, std::ios::in | std::ios::binary);
+    RET_CHECK(input.is_open()) << "Fail to open trace file " << output_path_;
+    input.read(&trace[0], trace.size());
+    RET_CHECK_EQ(input.gcount(), checkpoint.trace_size())
+        << "Trace file " << output_path_ << " is shorter than its checkpoint.";
+  }
+  output_.open(output_path_, std::ios::out | std::ios::binary |
+                                 std::ios::trunc);
+  RET_CHECK(output_.is_open()) << "Fail to open trace file " << output_path_;
+  output_.write(trace.data(), trace.size());
+  first_record_timestamp_ = Timestamp(checkpoint.timestamp_us());
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status TraceWriterCalculator::ProcessCheckpoints(
+    mediapipe::CalculatorContext* cc) {
+  const int num_checkpoints = cc->Inputs().NumEntries(kCheckpoint);
+  if (num_checkpoints == 0) {
+    return ::mediapipe::OkStatus();
+  }
+  const auto& last = cc->Inputs().Get(kCheckpoint, num_checkpoints - 1);
+  if (!last.IsEmpty() && cc->InputTimestamp() >= first_record_timestamp_) {
+    AnalysisCheckpoint checkpoint;
+    std::vector<CalculatorCheckpoint> chosen(num_checkpoints);
+    chosen.back() = last.Get<CalculatorCheckpoint>();
+    bool is_complete = true;
+    // Each calculator resumes from its latest checkpoint that re-emits all
+    // the inputs of the next one.
+    for (int i = num_checkpoints - 2; i >= 0; --i) {
+      auto& history = checkpoint_history_[i];
+      int latest = history.size() - 1;
+      while (latest >= 0 && history[latest].resume_timestamp_us() >
+                                chosen[i + 1].resume_timestamp_us()) {
+        --latest;
+      }
+      if (latest < 0) {
+        is_complete = false;
+        break;
+      }
+      chosen[i] = history[latest];
+      // Later checkpoints only resume later, so older ones are never used.
+      history.erase(history.begin(), history.begin() + latest);
+    }
+    if (is_complete) {
+      output_.flush();
+      RET_CHECK(output_.good()) << "Fail to flush trace file " << output_path_;
+      checkpoint.set_timestamp_us(cc->InputTimestamp().Value());
+      checkpoint.set_trace_size(output_.tellp());
+      checkpoint.set_input_timestamp_us(chosen[0].resume_timestamp_us());
+      for (const auto& calculator : chosen) {
+        checkpoint.set_input_timestamp_us(std::min(
+            checkpoint.input_timestamp_us(), calculator.resume_timestamp_us()));
+        *checkpoint.add_calculator() = calculator;
+      }
+      // Written next to the checkpoint and renamed, so that a crash never
+      // leaves a partial checkpoint behind.
+      const std::string temp_path = checkpoint_path_ + ".tmp";
+      {
+        std::ofstream output(temp_path, std::ios::out | std::ios::binary |
+                                            std::ios::trunc);
+        RET_CHECK(output.is_open() && checkpoint.SerializeToOstream(&output))
+            << "Fail to write checkpoint " << temp_path;
+      }
+      RET_CHECK_EQ(0, std::rename(temp_path.c_str(), checkpoint_path_.c_str()))
+          << "Fail to rename " << temp_path << " to " << checkpoint_path_;
+    }
+  }
+  for (int i = 0; i < num_checkpoints - 1; ++i) {
+    const auto& input = cc->Inputs().Get(kCheckpoint, i);
+    if (input.IsEmpty()) {
+      continue;
+    }
+    auto& history = checkpoint_history_[i];
+    history.push_back(input.Get<CalculatorCheckpoint>());
+    if (history.size() > kMaxCheckpointHistory) {
+      history.pop_front();
+    }
+  }
+  return ::mediapipe::OkStatus();
+}
+
+template <typename T>
+bool TraceWriterCalculator::GetInput(mediapipe::CalculatorContext* cc,
+                                     const std::string& tag,
+                                     const T** value) {
+  if (!cc->Inputs().HasTag(tag) || cc->Inputs().Tag(tag).Value().IsEmpty()) {
+    return false;
+  }
+  *value = &cc->Inputs().Tag(tag).Get<T>();
+  return true;
+}
+
+::mediapipe::Status TraceWriterCalculator::Process(
+    mediapipe::CalculatorContext* cc) {
+  MP_RETURN_IF_ERROR(ProcessCheckpoints(cc));
+  if (cc->InputTimestamp() < first_record_timestamp_) {
+    return ::mediapipe::OkStatus();
+  }
+  TraceRecord record;
+  bool has_signal = false;
+
+  const bool* is_change;
+  if (GetInput(cc, kInputShotChange, &is_change) && *is_change) {
+    record.set_shot_change(true);
+    has_signal = true;
+  }
+  if (GetInput(cc, kInputSpeakerChange, &is_change) && *is_change) {
+    record.set_speaker_change(true);
+    has_signal = true;
+  }
+
+  const std::vector<Detection>* speakers;
+  if (GetInput(cc, kInputSpeakers, &speakers)) {
+    for (const auto& speaker : *speakers) {
+      RET_CHECK(speaker.location_data().has_relative_bounding_box())
+          << "Speaker detection input is lacking required "
+             "relative_bounding_box()";
+      const auto& box = speaker.location_data().relative_bounding_box();
+      auto* rect = record.add_speaker();
+      rect->set_x(box.xmin());
+      rect->set_y(box.ymin());
+      rect->set_width(box.width());
+      rect->set_height(box.height());
+    }
+    has_signal |= !speakers->empty();
+  }
+
+  const DetectionSet* text_regions;
+  if (GetInput(cc, kInputTextRegions, &text_regions)) {
+    for (const auto& region : text_regions->detections()) {
+      if (region.has_location_normalized()) {
+        *record.add_text_region() = region.location_normalized();
+      }
+    }
+    has_signal |= record.text_region_size() > 0;
+  }
+
+  const LipStatistics* lip_statistics;
+  if (GetInput(cc, kInputLipStatistics, &lip_statistics) &&
+      lip_statistics->face_size() > 0) {
+    *record.mutable_lip_statistics() = *lip_statistics;
+    has_signal = true;
+  }
+
+  if (!has_signal) {
+    return ::mediapipe::OkStatus();
+  }
+  record.set_timestamp_us(cc->InputTimestamp().Value());
+  RET_CHECK(google::protobuf::util::SerializeDelimitedToOstream(record,
+                                                                &output_))
+      << "Fail to write trace record to " << output_path_;
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status TraceWriterCalculator::Close(
+    mediapipe::CalculatorContext* cc) {
+  output_.close();
+  RET_CHECK(!output_.fail()) << "Fail to close trace file " << output_path_;
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace autoflip
+}  // namespace mediapipe
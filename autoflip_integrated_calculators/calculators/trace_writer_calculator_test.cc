@@ -0,0 +1,261 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
+#include "google/protobuf/util/delimited_message_util.h"
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/detection.pb.h"
+#include "mediapipe/framework/formats/location_data.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kInputShotChange[] = "IS_SHOT_CHANGE";
+constexpr char kInputSpeakerChange[] = "IS_SPEAKER_CHANGE";
+constexpr char kInputSpeakers[] = "DETECTIONS_SPEAKERS";
+constexpr char kInputTextRegions[] = "TEXT_REGIONS";
+constexpr char kInputLipStatistics[] = "LIP_STATISTICS";
+constexpr char kOutputFilePath[] = "OUTPUT_FILE_PATH";
+constexpr char kCheckpoint[] = "CHECKPOINT";
+constexpr char kCheckpointPath[] = "CHECKPOINT_PATH";
+
+constexpr char kConfig[] = R"(
+    calculator: "TraceWriterCalculator"
+    input_side_packet: "OUTPUT_FILE_PATH:trace_path"
+    input_stream: "IS_SHOT_CHANGE:shot_change"
+    input_stream: "IS_SPEAKER_CHANGE:speaker_change"
+    input_stream: "DETECTIONS_SPEAKERS:active_speakers_detections"
+    input_stream: "TEXT_REGIONS:text_regions"
+    input_stream: "LIP_STATISTICS:lip_statistics")";
+
+constexpr char kCheckpointConfig[] = R"(
+    calculator: "TraceWriterCalculator"
+    input_side_packet: "OUTPUT_FILE_PATH:trace_path"
+    input_side_packet: "CHECKPOINT_PATH:checkpoint_path"
+    input_stream: "IS_SHOT_CHANGE:shot_change"
+    input_stream: "CHECKPOINT:0:upstream_checkpoint"
+    input_stream: "CHECKPOINT:1:downstream_checkpoint")";
+
+std::string TracePath() {
+  return ::testing::TempDir() + "/trace_writer_calculator_test.trace";
+}
+
+std::vector<TraceRecord> ReadTrace(const std::string& path) {
+  std::ifstream input(path, std::ios::in | std::ios::binary);
+  google::protobuf::io::IstreamInputStream stream(&input);
+  std::vector<TraceRecord> records;
+  TraceRecord record;
+  bool clean_eof = false;
+  while (google::protobuf::util::ParseDelimitedFromZeroCopyStream(
+      &record, &stream, &clean_eof)) {
+    records.push_back(record);
+  }
+  EXPECT_TRUE(clean_eof);
+  return records;
+}
+
+std::unique_ptr<CalculatorRunner> MakeRunner() {
+  auto runner = ::absl::make_unique<CalculatorRunner>(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(kConfig));
+  runner->MutableSidePackets()->Tag(kOutputFilePath) =
+      MakePacket<std::string>(TracePath());
+  return runner;
+}
+
+std::string CheckpointPath() {
+  return ::testing::TempDir() + "/trace_writer_calculator_test.checkpoint";
+}
+
+Packet MakeCheckpoint(int64 resume_timestamp_us, int64 timestamp_us) {
+  CalculatorCheckpoint checkpoint;
+  checkpoint.set_resume_timestamp_us(resume_timestamp_us);
+  return MakePacket<CalculatorCheckpoint>(checkpoint).At(
+      Timestamp(timestamp_us));
+}
+
+// Shot changes every 1000us, with upstream checkpoints at 1000 and 2000 and
+// a downstream checkpoint at 3000. |restored| continues from the checkpoint.
+std::unique_ptr<CalculatorRunner> MakeCheckpointRunner(
+    const AnalysisCheckpoint* restored) {
+  std::string config = kCheckpointConfig;
+  if (restored != nullptr) {
+    absl::StrAppend(&config,
+                    "\ninput_side_packet: \"CHECKPOINT:restored_checkpoint\"");
+  }
+  auto runner = ::absl::make_unique<CalculatorRunner>(
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(config));
+  runner->MutableSidePackets()->Tag(kOutputFilePath) =
+      MakePacket<std::string>(TracePath());
+  runner->MutableSidePackets()->Tag(kCheckpointPath) =
+      MakePacket<std::string>(CheckpointPath());
+  if (restored != nullptr) {
+    runner->MutableSidePackets()->Tag(kCheckpoint) =
+        MakePacket<AnalysisCheckpoint>(*restored);
+  }
+  auto* inputs = runner->MutableInputs();
+  for (int64 t = 1000; t <= 4000; t += 1000) {
+    inputs->Tag(kInputShotChange).packets.push_back(
+        MakePacket<bool>(true).At(Timestamp(t)));
+  }
+  inputs->Get(kCheckpoint, 0).packets.push_back(MakeCheckpoint(1500, 1000));
+  inputs->Get(kCheckpoint, 0).packets.push_back(MakeCheckpoint(2500, 2000));
+  inputs->Get(kCheckpoint, 1).packets.push_back(MakeCheckpoint(3000, 3000));
+  return runner;
+}
+
+AnalysisCheckpoint ReadCheckpoint() {
+  std::ifstream input(CheckpointPath(), std::ios::in | std::ios::binary);
+  AnalysisCheckpoint checkpoint;
+  EXPECT_TRUE(checkpoint.ParseFromIstream(&input));
+  return checkpoint;
+}
+
+TEST(TraceWriterCalculatorTest, SkipsTimestampsWithoutSignals) {
+  auto runner = MakeRunner();
+  auto* inputs = runner->MutableInputs();
+  inputs->Tag(kInputShotChange).packets.push_back(
+      MakePacket<bool>(false).At(Timestamp(0)));
+  inputs->Tag(kInputSpeakerChange).packets.push_back(
+      MakePacket<bool>(false).At(Timestamp(0)));
+  inputs->Tag(kInputSpeakers).packets.push_back(
+      MakePacket<std::vector<Detection>>().At(Timestamp(0)));
+  MP_ASSERT_OK(runner->Run());
+
+  EXPECT_TRUE(ReadTrace(TracePath()).empty());
+}
+
+TEST(TraceWriterCalculatorTest, RecordsAllSignals) {
+  auto runner = MakeRunner();
+  auto* inputs = runner->MutableInputs();
+  inputs->Tag(kInputShotChange).packets.push_back(
+      MakePacket<bool>(true).At(Timestamp(1000)));
+
+  Detection speaker;
+  auto* box = speaker.mutable_location_data()->mutable_relative_bounding_box();
+  box->set_xmin(0.1);
+  box->set_ymin(0.2);
+  box->set_width(0.3);
+  box->set_height(0.4);
+  inputs->Tag(kInputSpeakers).packets.push_back(
+      MakePacket<std::vector<Detection>>(std::vector<Detection>{speaker})
+          .At(Timestamp(2000)));
+  inputs->Tag(kInputSpeakerChange).packets.push_back(
+      MakePacket<bool>(true).At(Timestamp(2000)));
+
+  DetectionSet text_regions;
+  auto* location = text_regions.add_detections()->mutable_location_normalized();
+  location->set_x(0.5);
+  location->set_width(0.25);
+  inputs->Tag(kInputTextRegions).packets.push_back(
+      MakePacket<DetectionSet>(text_regions).At(Timestamp(3000)));
+
+  LipStatistics lip_statistics;
+  auto* face = lip_statistics.add_face();
+  face->set_inner_ratio(0.5);
+  face->set_is_active(true);
+  inputs->Tag(kInputLipStatistics).packets.push_back(
+      MakePacket<LipStatistics>(lip_statistics).At(Timestamp(3000)));
+  MP_ASSERT_OK(runner->Run());
+
+  const auto records = ReadTrace(TracePath());
+  ASSERT_EQ(3, records.size());
+  EXPECT_EQ(1000, records[0].timestamp_us());
+  EXPECT_TRUE(records[0].shot_change());
+  EXPECT_FALSE(records[0].speaker_change());
+
+  EXPECT_EQ(2000, records[1].timestamp_us());
+  EXPECT_TRUE(records[1].speaker_change());
+  ASSERT_EQ(1, records[1].speaker_size());
+  EXPECT_FLOAT_EQ(0.1, records[1].speaker(0).x());
+  EXPECT_FLOAT_EQ(0.4, records[1].speaker(0).height());
+
+  EXPECT_EQ(3000, records[2].timestamp_us());
+  ASSERT_EQ(1, records[2].text_region_size());
+  EXPECT_FLOAT_EQ(0.5, records[2].text_region(0).x());
+  ASSERT_EQ(1, records[2].lip_statistics().face_size());
+  EXPECT_TRUE(records[2].lip_statistics().face(0).is_active());
+}
+
+TEST(TraceWriterCalculatorTest, WritesCheckpoint) {
+  std::remove(CheckpointPath().c_str());
+  auto runner = MakeCheckpointRunner(nullptr);
+  MP_ASSERT_OK(runner->Run());
+
+  ASSERT_EQ(4, ReadTrace(TracePath()).size());
+  const AnalysisCheckpoint checkpoint = ReadCheckpoint();
+  EXPECT_EQ(3000, checkpoint.timestamp_us());
+  // The upstream checkpoint at 2000 resumes early enough to re-emit the
+  // inputs the downstream one resumes from.
+  EXPECT_EQ(2500, checkpoint.input_timestamp_us());
+  ASSERT_EQ(2, checkpoint.calculator_size());
+  EXPECT_EQ(2500, checkpoint.calculator(0).resume_timestamp_us());
+  EXPECT_EQ(3000, checkpoint.calculator(1).resume_timestamp_us());
+
+  // The trace holds the records before the checkpoint timestamp.
+  std::ifstream input(TracePath(), std::ios::in | std::ios::binary);
+  std::string prefix(checkpoint.trace_size(), '\0');
+  input.read(&prefix[0], prefix.size());
+  google::protobuf::io::ArrayInputStream stream(prefix.data(), prefix.size());
+  TraceRecord record;
+  bool clean_eof = false;
+  int num_records = 0;
+  while (google::protobuf::util::ParseDelimitedFromZeroCopyStream(
+      &record, &stream, &clean_eof)) {
+    EXPECT_LT(record.timestamp_us(), 3000);
+    ++num_records;
+  }
+  EXPECT_TRUE(clean_eof);
+  EXPECT_EQ(2, num_records);
+}
+
+TEST(TraceWriterCalculatorTest, ResumesFromCheckpoint) {
+  auto runner = MakeCheckpointRunner(nullptr);
+  MP_ASSERT_OK(runner->Run());
+  const AnalysisCheckpoint checkpoint = ReadCheckpoint();
+
+  // The resumed run gets the inputs again from the input timestamp on, and
+  // its trace is the same as the one of the uninterrupted run.
+  auto resumed = MakeCheckpointRunner(&checkpoint);
+  MP_ASSERT_OK(resumed->Run());
+  const auto records = ReadTrace(TracePath());
+  ASSERT_EQ(4, records.size());
+  for (int i = 0; i < records.size(); ++i) {
+    EXPECT_EQ(1000 * (i + 1), records[i].timestamp_us());
+  }
+}
+
+TEST(TraceWriterCalculatorTest, FailsOnUnwritablePath) {
+  auto runner = MakeRunner();
+  runner->MutableSidePackets()->Tag(kOutputFilePath) =
+      MakePacket<std::string>("/nonexistent/dir/trace");
+  EXPECT_FALSE(runner->Run().ok());
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
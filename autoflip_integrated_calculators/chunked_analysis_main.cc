@@ -0,0 +1,306 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Analyzes a video in chunks with independent instances of
+// autoflip_graph_chunk_trace.pbtxt running in parallel, and stitches the
+// trace of every chunk into one trace of the whole video.
+//
+// Each chunk is analyzed with --overlap_seconds of extra frames on both
+// sides, so that the shot boundary detector and LipTrackCalculator are warm
+// at the chunk edges. The stitcher then cuts every seam at a shot boundary
+// both neighbouring chunks agree on (see chunk_stitcher.h), which gives the
+// same records as a single pass. The overlap should cover a few seconds of
+// video, enough for the TransNetV2 window and for a shot boundary to occur.
+//
+// Every chunk checkpoints its analysis at scene boundaries next to its trace
+// (.checkpoint) and marks itself done (.done) once it completes. With
+// --resume, an interrupted run skips the chunks that are done and continues
+// the others from their last checkpoint instead of from their start.
+//
+// Example:
+//   chunked_analysis \
+//     --calculator_graph_config_file=autoflip_graph_chunk_trace.pbtxt \
+//     --input_video_path=/tmp/input.mp4 \
+//     --output_trace_path=/tmp/autoflip.trace \
+//     --chunk_seconds=60 --overlap_seconds=5 --num_workers=4
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
+#include "google/protobuf/util/delimited_message_util.h"
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/chunk_stitcher.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/commandlineflags.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/opencv_video_inc.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+DEFINE_string(calculator_graph_config_file, "",
+              "Chunk graph, e.g. autoflip_graph_chunk_trace.pbtxt.");
+DEFINE_string(input_video_path, "", "Video to analyze.");
+DEFINE_string(output_trace_path, "", "Path of the stitched trace. The trace "
+              "of chunk i is written next to it, with suffix .chunk<i>.");
+DEFINE_double(chunk_seconds, 60, "Length of the core range of each chunk.");
+DEFINE_double(overlap_seconds, 5, "Extra seconds analyzed on both sides of "
+              "each chunk.");
+DEFINE_double(boundary_tolerance_seconds, 0.1, "Maximum distance of two shot "
+              "boundaries of neighbouring chunks that are the same boundary.");
+DEFINE_int32(num_workers, 4, "Number of chunks analyzed in parallel.");
+DEFINE_bool(keep_chunk_traces, false, "If true, the traces, checkpoints and "
+            "done markers of the chunks are not deleted after stitching.");
+DEFINE_bool(resume, false, "If true, continues an interrupted run with the "
+            "same flags from the checkpoints of its chunks.");
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kVideoStream[] = "video_raw";
+constexpr char kCheckpointSuffix[] = ".checkpoint";
+constexpr char kDoneSuffix[] = ".done";
+
+int64 Microseconds(double seconds) {
+  return static_cast<int64>(seconds * 1000000);
+}
+
+::mediapipe::Status GetVideoDuration(const std::string& path,
+                                     int64* duration_us) {
+  cv::VideoCapture capture(path);
+  RET_CHECK(capture.isOpened()) << "Fail to open video file at " << path;
+  const double fps = capture.get(cv::CAP_PROP_FPS);
+  const double frame_count = capture.get(cv::CAP_PROP_FRAME_COUNT);
+  RET_CHECK(fps > 0 && frame_count > 0)
+      << "Fail to read the frame rate and length of " << path;
+  *duration_us = Microseconds(frame_count / fps);
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status ReadTrace(const std::string& path,
+                              std::vector<TraceRecord>* records) {
+  std::ifstream input(path, std::ios::in | std::ios::binary);
+  RET_CHECK(input.is_open()) << "Fail to open trace file " << path;
+  google::protobuf::io::IstreamInputStream stream(&input);
+  TraceRecord record;
+  bool clean_eof = false;
+  while (google::protobuf::util::ParseDelimitedFromZeroCopyStream(
+      &record, &stream, &clean_eof)) {
+    records->push_back(record);
+  }
+  RET_CHECK(clean_eof) << "Trace file " << path << " is truncated.";
+  return ::mediapipe::OkStatus();
+}
+
+::mediapipe::Status WriteTrace(const std::string& path,
+                               const std::vector<TraceRecord>& records) {
+  std::ofstream output(path, std::ios::out | std::ios::binary);
+  RET_CHECK(output.is_open()) << "Fail to open trace file " << path;
+  for (const auto& record : records) {
+    RET_CHECK(
+        google::protobuf::util::SerializeDelimitedToOstream(record, &output))
+        << "Fail to write trace record to " << path;
+  }
+  output.close();
+  RET_CHECK(!output.fail()) << "Fail to close trace file " << path;
+  return ::mediapipe::OkStatus();
+}
+
+// Returns true and sets |checkpoint| if |path| holds a checkpoint.
+bool ReadCheckpoint(const std::string& path, AnalysisCheckpoint* checkpoint) {
+  std::ifstream input(path, std::ios::in | std::ios::binary);
+  return input.is_open() && checkpoint->ParseFromIstream(&input);
+}
+
+// Runs one instance of the chunk graph over [start_us, end_us) of the video;
+// a negative |end_us| runs to the end of the video. If |checkpoint| is not
+// null, the chunk continues from it instead of from |start_us|.
+::mediapipe::Status RunChunk(const CalculatorGraphConfig& config,
+                             int64 start_us, int64 end_us,
+                             const std::string& trace_path,
+                             const AnalysisCheckpoint* checkpoint) {
+  std::map<std::string, Packet> side_packets = {
+      {"input_video_path", MakePacket<std::string>(FLAGS_input_video_path)},
+      {"trace_path", MakePacket<std::string>(trace_path)},
+      {"checkpoint_path",
+       MakePacket<std::string>(absl::StrCat(trace_path, kCheckpointSuffix))},
+      {"chunk_start_us", MakePacket<int64>(start_us)},
+      {"chunk_end_us", MakePacket<int64>(end_us)}};
+  if (checkpoint != nullptr) {
+    side_packets["checkpoint"] = MakePacket<AnalysisCheckpoint>(*checkpoint);
+    for (int i = 0; i < checkpoint->calculator_size(); ++i) {
+      side_packets[absl::StrCat("checkpoint_", i)] =
+          MakePacket<CalculatorCheckpoint>(checkpoint->calculator(i));
+    }
+    side_packets["chunk_start_us"] =
+        MakePacket<int64>(checkpoint->input_timestamp_us());
+  }
+
+  CalculatorGraph graph;
+  MP_RETURN_IF_ERROR(graph.Initialize(config));
+  // The chunk range only gates the frames after decoding, so stop the
+  // decoder once it is past the chunk instead of decoding the whole video.
+  std::atomic<bool> closing(false);
+  if (end_us >= 0) {
+    MP_RETURN_IF_ERROR(graph.ObserveOutputStream(
+        kVideoStream, [&graph, &closing, end_us](const Packet& packet) {
+          if (packet.Timestamp().Value() >= end_us && !closing.exchange(true)) {
+            return graph.CloseAllPacketSources();
+          }
+          return ::mediapipe::OkStatus();
+        }));
+  }
+  MP_RETURN_IF_ERROR(graph.StartRun(side_packets));
+  MP_RETURN_IF_ERROR(graph.WaitUntilDone());
+  return ::mediapipe::file::SetContents(absl::StrCat(trace_path, kDoneSuffix),
+                                        "");
+}
+
+::mediapipe::Status RunChunkedAnalysis() {
+  RET_CHECK(!FLAGS_calculator_graph_config_file.empty())
+      << "--calculator_graph_config_file is required.";
+  RET_CHECK(!FLAGS_input_video_path.empty())
+      << "--input_video_path is required.";
+  RET_CHECK(!FLAGS_output_trace_path.empty())
+      << "--output_trace_path is required.";
+  RET_CHECK_GT(FLAGS_chunk_seconds, 2 * FLAGS_overlap_seconds)
+      << "Chunks must be longer than twice the overlap.";
+  RET_CHECK_GT(FLAGS_num_workers, 0);
+
+  std::string config_contents;
+  MP_RETURN_IF_ERROR(::mediapipe::file::GetContents(
+      FLAGS_calculator_graph_config_file, &config_contents));
+  const CalculatorGraphConfig config =
+      ParseTextProtoOrDie<CalculatorGraphConfig>(config_contents);
+
+  int64 duration_us;
+  MP_RETURN_IF_ERROR(GetVideoDuration(FLAGS_input_video_path, &duration_us));
+  const std::vector<ChunkRange> chunks =
+      SplitIntoChunks(duration_us, Microseconds(FLAGS_chunk_seconds));
+  const int64 overlap_us = Microseconds(FLAGS_overlap_seconds);
+
+  std::vector<std::string> trace_paths;
+  for (int i = 0; i < chunks.size(); ++i) {
+    trace_paths.push_back(absl::StrCat(FLAGS_output_trace_path, ".chunk", i));
+  }
+
+  // Workers take the next chunk until none is left. The first error stops
+  // the others from starting new chunks.
+  const absl::Time start = absl::Now();
+  std::atomic<int> next_chunk(0);
+  std::vector<::mediapipe::Status> statuses(chunks.size());
+  std::vector<std::thread> workers;
+  const int num_workers =
+      std::min<int>(FLAGS_num_workers, static_cast<int>(chunks.size()));
+  std::atomic<int> num_resumed(0), num_skipped(0);
+  for (int w = 0; w < num_workers; ++w) {
+    workers.emplace_back([&]() {
+      for (int i = next_chunk++; i < chunks.size(); i = next_chunk++) {
+        AnalysisCheckpoint checkpoint;
+        bool has_checkpoint = false;
+        if (FLAGS_resume) {
+          if (::mediapipe::file::Exists(
+                  absl::StrCat(trace_paths[i], kDoneSuffix))
+                  .ok()) {
+            ++num_skipped;
+            continue;
+          }
+          has_checkpoint = ReadCheckpoint(
+              absl::StrCat(trace_paths[i], kCheckpointSuffix), &checkpoint);
+          num_resumed += has_checkpoint;
+        }
+        const bool is_last = i + 1 == chunks.size();
+        statuses[i] = RunChunk(
+            config, std::max<int64>(0, chunks[i].start_us - overlap_us),
+            is_last ? -1 : chunks[i].end_us + overlap_us, trace_paths[i],
+            has_checkpoint ? &checkpoint : nullptr);
+        if (!statuses[i].ok()) {
+          next_chunk = chunks.size();
+        }
+      }
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  for (int i = 0; i < chunks.size(); ++i) {
+    RET_CHECK(statuses[i].ok())
+        << "Chunk " << i << " failed: " << statuses[i].message();
+  }
+  const absl::Duration analysis_time = absl::Now() - start;
+
+  std::vector<std::vector<TraceRecord>> traces(chunks.size());
+  for (int i = 0; i < chunks.size(); ++i) {
+    MP_RETURN_IF_ERROR(ReadTrace(trace_paths[i], &traces[i]));
+  }
+  std::vector<TraceRecord> merged;
+  StitchStats stats;
+  MP_RETURN_IF_ERROR(StitchTraces(
+      chunks, traces, overlap_us,
+      Microseconds(FLAGS_boundary_tolerance_seconds), &merged, &stats));
+  MP_RETURN_IF_ERROR(WriteTrace(FLAGS_output_trace_path, merged));
+  if (!FLAGS_keep_chunk_traces) {
+    for (const auto& path : trace_paths) {
+      for (const char* suffix : {"", kCheckpointSuffix, kDoneSuffix}) {
+        std::remove(absl::StrCat(path, suffix).c_str());
+      }
+    }
+  }
+
+  for (int i = 0; i < stats.cuts_us.size(); ++i) {
+    LOG(INFO) << absl::StrFormat("Seam %d at %.3fs cut at %.3fs", i,
+                                 chunks[i + 1].start_us / 1000000.0,
+                                 stats.cuts_us[i] / 1000000.0);
+  }
+  if (FLAGS_resume) {
+    std::cout << absl::StrFormat(
+        "Resumed: %d chunks already done, %d continued from a checkpoint.\n",
+        num_skipped.load(), num_resumed.load());
+  }
+  std::cout << absl::StrFormat(
+      "%d chunks on %d workers in %.1fs, %d of %d seams cut at a shared shot "
+      "boundary, %d records.\n",
+      chunks.size(), num_workers, absl::ToDoubleSeconds(analysis_time),
+      stats.num_reconciled, stats.cuts_us.size(), merged.size());
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  ::mediapipe::Status status = ::mediapipe::autoflip::RunChunkedAnalysis();
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to run the chunked analysis: " << status.message();
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,127 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Crops a video to several aspect ratios in one pass. The graph, e.g.
+// autoflip_graph.pbtxt, is rewritten with FanOutCropping() (see
+// crop_fan_out.h) so that decoding, the detectors and signal fusion run once
+// and their salient regions, borders and shot changes feed one
+// SceneCroppingCalculator and one encoder per aspect ratio.
+//
+// Output i is cropped to the i-th entry of --aspect_ratios and written to
+// the i-th entry of --output_video_paths.
+//
+// Example:
+//   multi_aspect_autoflip \
+//     --calculator_graph_config_file=autoflip_graph.pbtxt \
+//     --input_video_path=/tmp/input.mp4 \
+//     --aspect_ratios=1:1,4:5,9:16 \
+//     --output_video_paths=/tmp/square.mp4,/tmp/portrait.mp4,/tmp/story.mp4
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "mediapipe/examples/desktop/autoflip/calculators/crop_fan_out.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/commandlineflags.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+DEFINE_string(calculator_graph_config_file, "",
+              "Graph cropping to one aspect ratio, e.g. autoflip_graph.pbtxt.");
+DEFINE_string(input_video_path, "", "Video to crop.");
+DEFINE_string(aspect_ratios, "1:1,4:5,9:16",
+              "Comma-separated aspect ratios, as width:height.");
+DEFINE_string(output_video_paths, "", "Comma-separated output video paths, "
+              "one per aspect ratio.");
+DEFINE_string(input_side_packets, "", "Comma-separated name=value string "
+              "side packets the graph needs besides the paths and the aspect "
+              "ratios, e.g. signal_cache_dir=/tmp/cache.");
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+constexpr char kInputVideoPath[] = "input_video_path";
+constexpr char kAspectRatio[] = "aspect_ratio";
+constexpr char kOutputVideoPath[] = "output_video_path";
+
+::mediapipe::Status RunMultiAspectAutoFlip() {
+  RET_CHECK(!FLAGS_calculator_graph_config_file.empty())
+      << "--calculator_graph_config_file is required.";
+  RET_CHECK(!FLAGS_input_video_path.empty())
+      << "--input_video_path is required.";
+  const std::vector<std::string> aspect_ratios =
+      absl::StrSplit(FLAGS_aspect_ratios, ',', absl::SkipEmpty());
+  const std::vector<std::string> output_paths =
+      absl::StrSplit(FLAGS_output_video_paths, ',', absl::SkipEmpty());
+  RET_CHECK(!aspect_ratios.empty()) << "--aspect_ratios is required.";
+  RET_CHECK_EQ(aspect_ratios.size(), output_paths.size())
+      << "--output_video_paths needs one path per aspect ratio.";
+
+  std::string config_contents;
+  MP_RETURN_IF_ERROR(::mediapipe::file::GetContents(
+      FLAGS_calculator_graph_config_file, &config_contents));
+  CalculatorGraphConfig config;
+  MP_RETURN_IF_ERROR(FanOutCropping(
+      ParseTextProtoOrDie<CalculatorGraphConfig>(config_contents),
+      aspect_ratios.size(), &config));
+
+  std::map<std::string, Packet> side_packets = {
+      {kInputVideoPath, MakePacket<std::string>(FLAGS_input_video_path)}};
+  for (int i = 0; i < aspect_ratios.size(); ++i) {
+    side_packets[FanOutName(kAspectRatio, i)] =
+        MakePacket<std::string>(aspect_ratios[i]);
+    side_packets[FanOutName(kOutputVideoPath, i)] =
+        MakePacket<std::string>(output_paths[i]);
+  }
+  for (const auto& name_value :
+       absl::StrSplit(FLAGS_input_side_packets, ',', absl::SkipEmpty())) {
+    const std::vector<std::string> parts = absl::StrSplit(name_value, '=');
+    RET_CHECK_EQ(parts.size(), 2) << "Invalid side packet " << name_value;
+    side_packets[parts[0]] = MakePacket<std::string>(parts[1]);
+  }
+
+  const absl::Time start = absl::Now();
+  CalculatorGraph graph;
+  MP_RETURN_IF_ERROR(graph.Initialize(config));
+  MP_RETURN_IF_ERROR(graph.Run(side_packets));
+  LOG(INFO) << absl::StrFormat("Cropped %s to %d aspect ratios in %.1fs.",
+                               FLAGS_input_video_path, aspect_ratios.size(),
+                               absl::ToDoubleSeconds(absl::Now() - start));
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  ::mediapipe::Status status =
+      ::mediapipe::autoflip::RunMultiAspectAutoFlip();
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to run the graph: " << status.message();
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,140 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Prints a trace written by TraceWriterCalculator as a time-indexed summary,
+// or exports it as a JSON array of TraceRecord.
+//
+// Example:
+//   trace_reader --trace_path=/tmp/autoflip.trace
+//   trace_reader --trace_path=/tmp/autoflip.trace --json > autoflip.json
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_join.h"
+#include "google/protobuf/io/zero_copy_stream_impl.h"
+#include "google/protobuf/util/delimited_message_util.h"
+#include "google/protobuf/util/json_util.h"
+#include "mediapipe/examples/desktop/autoflip/autoflip_messages.pb.h"
+#include "mediapipe/framework/port/commandlineflags.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+DEFINE_string(trace_path, "", "Path of the trace written by "
+              "TraceWriterCalculator.");
+DEFINE_bool(json, false, "If true, exports the trace as JSON instead of "
+            "printing a summary.");
+
+namespace mediapipe {
+namespace autoflip {
+namespace {
+
+std::string RectToString(const RectF& rect) {
+  return absl::StrFormat("(%.2f,%.2f,%.2f,%.2f)", rect.x(), rect.y(),
+                         rect.width(), rect.height());
+}
+
+// Returns one summary line for |record|.
+std::string RecordToString(const TraceRecord& record) {
+  std::string line = absl::StrFormat(
+      "%10.3fs", record.timestamp_us() / 1000000.0);
+  if (record.shot_change()) {
+    absl::StrAppend(&line, "  SHOT");
+  }
+  if (record.speaker_change()) {
+    absl::StrAppend(&line, "  SPEAKER_CHANGE");
+  }
+  if (record.speaker_size() > 0) {
+    absl::StrAppend(&line, "  speaker=",
+                    absl::StrJoin(record.speaker(), "",
+                                  [](std::string* out, const RectF& rect) {
+                                    out->append(RectToString(rect));
+                                  }));
+  }
+  if (record.text_region_size() > 0) {
+    absl::StrAppend(&line, "  text=", record.text_region_size());
+  }
+  for (const auto& face : record.lip_statistics().face()) {
+    absl::StrAppend(&line, absl::StrFormat("  lip[%d]=%.3f/%.3f%s",
+                                           face.track_id(), face.inner_ratio(),
+                                           face.outer_ratio(),
+                                           face.is_active() ? "*" : ""));
+  }
+  return line;
+}
+
+::mediapipe::Status ReadTrace() {
+  RET_CHECK(!FLAGS_trace_path.empty()) << "--trace_path is required.";
+  std::ifstream input(FLAGS_trace_path, std::ios::in | std::ios::binary);
+  RET_CHECK(input.is_open()) << "Fail to open trace file " << FLAGS_trace_path;
+  google::protobuf::io::IstreamInputStream stream(&input);
+
+  int num_records = 0, num_shots = 0, num_speaker_changes = 0;
+  int64 last_timestamp_us = 0;
+  google::protobuf::util::JsonPrintOptions json_options;
+  json_options.preserve_proto_field_names = true;
+  if (FLAGS_json) {
+    std::cout << "[";
+  }
+  TraceRecord record;
+  bool clean_eof = false;
+  while (google::protobuf::util::ParseDelimitedFromZeroCopyStream(
+      &record, &stream, &clean_eof)) {
+    if (FLAGS_json) {
+      std::string json;
+      RET_CHECK(google::protobuf::util::MessageToJsonString(record, &json,
+                                                            json_options)
+                    .ok());
+      std::cout << (num_records > 0 ? ",\n" : "\n") << json;
+    } else {
+      std::cout << RecordToString(record) << "\n";
+    }
+    ++num_records;
+    num_shots += record.shot_change();
+    num_speaker_changes += record.speaker_change();
+    last_timestamp_us = record.timestamp_us();
+  }
+  RET_CHECK(clean_eof) << "Trace file " << FLAGS_trace_path
+                       << " is truncated or corrupted after " << num_records
+                       << " records.";
+  if (FLAGS_json) {
+    std::cout << "\n]\n";
+  } else {
+    std::cout << absl::StrFormat(
+        "%d records, %d shot boundaries, %d speaker changes, last at "
+        "%.3fs.\n",
+        num_records, num_shots, num_speaker_changes,
+        last_timestamp_us / 1000000.0);
+  }
+  return ::mediapipe::OkStatus();
+}
+
+}  // namespace
+}  // namespace autoflip
+}  // namespace mediapipe
+
+int main(int argc, char** argv) {
+  google::InitGoogleLogging(argv[0]);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  ::mediapipe::Status status = ::mediapipe::autoflip::ReadTrace();
+  if (!status.ok()) {
+    LOG(ERROR) << "Failed to read trace: " << status.message();
+    return 1;
+  }
+  return 0;
+}
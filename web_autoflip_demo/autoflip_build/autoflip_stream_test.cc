@@ -0,0 +1,217 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Checks that sending the video header and size once per stream, as
+// startStream does, gives the same crop windows as sending them with every
+// frame, and that frames keep their own timestamps at any frame rate.
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "third_party/absl/memory/memory.h"
+#include "third_party/libyuv/files/include/libyuv/video_common.h"
+#include "third_party/mediapipe/examples/desktop/autoflip/autoflip_messages.proto.h"
+#include "third_party/mediapipe/framework/calculator_framework.h"
+#include "third_party/mediapipe/framework/formats/video_stream_header.h"
+#include "third_party/mediapipe/framework/formats/yuv_image.h"
+#include "third_party/mediapipe/framework/port/gtest.h"
+#include "third_party/mediapipe/framework/port/parse_text_proto.h"
+#include "third_party/mediapipe/framework/port/status_matchers.h"
+
+namespace drishti {
+    namespace wasm {
+        namespace {
+
+            constexpr int kWidth = 320;
+            constexpr int kHeight = 240;
+            constexpr int kNumFrames = 30;
+            // A hard cut in the middle of the clip.
+            constexpr int kCutFrame = 15;
+
+            // The preprocessing and cropping part of autoflip_graph.pbtxt.
+            constexpr char kGraph[] = R"(
+                input_stream: "input_yuv_raw_data"
+                input_stream: "video_header"
+                input_stream: "video_size"
+                input_side_packet: "aspect_ratio"
+                output_stream: "external_rendering_per_frame"
+                node {
+                  calculator: "ScaleImageCalculator"
+                  input_stream: "FRAMES:input_yuv_raw_data"
+                  input_stream: "VIDEO_HEADER:video_header"
+                  output_stream: "FRAMES:video_frames_scaled"
+                  options: {
+                    [drishti.ScaleImageCalculatorOptions.ext]: {
+                      preserve_aspect_ratio: true
+                      output_format: SRGB
+                      target_width: 160
+                      algorithm: DEFAULT_WITHOUT_UPSCALE
+                      input_format: YCBCR420P
+                    }
+                  }
+                }
+                node {
+                  calculator: "BorderDetectionCalculator"
+                  input_stream: "VIDEO:video_frames_scaled"
+                  output_stream: "DETECTED_BORDERS:borders"
+                }
+                node {
+                  calculator: "ShotBoundaryCalculator"
+                  input_stream: "VIDEO:video_frames_scaled"
+                  output_stream: "IS_SHOT_CHANGE:shot_change"
+                }
+                node {
+                  calculator: "SceneCroppingCalculator"
+                  input_side_packet: "EXTERNAL_ASPECT_RATIO:aspect_ratio"
+                  input_stream: "VIDEO_SIZE:video_size"
+                  input_stream: "KEY_FRAMES:video_frames_scaled"
+                  input_stream: "STATIC_FEATURES:borders"
+                  input_stream: "SHOT_BOUNDARIES:shot_change"
+                  output_stream: "EXTERNAL_RENDERING_PER_FRAME:external_rendering_per_frame"
+                  options: {
+                    [mediapipe.autoflip.SceneCroppingCalculatorOptions.ext]: {
+                      max_scene_size: 600
+                      target_size_type: MAXIMIZE_TARGET_DIMENSION
+                    }
+                  }
+                })";
+
+            // Returns an I420 frame of a bright square on a dark background.
+            // The square moves with |index| and jumps at kCutFrame.
+            std::unique_ptr<mediapipe::YUVImage> MakeFrame(int index) {
+                const int uv_width = kWidth / 2;
+                const int uv_height = kHeight / 2;
+                auto y = absl::make_unique<uint8[]>(kWidth * kHeight);
+                auto u = absl::make_unique<uint8[]>(uv_width * uv_height);
+                auto v = absl::make_unique<uint8[]>(uv_width * uv_height);
+                std::fill_n(y.get(), kWidth * kHeight, index < kCutFrame ? 16 : 200);
+                std::fill_n(u.get(), uv_width * uv_height, 128);
+                std::fill_n(v.get(), uv_width * uv_height, 128);
+                const int left = (index < kCutFrame ? 20 : 200) + index;
+                for (int row = 80; row < 160; ++row) {
+                    std::fill_n(y.get() + row * kWidth + left, 60, index < kCutFrame ? 235 : 16);
+                }
+                return absl::make_unique<mediapipe::YUVImage>(libyuv::FOURCC_I420, std::move(y), kWidth,
+                    std::move(u), uv_width, std::move(v), uv_width, kWidth, kHeight);
+            }
+
+            std::unique_ptr<mediapipe::VideoHeader> MakeHeader() {
+                auto header = absl::make_unique<mediapipe::VideoHeader>();
+                header->width = kWidth;
+                header->height = kHeight;
+                header->frame_rate = 15;
+                header->format = drishti::ImageFormat::YCBCR420P;
+                return header;
+            }
+
+            // Returns the timestamps of the test clip at 15 fps.
+            std::vector<int64> EvenTimestamps() {
+                std::vector<int64> timestamps;
+                for (int i = 0; i < kNumFrames; ++i) {
+                    timestamps.push_back(i * Timestamp::kTimestampUnitsPerSecond / 15);
+                }
+                return timestamps;
+            }
+
+            // Runs the graph on the test clip, with frame i at
+            // |timestamps_us[i]|. If |header_once| the header is sent at
+            // PreStream and the size with the first frame only, as the bridge
+            // does after startStream. Otherwise both are sent with every
+            // frame, as the bridge did before.
+            void RunGraph(bool header_once, const std::vector<int64>& timestamps_us,
+                std::vector<mediapipe::autoflip::ExternalRenderFrame>* crops,
+                int* num_input_packets) {
+                CalculatorGraph graph;
+                MP_ASSERT_OK(graph.Initialize(
+                    ParseTextProtoOrDie<CalculatorGraphConfig>(kGraph)));
+                MP_ASSERT_OK(graph.ObserveOutputStream(
+                    "external_rendering_per_frame", [crops](const Packet& packet) {
+                        crops->push_back(packet.Get<mediapipe::autoflip::ExternalRenderFrame>());
+                        return OkStatus();
+                    }));
+                MP_ASSERT_OK(graph.StartRun(
+                    { { "aspect_ratio", MakePacket<std::string>("1:1") } }));
+
+                *num_input_packets = 0;
+                const auto add_packet = [&graph, num_input_packets](const std::string& stream,
+                    Packet packet) {
+                    ++*num_input_packets;
+                    return graph.AddPacketToInputStream(stream, std::move(packet));
+                };
+                if (header_once) {
+                    MP_ASSERT_OK(add_packet("video_header",
+                        Adopt(MakeHeader().release()).At(Timestamp::PreStream())));
+                }
+                for (int i = 0; i < kNumFrames; ++i) {
+                    const Timestamp timestamp(timestamps_us[i]);
+                    if (!header_once) {
+                        MP_ASSERT_OK(add_packet("video_header",
+                            Adopt(MakeHeader().release()).At(timestamp)));
+                    }
+                    MP_ASSERT_OK(add_packet("input_yuv_raw_data",
+                        Adopt(MakeFrame(i).release()).At(timestamp)));
+                    if (!header_once || i == 0) {
+                        MP_ASSERT_OK(add_packet("video_size",
+                            Adopt(new std::pair<int, int>(kWidth, kHeight)).At(timestamp)));
+                    }
+                    if (header_once && i == 0) {
+                        MP_ASSERT_OK(graph.CloseInputStream("video_size"));
+                    }
+                }
+                MP_ASSERT_OK(graph.CloseAllInputStreams());
+                MP_ASSERT_OK(graph.WaitUntilDone());
+            }
+
+            TEST(AutoflipStreamTest, HeaderOnceGivesSameCropsWithFewerPackets) {
+                std::vector<mediapipe::autoflip::ExternalRenderFrame> per_frame_crops;
+                int per_frame_packets;
+                RunGraph(/*header_once=*/false, EvenTimestamps(), &per_frame_crops, &per_frame_packets);
+                std::vector<mediapipe::autoflip::ExternalRenderFrame> stream_crops;
+                int stream_packets;
+                RunGraph(/*header_once=*/true, EvenTimestamps(), &stream_crops, &stream_packets);
+
+                ASSERT_EQ(kNumFrames, per_frame_crops.size());
+                ASSERT_EQ(per_frame_crops.size(), stream_crops.size());
+                for (int i = 0; i < kNumFrames; ++i) {
+                    EXPECT_EQ(per_frame_crops[i].SerializeAsString(),
+                        stream_crops[i].SerializeAsString()) << "frame " << i;
+                }
+                EXPECT_EQ(3 * kNumFrames, per_frame_packets);
+                EXPECT_EQ(kNumFrames + 2, stream_packets);
+            }
+
+            TEST(AutoflipStreamTest, VariableFrameRateKeepsFrameTimestamps) {
+                // 30 fps with a dropped frame every fourth frame, as a browser
+                // decoder may deliver it.
+                std::vector<int64> timestamps;
+                for (int64 i = 0; static_cast<int>(timestamps.size()) < kNumFrames; ++i) {
+                    if (i % 4 != 3) {
+                        timestamps.push_back(i * Timestamp::kTimestampUnitsPerSecond / 30);
+                    }
+                }
+                std::vector<mediapipe::autoflip::ExternalRenderFrame> crops;
+                int num_packets;
+                RunGraph(/*header_once=*/true, timestamps, &crops, &num_packets);
+
+                ASSERT_EQ(kNumFrames, crops.size());
+                for (int i = 0; i < kNumFrames; ++i) {
+                    EXPECT_EQ(timestamps[i], crops[i].timestamp_us()) << "frame " << i;
+                }
+            }
+
+        }  // namespace
+    }  // namespace wasm
+}  // namespace drishti
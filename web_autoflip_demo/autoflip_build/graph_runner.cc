@@ -0,0 +1,1023 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "web_autoflip_demo/autoflip_build/graph_runner.h"
+
+#ifdef __EMSCRIPTEN__
+#include <emscripten/heap.h>
+#endif
+#include <malloc.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "third_party/absl/memory/memory.h"
+#include "third_party/absl/strings/str_cat.h"
+#include "third_party/absl/synchronization/mutex.h"
+#include "third_party/mediapipe/framework/formats/yuv_image.h"
+#include "third_party/libyuv/files/include/libyuv/video_common.h"
+#include "third_party/mediapipe/framework/formats/image_frame.h"
+#include "third_party/mediapipe/framework/formats/video_stream_header.h"
+#include "third_party/mediapipe/framework/calculator_profile.proto.h"
+#include "third_party/mediapipe/framework/packet.h"
+#include "third_party/mediapipe/framework/thread_pool_executor.h"
+#include "third_party/mediapipe/framework/tool/name_util.h"
+#include "third_party/mediapipe/examples/desktop/autoflip/autoflip_messages.proto.h"
+#include "apps/jspb/jspb_format.h"
+
+namespace drishti {
+    namespace wasm {
+
+        std::vector<CalculatorGraphConfig> graph_configs_;
+
+        namespace {
+
+
+            constexpr char kInputRawDataStream[] = "input_image_raw_data";
+            constexpr char kInputGpuBufferStream[] = "input_frames_gpu";
+            constexpr char kInputRawYuvStream[] = "input_yuv_raw_data";
+            constexpr char kOutputGpuBufferStream[] = "output_frames_gpu";
+
+            OutputData output_;
+
+            bool started_graph_ = false;
+            std::unique_ptr<CalculatorGraph> graph_;
+            // Main graph config of the session, set by OpenSession. Kept
+            // apart from the pushed configs, so that opening another session
+            // replaces it instead of adding a second main graph.
+            std::unique_ptr<CalculatorGraphConfig> session_config_;
+            std::vector<std::function<void()>> action_list_;
+            // Stream state of the current graph run.
+            bool stream_started_ = false;
+            bool video_size_sent_ = false;
+            int stream_width_ = 0;
+            int stream_height_ = 0;
+            // Presentation timestamp of the last frame of the current graph
+            // run, or -1.
+            int64 last_timestamp_us_ = -1;
+            std::string aspect_ratio = "1:1";
+
+            // If not set, released frames are freed instead.
+            const FrameReleaseListener* frame_release_listener_ = nullptr;
+
+            // Per-frame debug logging of the output streams; off by default.
+            bool verbose_logging_ = false;
+
+            // Number of threads the current graph runs on. With 1, the graph
+            // runs on the caller thread in WaitUntilIdle, as
+            // ApplicationThreadExecutor. With more, which needs a pthreads
+            // build in wasm, it runs on a ThreadPoolExecutor and listener
+            // calls are queued until the caller thread waits for the graph.
+            int num_threads_ = 1;
+            // Number of threads of the next graph, from SetNumThreads.
+            int requested_num_threads_ = 1;
+
+            // Frames added to the graph and not yet released by it, which is
+            // what holds the heap while the graph falls behind. Graph
+            // threads release frames.
+            std::atomic<int> frames_in_flight_(0);
+            std::atomic<int> frames_in_flight_high_water_mark_(0);
+            // Packets added to each graph input stream in the current run.
+            std::map<std::string, int64> input_packets_added_;
+            // Largest heap use seen after a frame submission, a run until
+            // idle or a GetStats call, which is where the frames in flight
+            // and the outputs waiting for the caller peak.
+            size_t heap_used_high_water_mark_ = 0;
+
+            // Listener calls made by graph threads, in order.
+            absl::Mutex caller_callbacks_mutex_;
+            std::vector<std::function<void()>> caller_callbacks_;
+
+            // Runs |callback| on the caller thread: now if the graph runs
+            // there, otherwise the next time the caller thread drains the
+            // queue.
+            void RunOnCallerThread(std::function<void()> callback) {
+                if (num_threads_ == 1) {
+                    callback();
+                    return;
+                }
+                absl::MutexLock lock(&caller_callbacks_mutex_);
+                caller_callbacks_.push_back(std::move(callback));
+            }
+
+            // Runs the queued listener calls. Must be called on the caller
+            // thread.
+            void DrainCallerCallbacks() {
+                std::vector<std::function<void()>> callbacks;
+                {
+                    absl::MutexLock lock(&caller_callbacks_mutex_);
+                    callbacks.swap(caller_callbacks_);
+                }
+                for (const auto& callback : callbacks) {
+                    callback();
+                }
+            }
+
+            // Records of one output stream, allocated once on its first
+            // packet. Packets are written in place and handed to the listener
+            // when the buffer is full or the graph has gone idle, instead of
+            // one JSPB string per packet. Graph threads cannot call
+            // listeners, so with a thread pool the buffer grows instead until
+            // the next flush.
+            struct BinaryOutput {
+                absl::Mutex mutex;
+                std::string stream_name;
+                const BinaryOutputListener* listener = nullptr;
+                int capacity = 0;
+                int record_size = 0;
+                std::vector<double> records;
+                int num_records = 0;
+                // Packets arrive in timestamp order, so the timestamp of the
+                // last complete packet written is final once its records are
+                // handed to the listener. SceneCroppingCalculator emits the crop windows
+                // of a scene together, which moves the watermark of its stream
+                // a scene at a time.
+                double last_packet_us = -1;
+                double watermark_us = -1;
+                const WatermarkListener* watermark_listener = nullptr;
+            };
+            std::vector<std::unique_ptr<BinaryOutput>> binary_outputs_;
+
+            void FlushBinaryOutputLocked(BinaryOutput* output) {
+                if (output->num_records > 0) {
+                    output->listener->onRecords(output->stream_name,
+                        output->records.data(), output->num_records);
+                    output->num_records = 0;
+                }
+                if (output->last_packet_us > output->watermark_us) {
+                    output->watermark_us = output->last_packet_us;
+                    if (output->watermark_listener) {
+                        output->watermark_listener->onWatermark(output->stream_name,
+                            output->watermark_us);
+                    }
+                }
+            }
+
+            // Returns the binary output of |stream_name|, or nullptr.
+            BinaryOutput* FindBinaryOutput(const std::string& stream_name) {
+                for (auto& output : binary_outputs_) {
+                    if (output->stream_name == stream_name) {
+                        return output.get();
+                    }
+                }
+                return nullptr;
+            }
+
+            // Returns the next free record of |output|, flushing it first if
+            // it is full. |output->mutex| must be held.
+            double* AppendRecord(BinaryOutput* output, int record_size) {
+                if (output->record_size != record_size) {
+                    output->record_size = record_size;
+                    output->records.assign(output->capacity * record_size, 0.0);
+                    output->num_records = 0;
+                }
+                if (output->num_records == output->capacity) {
+                    if (num_threads_ == 1) {
+                        FlushBinaryOutputLocked(output);
+                    } else {
+                        output->capacity *= 2;
+                        output->records.resize(output->capacity * record_size);
+                    }
+                }
+                return output->records.data() + record_size * output->num_records++;
+            }
+
+            void WriteCropRecord(const mediapipe::autoflip::ExternalRenderFrame& frame,
+                BinaryOutput* output) {
+                double* record = AppendRecord(output, kCropRecordSize);
+                record[kCropTimestampUs] = frame.timestamp_us();
+                record[kCropFromX] = frame.crop_from_location().x();
+                record[kCropFromY] = frame.crop_from_location().y();
+                record[kCropFromWidth] = frame.crop_from_location().width();
+                record[kCropFromHeight] = frame.crop_from_location().height();
+                record[kRenderToX] = frame.render_to_location().x();
+                record[kRenderToY] = frame.render_to_location().y();
+                record[kRenderToWidth] = frame.render_to_location().width();
+                record[kRenderToHeight] = frame.render_to_location().height();
+                record[kPaddingR] = frame.padding_color().r();
+                record[kPaddingG] = frame.padding_color().g();
+                record[kPaddingB] = frame.padding_color().b();
+                record[kTargetWidth] = frame.target_width();
+                record[kTargetHeight] = frame.target_height();
+                output->last_packet_us = frame.timestamp_us();
+            }
+
+            void WriteDetectionRecords(const mediapipe::autoflip::DetectionSet& detection_set,
+                double timestamp_us, BinaryOutput* output) {
+                if (detection_set.detections_size() == 0) {
+                    double* record = AppendRecord(output, kDetectionRecordSize);
+                    std::fill_n(record, kDetectionRecordSize, 0.0);
+                    record[kDetectionTimestampUs] = timestamp_us;
+                    record[kDetectionIndex] = -1;
+                    output->last_packet_us = timestamp_us;
+                    return;
+                }
+                for (int i = 0; i < detection_set.detections_size(); ++i) {
+                    const auto& region = detection_set.detections(i);
+                    double* record = AppendRecord(output, kDetectionRecordSize);
+                    record[kDetectionTimestampUs] = timestamp_us;
+                    record[kDetectionIndex] = i;
+                    record[kDetectionX] = region.location_normalized().x();
+                    record[kDetectionY] = region.location_normalized().y();
+                    record[kDetectionWidth] = region.location_normalized().width();
+                    record[kDetectionHeight] = region.location_normalized().height();
+                    record[kDetectionScore] = region.score();
+                    record[kDetectionSignalType] = region.signal_type().standard();
+                    record[kDetectionIsRequired] = region.is_required();
+                }
+                // Set after the last region, so that a flush between the
+                // regions of a frame does not mark the frame final.
+                output->last_packet_us = timestamp_us;
+            }
+
+            void LogDetectionSet(const mediapipe::autoflip::DetectionSet& detection_set, double time) {
+                LOG(INFO) << "Size of regions in detection set " << detection_set.detections_size()
+                    << " at " << time;
+                for (int i = 0; i < detection_set.detections_size(); i++) {
+                    const auto& region = detection_set.detections(i);
+                    const auto& face = region.location_normalized();
+                    LOG(INFO) << "signal " << region.signal_type().standard()
+                        << " isRequired " << region.is_required() << " score " << region.score()
+                        << " time " << time << " face" << i << " " << face.x() << " " << face.y()
+                        << " " << face.width() << " " << face.height();
+                }
+            }
+
+            void LogUnobservableStream(const std::string& stream_name) {
+                std::cout << "Could not observe '" << stream_name << "'" << std::endl;
+                for (const auto& node : graph_->Config().node()) {
+                    for (const auto& output_stream : node.output_stream()) {
+                        std::cout << "s: " << output_stream << std::endl;
+                    }
+                }
+            }
+
+            // Forwards the packets of one stream to a PacketListener.
+            struct ListenerSink {
+                std::string stream_name;
+                const PacketListener* listener;
+
+                void OnFloat(float value, const Timestamp& timestamp) const {
+                    const auto sink = *this;
+                    RunOnCallerThread([sink, value]() { sink.listener->onNumber(sink.stream_name, value); });
+                }
+                void OnSize(const std::pair<int, int>& size, const Timestamp& timestamp) const {
+                    SizeRect result;
+                    result.x = size.first;
+                    result.y = size.second;
+                    const auto sink = *this;
+                    RunOnCallerThread([sink, result]() { sink.listener->onSize(sink.stream_name, result); });
+                }
+                void OnBool(bool value, const Timestamp& timestamp) const {
+                    const double time = timestamp.Microseconds();
+                    const auto sink = *this;
+                    RunOnCallerThread([sink, value, time]() {
+                        sink.listener->onShot(sink.stream_name, value, time);
+                    });
+                }
+                void OnExternalRenderFrame(const mediapipe::autoflip::ExternalRenderFrame& frame,
+                    const Timestamp& timestamp) const {
+                    apps::jspb::JspbFormat jspb_format;
+                    const std::string proto_str = jspb_format.PrintToString(frame).value_or("");
+                    const auto sink = *this;
+                    RunOnCallerThread([sink, proto_str]() {
+                        sink.listener->onExternalRendering(sink.stream_name, proto_str);
+                    });
+                }
+                void OnDetectionSet(const mediapipe::autoflip::DetectionSet& detection_set,
+                    const Timestamp& timestamp) const {
+                    const double time = timestamp.Microseconds();
+                    if (verbose_logging_) {
+                        LogDetectionSet(detection_set, time);
+                    }
+                    const auto faceRegions = detection_set.detections();
+                    apps::jspb::JspbFormat jspb_format;
+                    const std::string proto_str = jspb_format.PrintToString(faceRegions).value_or("");
+                    const auto sink = *this;
+                    RunOnCallerThread([sink, proto_str, time]() {
+                        sink.listener->onFace(sink.stream_name, proto_str, time);
+                    });
+                }
+            };
+
+            // Writes the packets of one stream as binary records.
+            struct BinaryOutputSink {
+                BinaryOutput* output;
+
+                void OnFloat(float value, const Timestamp& timestamp) const {
+                    LogNoBinaryLayout();
+                }
+                void OnSize(const std::pair<int, int>& size, const Timestamp& timestamp) const {
+                    LogNoBinaryLayout();
+                }
+                void OnBool(bool value, const Timestamp& timestamp) const {
+                    LogNoBinaryLayout();
+                }
+                void OnExternalRenderFrame(const mediapipe::autoflip::ExternalRenderFrame& frame,
+                    const Timestamp& timestamp) const {
+                    absl::MutexLock lock(&output->mutex);
+                    WriteCropRecord(frame, output);
+                }
+                void OnDetectionSet(const mediapipe::autoflip::DetectionSet& detection_set,
+                    const Timestamp& timestamp) const {
+                    const double time = timestamp.Microseconds();
+                    if (verbose_logging_) {
+                        LogDetectionSet(detection_set, time);
+                    }
+                    absl::MutexLock lock(&output->mutex);
+                    WriteDetectionRecords(detection_set, time, output);
+                }
+                void LogNoBinaryLayout() const {
+                    LOG_FIRST_N(ERROR, 1) << "No binary layout for the packets of " << output->stream_name;
+                }
+            };
+
+            // Observes |stream_name| in every graph run with |callback|.
+            void ObserveStream(const std::string& stream_name, PacketCallback callback) {
+                action_list_.push_back([stream_name, callback]() {
+                    if (verbose_logging_) {
+                        LOG(INFO) << "Attaching listener to " << stream_name;
+                    }
+                    if (!graph_
+                        ->ObserveOutputStream(
+                            stream_name,
+                            [callback](const Packet& packet) {
+                                callback(packet);
+                                return OkStatus();
+                            })
+                        .ok()) {
+                        LogUnobservableStream(stream_name);
+                    }
+                    });
+            }
+
+            // Small helper function for passing our additional graph setup to StartGraph.
+            void AdditionalGraphSetup() {
+                // We ignore error status, since it will break and be clearly logged in any
+                // case.
+                // SetupRenderToScreenFromOutput(graph_.get(), kOutputGpuBufferStream);
+                for (const auto& fn : action_list_) {
+                    fn();
+                }
+            }
+
+            // Returns true if a frame presented at |timestamp_us| may follow
+            // the previous frame of the graph run. Presentation timestamps
+            // come from the caller and need not be evenly spaced; the graph
+            // thins the frames it analyzes by time, not by count.
+            bool IsNextFrameTimestamp(double timestamp_us) {
+                if (!std::isfinite(timestamp_us) || timestamp_us < 0 ||
+                    timestamp_us >= Timestamp::Max().Value()) {
+                    LOG(ERROR) << "Invalid frame timestamp " << timestamp_us << " us.";
+                    return false;
+                }
+                if (static_cast<int64>(timestamp_us) <= last_timestamp_us_) {
+                    LOG(ERROR) << "Frame timestamp " << timestamp_us
+                        << " us does not follow the previous one at " << last_timestamp_us_ << " us.";
+                    return false;
+                }
+                return true;
+            }
+
+            // Adds |packet| to the graph input stream |stream_name|, counting
+            // it for the input queue lengths of GetStats.
+            ::mediapipe::Status AddInputPacket(const std::string& stream_name, Packet packet) {
+                const auto status = graph_->AddPacketToInputStream(stream_name, std::move(packet));
+                if (status.ok()) {
+                    input_packets_added_[stream_name]++;
+                }
+                return status;
+            }
+
+            // Returns the heap use and records it in the high water mark.
+            size_t SampleHeapUsed() {
+                const struct mallinfo info = mallinfo();
+                const size_t heap_used = info.uordblks + info.hblkhd;
+                heap_used_high_water_mark_ = std::max(heap_used_high_water_mark_, heap_used);
+                return heap_used;
+            }
+
+            // Records |timestamp_us| as the last frame of the graph run.
+            const Timestamp ProcessCommon(double timestamp_us) {
+                const int64 timestamp = static_cast<int64>(timestamp_us);
+                if (last_timestamp_us_ >= 0) {
+                    output_.mspf = (timestamp - last_timestamp_us_) / 1000.0;
+                }
+                last_timestamp_us_ = timestamp;
+                return Timestamp(timestamp);
+            }
+
+            // OutputData CppProcessGl(FrameDataGl input_frame_ptr) {
+            //   // If graph wasn't started yet, can't process images, so just return.
+            //   if (started_graph_) {
+            //     const Timestamp& timestamp = ProcessCommon(input_frame_ptr.timestamp_ms);
+            //     ProcessGpuBuffer(graph_.get(), kInputGpuBufferStream, &input_frame_ptr,
+            //                      timestamp);
+            //     CHECK_OK(graph_->WaitUntilIdle());
+            //   }
+            //   return output_;
+            // }
+
+            // bool CppBindCanvasTexture() {
+            //   if (!started_graph_) {
+            //     printf("Waiting for graph start in order to bind texture to canvas.\n");
+            //     return false;
+            //   }
+            //   BindCanvasTexture();
+            //   return true;
+            // }
+
+            // Starts a new run of the initialized graph, for a new video.
+            void StartRunInternal() {
+                CHECK_OK(graph_->StartRun({ { "aspect_ratio", mediapipe::Adopt(absl::make_unique<std::string>(aspect_ratio).release()) } }));
+                stream_started_ = false;
+                video_size_sent_ = false;
+                last_timestamp_us_ = -1;
+                input_packets_added_.clear();
+                for (auto& output : binary_outputs_) {
+                    absl::MutexLock lock(&output->mutex);
+                    output->last_packet_us = -1;
+                    output->watermark_us = -1;
+                }
+            }
+
+            void StartGraphInternal() {
+                num_threads_ = requested_num_threads_;
+                std::vector<CalculatorGraphConfig> configs = graph_configs_;
+                if (session_config_) {
+                    configs.push_back(*session_config_);
+                }
+                if (num_threads_ == 1) {
+                    CHECK_OK(graph_->Initialize(configs, {}));
+                } else {
+                    // The configs name ApplicationThreadExecutor as the
+                    // default executor, which a pool set here replaces.
+                    for (auto& config : configs) {
+                        auto* executors = config.mutable_executor();
+                        executors->erase(std::remove_if(executors->begin(), executors->end(),
+                            [](const ExecutorConfig& executor) { return executor.name().empty(); }),
+                            executors->end());
+                    }
+                    CHECK_OK(graph_->SetExecutor(
+                        "", std::make_shared<mediapipe::ThreadPoolExecutor>(num_threads_)));
+                    CHECK_OK(graph_->Initialize(configs, {}));
+                }
+                AdditionalGraphSetup();
+                StartRunInternal();
+            }
+
+            // Nominal frame rate of the video header if frames are sent
+            // without calling StartStream. Frames are timed by their own
+            // timestamps.
+            constexpr double kDefaultFps = 15.0;
+
+            // Adds the I420 frame at |data| to the graph without copying it,
+            // presented at |timestamp_us|. |release_frame| is called once the
+            // graph releases the packet. Starts the stream on the first frame
+            // if StartStream was not called.
+            bool AddYuvFrame(uint8* data, int image_width, int image_height,
+                std::function<void()> release_frame, double timestamp_us) {
+                const int src_width = image_width;
+                const int src_height = image_height;
+                const size_t y_size = src_width * src_height;
+                const size_t uv_size = src_width * src_height / 4;
+
+                const auto y_ptr = data;
+                const auto u_ptr = y_ptr + y_size;
+                const auto v_ptr = u_ptr + uv_size;
+
+                const int in_flight = ++frames_in_flight_;
+                int high_water_mark = frames_in_flight_high_water_mark_;
+                while (in_flight > high_water_mark &&
+                    !frames_in_flight_high_water_mark_.compare_exchange_weak(high_water_mark, in_flight)) {
+                }
+                auto release_counted_frame = [release_frame = std::move(release_frame)]() {
+                    --frames_in_flight_;
+                    release_frame();
+                };
+                // Created first, so that the frame is released on any error.
+                auto yuv_image = absl::make_unique<mediapipe::YUVImage>(libyuv::FOURCC_I420, std::move(release_counted_frame),
+                    y_ptr, src_width, u_ptr, src_width / 2, v_ptr,
+                    src_width / 2, src_width, src_height);
+                if (!stream_started_ && !StartStream(src_width, src_height, kDefaultFps)) {
+                    return false;
+                }
+                if (src_width != stream_width_ || src_height != stream_height_) {
+                    LOG(ERROR) << "Frame size " << src_width << "x" << src_height
+                        << " differs from the stream size " << stream_width_ << "x" << stream_height_;
+                    return false;
+                }
+                if (!IsNextFrameTimestamp(timestamp_us)) {
+                    return false;
+                }
+                const Timestamp timestamp = ProcessCommon(timestamp_us);
+                CHECK_OK(AddInputPacket(
+                    "input_yuv_raw_data",
+                    drishti::Adopt(yuv_image.release()).At(timestamp)));
+                // SceneCroppingCalculator only reads the size from its first
+                // input set. The stream is closed afterwards so that it does
+                // not hold back later timestamps.
+                if (!video_size_sent_) {
+                    auto video_size = absl::make_unique<std::pair<int, int>>(src_width, src_height);
+                    CHECK_OK(AddInputPacket(
+                        "video_size",
+                        drishti::Adopt(video_size.release()).At(timestamp)));
+                    CHECK_OK(graph_->CloseInputStream("video_size"));
+                    video_size_sent_ = true;
+                }
+                return true;
+            }
+
+            // Hands a caller buffer the graph no longer needs back to the
+            // caller, or frees it if no FrameReleaseListener is set.
+            void ReleaseCallerBuffer(uint8* buffer) {
+                if (frame_release_listener_) {
+                    const FrameReleaseListener* listener = frame_release_listener_;
+                    RunOnCallerThread([listener, buffer]() { listener->onFrameReleased(buffer); });
+                } else {
+                    free(buffer);
+                }
+            }
+
+            // See CreateFrameRing. Packets in flight share ownership of the
+            // ring, so it stays valid if a new ring is created meanwhile.
+            struct FrameRing {
+                // Guards the slot state, which graph threads update on
+                // release.
+                absl::Mutex mutex;
+                std::unique_ptr<uint8[]> buffer;
+                int width = 0;
+                int height = 0;
+                size_t slot_bytes = 0;
+                // Slots acquired by the caller or owned by the graph.
+                std::vector<bool> in_use;
+                int num_in_use = 0;
+                int high_water_mark = 0;
+                // Slot where the search for a free slot starts.
+                int next_slot = 0;
+            };
+            std::shared_ptr<FrameRing> frame_ring_;
+
+            // Returns the slot index of |ptr|, or -1.
+            int FrameRingSlot(const FrameRing& ring, const uint8* ptr) {
+                if (ptr < ring.buffer.get()) {
+                    return -1;
+                }
+                const size_t offset = ptr - ring.buffer.get();
+                if (offset % ring.slot_bytes != 0 ||
+                    offset / ring.slot_bytes >= ring.in_use.size()) {
+                    return -1;
+                }
+                return offset / ring.slot_bytes;
+            }
+
+            void ReleaseFrameSlot(FrameRing* ring, int slot) {
+                absl::MutexLock lock(&ring->mutex);
+                ring->in_use[slot] = false;
+                ring->num_in_use--;
+            }
+
+            // Returns the input stream name of the "TAG:INDEX:name" |spec|.
+            std::string StreamName(const std::string& spec) {
+                return spec.substr(spec.rfind(':') + 1);
+            }
+
+        }  // namespace
+
+        void ClearGraphs() {
+            graph_configs_.clear();
+            session_config_.reset();
+        }
+
+        bool PushBinaryGraph(const std::string& data) {
+            CalculatorGraphConfig graph_config;
+            // We grab the graph from the compiled binary data string.
+            if (!graph_config.ParseFromArray(data.c_str(), data.length())) {
+                printf("Subgraph config failed to parse from binary string!\n");
+                return false;
+            }
+            graph_configs_.push_back(graph_config);
+            return true;
+        }
+
+        void CloseGraph() {
+            CHECK_OK(graph_->CloseAllInputStreams());
+            CHECK_OK(graph_->WaitUntilDone());
+            FlushBinaryOutputs();
+        }
+
+        int SetNumThreads(int num_threads) {
+#if !defined(__EMSCRIPTEN__) || defined(__EMSCRIPTEN_PTHREADS__)
+            requested_num_threads_ = std::max(num_threads, 1);
+#else
+            if (num_threads > 1) {
+                LOG(WARNING) << "Built without pthreads; the graph runs on the caller thread.";
+            }
+            requested_num_threads_ = 1;
+#endif
+            return requested_num_threads_;
+        }
+
+        bool OpenSession(const std::string& data) {
+            auto graph_config = absl::make_unique<CalculatorGraphConfig>();
+            if (!graph_config->ParseFromArray(data.c_str(), data.length())) {
+                LOG(ERROR) << "Graph config failed to parse from binary string.";
+                return false;
+            }
+            session_config_ = std::move(graph_config);
+            CycleGraph();
+            return true;
+        }
+
+        bool FlushSession() {
+            if (!started_graph_) {
+                LOG(ERROR) << "OpenSession must be called first.";
+                return false;
+            }
+            const bool ok = graph_->CloseAllInputStreams().ok() && graph_->WaitUntilDone().ok();
+            FlushBinaryOutputs();
+            StartRunInternal();
+            return ok;
+        }
+
+        bool ResetSession() {
+            if (!started_graph_) {
+                LOG(ERROR) << "OpenSession must be called first.";
+                return false;
+            }
+            graph_->Cancel();
+            // Returns the cancellation status.
+            graph_->WaitUntilDone().IgnoreError();
+            DrainCallerCallbacks();
+            for (auto& output : binary_outputs_) {
+                absl::MutexLock lock(&output->mutex);
+                output->num_records = 0;
+            }
+            StartRunInternal();
+            return true;
+        }
+
+        bool ProcessRawBytes(const std::string& data, double timestamp_us) {
+            if (started_graph_) {
+                // Ends the previous image's run, whose crops are only emitted
+                // on Close, before this image starts a new one.
+                FlushSession();
+            } else {
+                CycleGraph();
+            }
+            if (!IsNextFrameTimestamp(timestamp_us)) {
+                return false;
+            }
+            const Timestamp& timestamp = ProcessCommon(timestamp_us);
+            return AddInputPacket(kInputRawDataStream,
+                    MakePacket<string>(data).At(timestamp))
+                .ok() &&
+                graph_->WaitUntilIdle().ok();
+        }
+
+        bool SetAspectRatio(int aspect_left, int aspect_right) {
+            aspect_ratio = absl::StrCat(aspect_left, ":", aspect_right);
+            return true;
+        }
+
+        void SetFrameReleaseListener(const FrameReleaseListener& listener) {
+            frame_release_listener_ = &listener;
+        }
+
+        bool StartStream(int width, int height, double fps) {
+            if (stream_started_) {
+                LOG(ERROR) << "Stream already started; cycle the graph to start a new one.";
+                return false;
+            }
+            auto header = absl::make_unique<mediapipe::VideoHeader>();
+            header->height = height;
+            header->width = width;
+            header->frame_rate = fps;
+            header->format = drishti::ImageFormat::YCBCR420P;
+            CHECK_OK(AddInputPacket(
+                "video_header",
+                drishti::Adopt(header.release()).At(drishti::Timestamp::PreStream())));
+            stream_started_ = true;
+            video_size_sent_ = false;
+            stream_width_ = width;
+            stream_height_ = height;
+            return true;
+        }
+
+        bool ProcessRawYuvBytes(uint8* data, int image_width, int image_height,
+            double timestamp_us) {
+            const auto release_frame = [data]() { ReleaseCallerBuffer(data); };
+            const bool ok = AddYuvFrame(data, image_width, image_height, release_frame, timestamp_us);
+            SampleHeapUsed();
+            return ok;
+        }
+
+        bool CreateFrameRing(int width, int height, int num_slots) {
+            if (width <= 0 || height <= 0 || width % 2 || height % 2 || num_slots <= 0) {
+                LOG(ERROR) << "Invalid frame ring " << width << "x" << height
+                    << " with " << num_slots << " slots.";
+                return false;
+            }
+            auto ring = std::make_shared<FrameRing>();
+            ring->width = width;
+            ring->height = height;
+            ring->slot_bytes = width * height * 3 / 2;
+            ring->buffer = absl::make_unique<uint8[]>(ring->slot_bytes * num_slots);
+            ring->in_use.assign(num_slots, false);
+            frame_ring_ = std::move(ring);
+            return true;
+        }
+
+        uint8* AcquireFrameSlots(int count) {
+            if (!frame_ring_) {
+                LOG(ERROR) << "CreateFrameRing must be called first.";
+                return nullptr;
+            }
+            FrameRing* ring = frame_ring_.get();
+            absl::MutexLock lock(&ring->mutex);
+            const int num_slots = ring->in_use.size();
+            if (count <= 0 || count > num_slots) {
+                LOG(ERROR) << "Cannot acquire " << count << " of " << num_slots << " frame slots.";
+                return nullptr;
+            }
+            for (int i = 0; i < num_slots; ++i) {
+                const int first_slot = (ring->next_slot + i) % num_slots;
+                if (first_slot + count > num_slots) {
+                    continue;
+                }
+                if (std::any_of(ring->in_use.begin() + first_slot,
+                    ring->in_use.begin() + first_slot + count,
+                    [](bool in_use) { return in_use; })) {
+                    continue;
+                }
+                std::fill_n(ring->in_use.begin() + first_slot, count, true);
+                ring->num_in_use += count;
+                ring->high_water_mark = std::max(ring->high_water_mark, ring->num_in_use);
+                ring->next_slot = (first_slot + count) % num_slots;
+                return ring->buffer.get() + first_slot * ring->slot_bytes;
+            }
+            return nullptr;
+        }
+
+        uint8* AcquireFrameSlot() {
+            return AcquireFrameSlots(1);
+        }
+
+        bool SubmitFrameSlot(uint8* slot_ptr, double timestamp_us) {
+            if (!frame_ring_) {
+                LOG(ERROR) << "CreateFrameRing must be called first.";
+                return false;
+            }
+            std::shared_ptr<FrameRing> ring = frame_ring_;
+            const int slot = FrameRingSlot(*ring, slot_ptr);
+            bool acquired;
+            {
+                absl::MutexLock lock(&ring->mutex);
+                acquired = slot >= 0 && ring->in_use[slot];
+            }
+            if (!acquired) {
+                LOG(ERROR) << "Frame slot " << static_cast<void*>(slot_ptr) << " was not acquired.";
+                return false;
+            }
+            const bool ok = AddYuvFrame(slot_ptr, ring->width, ring->height,
+                [ring, slot]() { ReleaseFrameSlot(ring.get(), slot); }, timestamp_us);
+            SampleHeapUsed();
+            return ok;
+        }
+
+        FrameRingOccupancy GetFrameRingOccupancy() {
+            FrameRingOccupancy occupancy = { 0, 0, 0 };
+            if (frame_ring_) {
+                absl::MutexLock lock(&frame_ring_->mutex);
+                occupancy.slots = frame_ring_->in_use.size();
+                occupancy.inUse = frame_ring_->num_in_use;
+                occupancy.highWaterMark = frame_ring_->high_water_mark;
+            }
+            return occupancy;
+        }
+
+        bool ProcessYuvBatch(uint8* data, int count, int image_width, int image_height,
+            const double* timestamps_us, bool wait_until_idle) {
+            if (count <= 0) {
+                LOG(ERROR) << "Empty frame batch.";
+                return false;
+            }
+            const size_t frame_bytes = image_width * image_height * 3 / 2;
+
+            std::shared_ptr<FrameRing> ring = frame_ring_;
+            const int first_slot = ring ? FrameRingSlot(*ring, data) : -1;
+            if (first_slot >= 0) {
+                absl::MutexLock lock(&ring->mutex);
+                if (image_width != ring->width || image_height != ring->height ||
+                    first_slot + count > ring->in_use.size() ||
+                    !std::all_of(ring->in_use.begin() + first_slot,
+                        ring->in_use.begin() + first_slot + count,
+                        [](bool in_use) { return in_use; })) {
+                    LOG(ERROR) << "Batch does not fit the acquired frame slots.";
+                    return false;
+                }
+            }
+            // Owns a caller buffer until the last frame is released.
+            std::shared_ptr<uint8> caller_buffer;
+            if (first_slot < 0) {
+                caller_buffer = std::shared_ptr<uint8>(data,
+                    [](uint8* buffer) { ReleaseCallerBuffer(buffer); });
+            }
+
+            for (int i = 0; i < count; ++i) {
+                std::function<void()> release_frame;
+                if (first_slot >= 0) {
+                    const int slot = first_slot + i;
+                    release_frame = [ring, slot]() { ReleaseFrameSlot(ring.get(), slot); };
+                } else {
+                    release_frame = [caller_buffer]() mutable { caller_buffer.reset(); };
+                }
+                if (!AddYuvFrame(data + i * frame_bytes, image_width, image_height,
+                    std::move(release_frame), timestamps_us[i])) {
+                    // Frames that were not sent give their slots back.
+                    for (int j = i + 1; first_slot >= 0 && j < count; ++j) {
+                        ReleaseFrameSlot(ring.get(), first_slot + j);
+                    }
+                    return false;
+                }
+            }
+            SampleHeapUsed();
+            if (!wait_until_idle) {
+                return true;
+            }
+            return RunTillIdle();
+        }
+
+        bool RunTillIdle() {
+            const bool ok = graph_->WaitUntilIdle().ok();
+            // Sampled before the outputs are handed to the listeners, while
+            // the graph still holds them.
+            SampleHeapUsed();
+            FlushBinaryOutputs();
+            return ok;
+        }
+
+        GraphStats GetStats() {
+            GraphStats stats;
+            const size_t heap_used = SampleHeapUsed();
+#ifdef __EMSCRIPTEN__
+            stats.heapSize = emscripten_get_heap_size();
+#else
+            const struct mallinfo info = mallinfo();
+            stats.heapSize = info.arena + info.hblkhd;
+#endif
+            stats.heapUsed = heap_used;
+            stats.heapUsedHighWaterMark = heap_used_high_water_mark_;
+            stats.framesInFlight = frames_in_flight_;
+            stats.framesInFlightHighWaterMark = frames_in_flight_high_water_mark_;
+            if (!started_graph_) {
+                return stats;
+            }
+
+            std::vector<CalculatorProfile> profiles;
+            if (!graph_->profiler()->GetCalculatorProfiles(&profiles).ok()) {
+                profiles.clear();
+            }
+            std::map<std::string, int64> process_calls;
+            for (const auto& profile : profiles) {
+                CalculatorStats calculator;
+                calculator.name = profile.name();
+                int64 calls = 0;
+                for (const int64 count : profile.process_runtime().count()) {
+                    calls += count;
+                }
+                process_calls[profile.name()] = calls;
+                calculator.processCalls = calls;
+                calculator.processTimeUs = profile.process_runtime().total();
+                calculator.averageProcessTimeUs =
+                    calls > 0 ? calculator.processTimeUs / calls : 0.0;
+                stats.calculators.push_back(calculator);
+            }
+
+            // A graph input packet is queued until its slowest consumer
+            // has processed it. Without the profiler, only the packets
+            // added are known, and they are all reported as queued.
+            const auto& config = graph_->Config();
+            for (const auto& entry : input_packets_added_) {
+                int64 consumed = profiles.empty() ? 0 : entry.second;
+                for (int i = 0; i < config.node_size(); ++i) {
+                    const auto& inputs = config.node(i).input_stream();
+                    if (std::none_of(inputs.begin(), inputs.end(),
+                        [&entry](const std::string& spec) { return StreamName(spec) == entry.first; })) {
+                        continue;
+                    }
+                    const auto calls = process_calls.find(tool::CanonicalNodeName(config, i));
+                    if (calls != process_calls.end()) {
+                        consumed = std::min(consumed, calls->second);
+                    }
+                }
+                InputQueueStats queue;
+                queue.stream = entry.first;
+                queue.queued = std::max<int64>(entry.second - consumed, 0);
+                stats.inputQueues.push_back(queue);
+            }
+            return stats;
+        }
+
+        void AttachTypedListener(const std::string& stream_name, PacketType packet_type,
+            const PacketListener& listener) {
+            ObserveStream(stream_name, MakeStreamObserver(stream_name, packet_type,
+                ListenerSink{ stream_name, &listener }));
+        }
+
+        void AttachListener(const std::string& stream_name,
+            const PacketListener& listener) {
+            AttachTypedListener(stream_name, PacketType::kUnknown, listener);
+        }
+
+        void AttachBinaryListener(const std::string& stream_name, int capacity,
+            const BinaryOutputListener& listener) {
+            auto output = absl::make_unique<BinaryOutput>();
+            output->stream_name = stream_name;
+            output->listener = &listener;
+            output->capacity = std::max(capacity, 1);
+            BinaryOutput* output_ptr = output.get();
+            binary_outputs_.push_back(std::move(output));
+
+            // Records left over from a previous graph run are dropped.
+            action_list_.push_back([output_ptr]() {
+                absl::MutexLock lock(&output_ptr->mutex);
+                output_ptr->num_records = 0;
+            });
+            ObserveStream(stream_name, MakeStreamObserver(stream_name, PacketType::kUnknown,
+                BinaryOutputSink{ output_ptr }));
+        }
+
+        bool AttachWatermarkListener(const std::string& stream_name,
+            const WatermarkListener& listener) {
+            BinaryOutput* output = FindBinaryOutput(stream_name);
+            if (!output) {
+                LOG(ERROR) << "No binary output for " << stream_name;
+                return false;
+            }
+            absl::MutexLock lock(&output->mutex);
+            output->watermark_listener = &listener;
+            return true;
+        }
+
+        double GetWatermark(const std::string& stream_name) {
+            BinaryOutput* output = FindBinaryOutput(stream_name);
+            if (!output) {
+                return -1;
+            }
+            absl::MutexLock lock(&output->mutex);
+            return output->watermark_us;
+        }
+
+        void SetVerboseLogging(bool verbose) {
+            verbose_logging_ = verbose;
+        }
+
+        void FlushBinaryOutputs() {
+            DrainCallerCallbacks();
+            for (auto& output : binary_outputs_) {
+                absl::MutexLock lock(&output->mutex);
+                FlushBinaryOutputLocked(output.get());
+            }
+        }
+
+        void CycleGraph() {
+            // Finish and close out the old graph, if any.
+            if (started_graph_) {
+                CloseGraph();
+            }
+
+            // Graphs can only be initialized once, so need a new one.
+            graph_.reset(new CalculatorGraph());
+
+            // Start the graph running, with all pieces.
+            StartGraphInternal();
+
+            // if (!started_graph_) {
+            //   SetupPassthroughShader();
+            // }
+            started_graph_ = true;
+        }
+
+    }  // namespace wasm
+}  // namespace drishti
@@ -0,0 +1,299 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// The graph runner behind the wasm bridge: it owns one AutoFlip graph, feeds
+// it I420 frames and hands its outputs to listeners. It is plain C++, so that
+// autoflip.embind.cc only binds it to JS and native binaries such as
+// graph_runner_benchmark drive the same web graph the same way.
+//
+// Like the wasm module it was written for, there is one runner per process.
+// All functions must be called on one thread, the caller thread, which is the
+// JS thread in the browser. Listeners are called on the caller thread too,
+// from the functions that run the graph or flush its outputs.
+
+#ifndef WEB_AUTOFLIP_DEMO_AUTOFLIP_BUILD_GRAPH_RUNNER_H_
+#define WEB_AUTOFLIP_DEMO_AUTOFLIP_BUILD_GRAPH_RUNNER_H_
+
+#include <string>
+#include <vector>
+
+#include "third_party/mediapipe/framework/calculator_framework.h"
+#include "web_autoflip_demo/autoflip_build/packet_dispatch.h"
+
+namespace drishti {
+    namespace wasm {
+
+        // Make these available externally for text support.
+        extern std::vector<CalculatorGraphConfig> graph_configs_;
+
+        // We bundle all output here for parsing back to JS.
+        struct OutputData {
+            float mspf;  // ms between the last two frames.
+        };
+
+        struct SizeRect {
+            int x;
+            int y;
+        };
+
+        struct PacketListener {
+            virtual ~PacketListener() {}
+            virtual void onSize(const std::string& stream, const SizeRect& data) const {}
+            virtual void onNumber(const std::string& stream, double number) const {}
+            virtual void onShot(const std::string& stream, bool shotChanged, double timestamp_seconds) const {}
+            virtual void onExternalRendering(const std::string& stream, const std::string& frame_proto_str) const {}
+            virtual void onFace(const std::string &stream, const std::string &face_proto_str, double timestamp) const {}
+        };
+
+        // Receives the frame buffers passed to ProcessRawYuvBytes and
+        // ProcessYuvBatch once the graph has released them, so that the
+        // caller can reuse the buffers.
+        struct FrameReleaseListener {
+            virtual ~FrameReleaseListener() {}
+            virtual void onFrameReleased(uint8* buffer) const {}
+        };
+
+        // Receives the records of a binary output once per batch. The
+        // records are |num_records| fixed-layout rows of doubles starting at
+        // |records|, and are only valid during the call.
+        struct BinaryOutputListener {
+            virtual ~BinaryOutputListener() {}
+            virtual void onRecords(const std::string& stream, const double* records, int num_records) const {}
+        };
+
+        // Receives the watermark of a binary output: every record of the
+        // stream up to |timestamp_us| has been handed to onRecords and no
+        // record at or before it will follow in this graph run.
+        struct WatermarkListener {
+            virtual ~WatermarkListener() {}
+            virtual void onWatermark(const std::string& stream, double timestamp_us) const {}
+        };
+
+        // Record layout of an ExternalRenderFrame.
+        enum CropRecordField {
+            kCropTimestampUs = 0,
+            kCropFromX,
+            kCropFromY,
+            kCropFromWidth,
+            kCropFromHeight,
+            kRenderToX,
+            kRenderToY,
+            kRenderToWidth,
+            kRenderToHeight,
+            kPaddingR,
+            kPaddingG,
+            kPaddingB,
+            kTargetWidth,
+            kTargetHeight,
+            kCropRecordSize,
+        };
+
+        // Record layout of one region of a DetectionSet. A frame without
+        // regions gets a single record with region index -1.
+        enum DetectionRecordField {
+            kDetectionTimestampUs = 0,
+            kDetectionIndex,
+            kDetectionX,
+            kDetectionY,
+            kDetectionWidth,
+            kDetectionHeight,
+            kDetectionScore,
+            kDetectionSignalType,
+            kDetectionIsRequired,
+            kDetectionRecordSize,
+        };
+
+        struct FrameRingOccupancy {
+            int slots;
+            int inUse;
+            int highWaterMark;
+        };
+
+        struct CalculatorStats {
+            std::string name;
+            double processCalls;
+            double processTimeUs;
+            double averageProcessTimeUs;
+        };
+
+        struct InputQueueStats {
+            std::string stream;
+            int queued;
+        };
+
+        struct GraphStats {
+            // Size of the heap, which never shrinks in wasm, and the part of
+            // it malloc has handed out.
+            double heapSize;
+            double heapUsed;
+            // Largest heapUsed sampled after each frame submission and run
+            // until idle, not only at GetStats calls.
+            double heapUsedHighWaterMark;
+            int framesInFlight;
+            int framesInFlightHighWaterMark;
+            std::vector<InputQueueStats> inputQueues;
+            std::vector<CalculatorStats> calculators;
+        };
+
+        // Graphs.
+
+        // Drops the pushed configs and the config of the session.
+        void ClearGraphs();
+
+        // Adds a graph config, usually a subgraph, for the graphs opened
+        // from now on. Pushed configs stay until ClearGraphs.
+        bool PushBinaryGraph(const std::string& data);
+
+        // Finishes the current graph, if any, and initializes and starts a
+        // new one from the pushed configs and the config of the session.
+        void CycleGraph();
+
+        // Closes the input streams of the current graph, waits until it is
+        // done and delivers its outputs.
+        void CloseGraph();
+
+        // Sets the number of threads of graphs opened from now on, and
+        // returns the number that will be used: |num_threads|, or 1 in a
+        // wasm build without pthreads. With 1, the graph runs on the caller
+        // thread while the caller waits for it.
+        int SetNumThreads(int num_threads);
+
+        // The aspect ratio is read at the start of each graph run.
+        bool SetAspectRatio(int aspect_left, int aspect_right);
+
+        void SetVerboseLogging(bool verbose);
+
+        // Sessions. A session keeps one initialized graph, with its
+        // observers and executor, for any number of videos. FlushSession ends
+        // a video and ResetSession drops one; both then start a new run of
+        // the same graph, so that the next video does not pay for
+        // Initialize.
+
+        // Opens a session on the pushed subgraphs and the graph config
+        // |data|, replacing any running graph and the graph config of the
+        // previous session.
+        bool OpenSession(const std::string& data);
+
+        // Delivers all outputs of the current video and starts a new run.
+        bool FlushSession();
+
+        // Drops the current video without delivering its pending outputs
+        // and starts a new run.
+        bool ResetSession();
+
+        // Outputs. Listeners are attached for every graph run from the next
+        // one on, and must outlive the runner.
+
+        // Forwards the packets of |stream_name|, which must be of
+        // |packet_type|, to |listener| without checking the type of each
+        // packet.
+        void AttachTypedListener(const std::string& stream_name, PacketType packet_type,
+            const PacketListener& listener);
+
+        // As AttachTypedListener, with the packet type resolved from the
+        // first packet of the stream.
+        void AttachListener(const std::string& stream_name, const PacketListener& listener);
+
+        // Delivers the ExternalRenderFrame or DetectionSet packets of
+        // |stream_name| as binary records, |capacity| records at a time at
+        // most. See CropRecordField and DetectionRecordField for the
+        // layouts.
+        void AttachBinaryListener(const std::string& stream_name, int capacity,
+            const BinaryOutputListener& listener);
+
+        // Calls |listener| whenever the watermark of the binary output of
+        // |stream_name| advances, right after the records up to it were
+        // delivered. The output must be attached first. For the crop windows
+        // this happens once per scene, so playback can start after the first
+        // scene instead of after the whole video.
+        bool AttachWatermarkListener(const std::string& stream_name,
+            const WatermarkListener& listener);
+
+        // Returns the watermark of the binary output of |stream_name| in the
+        // current graph run, in microseconds, or -1 if none of its records
+        // was delivered yet.
+        double GetWatermark(const std::string& stream_name);
+
+        // Hands all pending records and queued listener calls to the
+        // listeners.
+        void FlushBinaryOutputs();
+
+        // Frames. Timestamps are presentation timestamps in microseconds,
+        // increasing within a graph run.
+
+        // If not set, released frames are freed instead.
+        void SetFrameReleaseListener(const FrameReleaseListener& listener);
+
+        // Sends the video header once for the whole stream. Called on the
+        // first frame if it was not called before.
+        bool StartStream(int width, int height, double fps);
+
+        // Runs the graph on the encoded image |data|, presented at
+        // |timestamp_us|, in a run of its own. The run of the previous image
+        // is flushed first, so all of its outputs reach the listeners.
+        bool ProcessRawBytes(const std::string& data, double timestamp_us);
+
+        // Sends the I420 frame at |data|, a malloc'ed buffer, without copying
+        // it. The graph owns the buffer until it releases the packet; the
+        // buffer is then handed back through the FrameReleaseListener, or
+        // freed if there is none.
+        bool ProcessRawYuvBytes(uint8* data, int image_width, int image_height,
+            double timestamp_us);
+
+        // A preallocated ring of I420 frame slots, so that the memory of a
+        // session does not grow with the video length. Slots are acquired,
+        // filled in place, submitted to the graph and become free again when
+        // the graph releases the frame packet.
+
+        // Preallocates |num_slots| I420 frames of the given size.
+        bool CreateFrameRing(int width, int height, int num_slots);
+
+        // Returns |count| consecutive free slots, for ProcessYuvBatch, or
+        // nullptr if there are none. Running the graph until idle releases
+        // the slots of frames it has finished with.
+        uint8* AcquireFrameSlots(int count);
+
+        // Returns a free slot, or nullptr if every slot is in use.
+        uint8* AcquireFrameSlot();
+
+        // Sends the frame in an acquired slot to the graph at
+        // |timestamp_us|. The slot is recycled when the graph releases it.
+        bool SubmitFrameSlot(uint8* slot, double timestamp_us);
+
+        FrameRingOccupancy GetFrameRingOccupancy();
+
+        // Sends |count| consecutive I420 frames at |data| to the graph in one
+        // call, at the timestamps in |timestamps_us|. Frames are not copied.
+        // If |data| was returned by AcquireFrameSlots, each slot is recycled
+        // when the graph releases its frame. Otherwise |data| is a malloc'ed
+        // buffer that is handed back through the FrameReleaseListener, or
+        // freed, once the graph has released every frame of the batch. If
+        // |wait_until_idle|, the graph runs until idle once after the batch.
+        bool ProcessYuvBatch(uint8* data, int count, int image_width, int image_height,
+            const double* timestamps_us, bool wait_until_idle);
+
+        // Runs the graph until idle and delivers its outputs.
+        bool RunTillIdle();
+
+        // Returns the memory, queue and per-calculator statistics of the
+        // current graph run. The calculator times come from the graph
+        // profiler and are only reported if the graph config enables it.
+        // Cheap enough to poll every second: it copies one small profile per
+        // calculator.
+        GraphStats GetStats();
+
+    }  // namespace wasm
+}  // namespace drishti
+
+#endif  // WEB_AUTOFLIP_DEMO_AUTOFLIP_BUILD_GRAPH_RUNNER_H_
@@ -0,0 +1,222 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Runs the web graph natively through the same graph runner the wasm bridge
+// binds, on raw I420 files, and reports the frames per second of each file.
+// The frames go through a frame ring and processYuvBatch exactly as the
+// worker sends them, so the numbers are comparable with bridge_benchmark.js.
+//
+// Example, with frames extracted by
+//   ffmpeg -i input.mp4 -pix_fmt yuv420p -f rawvideo input.yuv:
+//   graph_runner_benchmark --graph=autoflip_graph.pbtxt \
+//     --input_yuv=input.yuv --width=640 --height=360 --num_threads=4
+//
+// With --output_measurements, the frames per second, the latency to the
+// first crop window, the shot changes and the peak RSS of each file are
+// also written as a binary PerfBaseline, for autoflip_perf_suite. The
+// latency is left unset for a file that got no crop window, which the suite
+// fails.
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "third_party/absl/strings/match.h"
+#include "third_party/absl/strings/str_format.h"
+#include "third_party/absl/strings/str_split.h"
+#include "third_party/absl/time/clock.h"
+#include "third_party/absl/time/time.h"
+#include "third_party/mediapipe/examples/desktop/autoflip/autoflip_messages.proto.h"
+#include "third_party/mediapipe/framework/port/commandlineflags.h"
+#include "third_party/mediapipe/framework/port/parse_text_proto.h"
+#include "web_autoflip_demo/autoflip_build/graph_runner.h"
+
+DEFINE_string(graph, "", "Web graph, as a .pbtxt or a .binarypb file.");
+DEFINE_string(input_yuv, "", "Comma-separated raw I420 files, one video each.");
+DEFINE_int32(width, 640, "Frame width of the input files.");
+DEFINE_int32(height, 360, "Frame height of the input files.");
+DEFINE_double(fps, 15, "Frame rate the frames are timestamped at.");
+DEFINE_int32(num_threads, 1, "Threads of the graph; 1 runs it on this thread.");
+DEFINE_int32(batch_size, 8, "Frames sent per processYuvBatch call.");
+DEFINE_int32(ring_slots, 16, "Slots of the frame ring.");
+DEFINE_string(aspect_ratio, "9:16", "Target aspect ratio.");
+DEFINE_string(output_measurements, "", "If set, a binary PerfBaseline with "
+    "one measurement per input file is written to this path.");
+
+namespace drishti {
+    namespace wasm {
+        namespace {
+
+            constexpr char kCropStream[] = "external_rendering_per_frame";
+            constexpr char kShotStream[] = "shot_change";
+
+            // Counts the crop windows the graph delivers.
+            struct CropCounter : public BinaryOutputListener {
+                mutable int64 num_crops = 0;
+                // When the first crop window of the current file arrived.
+                mutable absl::Time first_crop = absl::InfiniteFuture();
+
+                void onRecords(const std::string& stream, const double* records,
+                    int num_records) const override {
+                    if (num_records > 0 && first_crop == absl::InfiniteFuture()) {
+                        first_crop = absl::Now();
+                    }
+                    num_crops += num_records;
+                }
+            };
+
+            // Records the timestamps of the shot changes of the current file.
+            struct ShotRecorder : public PacketListener {
+                mutable std::vector<int64> shot_change_us;
+
+                // The timestamp is in microseconds.
+                void onShot(const std::string& stream, bool shotChanged,
+                    double timestamp) const override {
+                    if (shotChanged) {
+                        shot_change_us.push_back(static_cast<int64>(timestamp));
+                    }
+                }
+            };
+
+            int64 PeakRssKb() {
+                struct rusage usage;
+                getrusage(RUSAGE_SELF, &usage);
+                return usage.ru_maxrss;
+            }
+
+            // Returns the graph config of --graph, serialized as the worker
+            // fetches it.
+            std::string ReadGraph() {
+                std::ifstream input(FLAGS_graph, std::ios::in | std::ios::binary);
+                CHECK(input.is_open()) << "Fail to open " << FLAGS_graph;
+                const std::string contents((std::istreambuf_iterator<char>(input)),
+                    std::istreambuf_iterator<char>());
+                if (absl::EndsWith(FLAGS_graph, ".pbtxt")) {
+                    return ParseTextProtoOrDie<CalculatorGraphConfig>(contents).SerializeAsString();
+                }
+                return contents;
+            }
+
+            // Sends all frames of |path| to the graph and flushes it. Returns
+            // the number of frames.
+            int RunVideo(const std::string& path) {
+                const std::streamsize frame_bytes = FLAGS_width * FLAGS_height * 3 / 2;
+                std::ifstream input(path, std::ios::in | std::ios::binary | std::ios::ate);
+                CHECK(input.is_open()) << "Fail to open " << path;
+                // Slots cannot be handed back unsubmitted, so only whole
+                // frames are acquired.
+                const int num_frames = input.tellg() / frame_bytes;
+                input.seekg(0);
+                CHECK(StartStream(FLAGS_width, FLAGS_height, FLAGS_fps));
+                std::vector<double> timestamps_us(FLAGS_batch_size);
+                for (int first = 0; first < num_frames; first += FLAGS_batch_size) {
+                    const int count = std::min(FLAGS_batch_size, num_frames - first);
+                    uint8* batch = AcquireFrameSlots(count);
+                    if (batch == nullptr) {
+                        // Running the graph releases the frames it is done with.
+                        CHECK(RunTillIdle());
+                        batch = AcquireFrameSlots(count);
+                        CHECK(batch != nullptr) << "No free frame slots.";
+                    }
+                    CHECK(input.read(reinterpret_cast<char*>(batch), count * frame_bytes));
+                    for (int i = 0; i < count; ++i) {
+                        timestamps_us[i] = std::round((first + i) * 1000000.0 / FLAGS_fps);
+                    }
+                    CHECK(ProcessYuvBatch(batch, count, FLAGS_width, FLAGS_height,
+                        timestamps_us.data(), false)) << "Frame batch at " << first << " failed.";
+                }
+                CHECK(FlushSession());
+                return num_frames;
+            }
+
+            void RunBenchmark() {
+                CHECK(!FLAGS_graph.empty()) << "--graph is required.";
+                CHECK(!FLAGS_input_yuv.empty()) << "--input_yuv is required.";
+                const std::vector<std::string> aspect_ratio =
+                    absl::StrSplit(FLAGS_aspect_ratio, ':');
+                CHECK_EQ(aspect_ratio.size(), 2) << "--aspect_ratio must be W:H.";
+                SetAspectRatio(std::stoi(aspect_ratio[0]), std::stoi(aspect_ratio[1]));
+                const int num_threads = SetNumThreads(FLAGS_num_threads);
+
+                CropCounter crops;
+                AttachBinaryListener(kCropStream, 256, crops);
+                ShotRecorder shots;
+                AttachListener(kShotStream, shots);
+                CHECK(CreateFrameRing(FLAGS_width, FLAGS_height, FLAGS_ring_slots));
+                CHECK(OpenSession(ReadGraph()));
+
+                std::cout << absl::StrFormat("%dx%d I420, %d thread(s)\n", FLAGS_width,
+                    FLAGS_height, num_threads);
+                std::cout << absl::StrFormat("%-32s %8s %8s %10s %14s\n", "input", "frames",
+                    "crops", "fps", "first crop ms");
+                int total_frames = 0;
+                absl::Duration total_time;
+                mediapipe::autoflip::PerfBaseline measurements;
+                for (const auto& path : absl::StrSplit(FLAGS_input_yuv, ',')) {
+                    const int64 crops_before = crops.num_crops;
+                    crops.first_crop = absl::InfiniteFuture();
+                    shots.shot_change_us.clear();
+                    const absl::Time start = absl::Now();
+                    const int num_frames = RunVideo(std::string(path));
+                    const absl::Duration time = absl::Now() - start;
+                    total_frames += num_frames;
+                    total_time += time;
+                    const bool has_crop = crops.first_crop != absl::InfiniteFuture();
+                    const double first_crop_ms =
+                        absl::ToDoubleMilliseconds(crops.first_crop - start);
+                    std::cout << absl::StrFormat("%-32s %8d %8d %10.1f %14s\n", path, num_frames,
+                        crops.num_crops - crops_before, num_frames / absl::ToDoubleSeconds(time),
+                        has_crop ? absl::StrFormat("%.0f", first_crop_ms) : "no crop");
+
+                    auto* measurement = measurements.add_measurement();
+                    measurement->set_case_name(std::string(path));
+                    measurement->set_graph(FLAGS_graph);
+                    measurement->set_frames(num_frames);
+                    measurement->set_frames_per_second(num_frames / absl::ToDoubleSeconds(time));
+                    if (has_crop) {
+                        measurement->set_first_crop_latency_ms(first_crop_ms);
+                    }
+                    measurement->set_peak_rss_kb(PeakRssKb());
+                    for (const int64 timestamp_us : shots.shot_change_us) {
+                        measurement->add_shot_change_us(timestamp_us);
+                    }
+                }
+                const GraphStats stats = GetStats();
+                std::cout << absl::StrFormat("%-32s %8d %8d %10.1f\n", "total", total_frames,
+                    crops.num_crops, total_frames / absl::ToDoubleSeconds(total_time));
+                std::cout << absl::StrFormat("heap %.1f MB, high water mark %.1f MB\n",
+                    stats.heapUsed / 1048576, stats.heapUsedHighWaterMark / 1048576);
+                if (!FLAGS_output_measurements.empty()) {
+                    std::ofstream output(FLAGS_output_measurements,
+                        std::ios::out | std::ios::binary);
+                    CHECK(measurements.SerializeToOstream(&output))
+                        << "Fail to write " << FLAGS_output_measurements;
+                }
+            }
+
+        }  // namespace
+    }  // namespace wasm
+}  // namespace drishti
+
+int main(int argc, char** argv) {
+    gflags::ParseCommandLineFlags(&argc, &argv, true);
+    drishti::wasm::RunBenchmark();
+    return 0;
+}
@@ -0,0 +1,98 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Checks that sessions of the graph runner can be opened repeatedly, with
+// and without pushed subgraphs.
+
+#include <string>
+
+#include "third_party/mediapipe/framework/calculator_framework.h"
+#include "third_party/mediapipe/framework/port/gtest.h"
+#include "third_party/mediapipe/framework/port/parse_text_proto.h"
+#include "web_autoflip_demo/autoflip_build/graph_runner.h"
+
+namespace drishti {
+    namespace wasm {
+        namespace {
+
+            constexpr char kSubgraph[] = R"(
+                type: "PassThroughSubgraph"
+                input_stream: "IN:input"
+                output_stream: "OUT:output"
+                node {
+                  calculator: "PassThroughCalculator"
+                  input_stream: "input"
+                  output_stream: "output"
+                })";
+
+            constexpr char kGraph[] = R"(
+                input_stream: "input_yuv_raw_data"
+                output_stream: "passed_through"
+                node {
+                  calculator: "PassThroughSubgraph"
+                  input_stream: "IN:input_yuv_raw_data"
+                  output_stream: "OUT:passed_through"
+                })";
+
+            std::string Serialize(const char* config) {
+                return ParseTextProtoOrDie<CalculatorGraphConfig>(config).SerializeAsString();
+            }
+
+            // There is one runner per process, so each test starts from
+            // the graph the previous one left running; opening or cycling a
+            // graph closes it.
+            class GraphRunnerTest : public ::testing::Test {
+            protected:
+                void SetUp() override {
+                    ClearGraphs();
+                    ASSERT_TRUE(PushBinaryGraph(Serialize(kSubgraph)));
+                }
+            };
+
+            TEST_F(GraphRunnerTest, OpenSessionTwiceReplacesTheGraph) {
+                ASSERT_TRUE(OpenSession(Serialize(kGraph)));
+                ASSERT_TRUE(FlushSession());
+                // A second main graph next to the first would fail to
+                // initialize.
+                ASSERT_TRUE(OpenSession(Serialize(kGraph)));
+                EXPECT_TRUE(FlushSession());
+            }
+
+            TEST_F(GraphRunnerTest, PushedSubgraphsOutliveSessions) {
+                ASSERT_TRUE(OpenSession(Serialize(kGraph)));
+                ASSERT_TRUE(OpenSession(Serialize(kGraph)));
+                // The subgraph is still registered after the second session
+                // replaced the first main graph, and cycling reuses both.
+                CycleGraph();
+                EXPECT_TRUE(FlushSession());
+            }
+
+            TEST_F(GraphRunnerTest, PushingDoesNotStartAGraph) {
+                ASSERT_TRUE(PushBinaryGraph(Serialize(kGraph)));
+                // changeBinaryGraph only pushes, so legacy callers can push
+                // the main graph after its subgraphs and cycle the graph
+                // once.
+                CycleGraph();
+                EXPECT_TRUE(FlushSession());
+            }
+
+            TEST_F(GraphRunnerTest, InvalidConfigKeepsTheSession) {
+                ASSERT_TRUE(OpenSession(Serialize(kGraph)));
+                EXPECT_FALSE(OpenSession("not a graph config"));
+                EXPECT_TRUE(FlushSession());
+            }
+
+        }  // namespace
+    }  // namespace wasm
+}  // namespace drishti
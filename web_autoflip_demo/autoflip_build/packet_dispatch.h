@@ -0,0 +1,141 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Type-specialized observers for the output streams of the wasm bridge. The
+// packet type of a stream is fixed, so it is checked once, on the first
+// packet, and every later packet goes straight to the handler for that type.
+
+#ifndef WEB_AUTOFLIP_DEMO_AUTOFLIP_BUILD_PACKET_DISPATCH_H_
+#define WEB_AUTOFLIP_DEMO_AUTOFLIP_BUILD_PACKET_DISPATCH_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "third_party/mediapipe/examples/desktop/autoflip/autoflip_messages.proto.h"
+#include "third_party/mediapipe/framework/packet.h"
+#include "third_party/mediapipe/framework/port/logging.h"
+
+namespace drishti {
+    namespace wasm {
+
+        // Packet types the bridge hands to JS.
+        enum class PacketType {
+            kUnknown = 0,
+            kFloat,
+            kSize,
+            kBool,
+            kExternalRenderFrame,
+            kDetectionSet,
+        };
+
+        // Returns true if |packet| holds a value of |type|.
+        inline bool HasPacketType(const Packet& packet, PacketType type) {
+            switch (type) {
+            case PacketType::kFloat:
+                return packet.ValidateAsType<float>().ok();
+            case PacketType::kSize:
+                return packet.ValidateAsType<std::pair<int, int>>().ok();
+            case PacketType::kBool:
+                return packet.ValidateAsType<bool>().ok();
+            case PacketType::kExternalRenderFrame:
+                return packet.ValidateAsType<mediapipe::autoflip::ExternalRenderFrame>().ok();
+            case PacketType::kDetectionSet:
+                return packet.ValidateAsType<mediapipe::autoflip::DetectionSet>().ok();
+            case PacketType::kUnknown:
+                return false;
+            }
+            return false;
+        }
+
+        // Returns the type of |packet| by trying each supported type in turn,
+        // or kUnknown.
+        inline PacketType ResolvePacketType(const Packet& packet) {
+            for (const PacketType type : { PacketType::kFloat, PacketType::kSize, PacketType::kBool,
+                PacketType::kExternalRenderFrame, PacketType::kDetectionSet }) {
+                if (HasPacketType(packet, type)) {
+                    return type;
+                }
+            }
+            return PacketType::kUnknown;
+        }
+
+        using PacketCallback = std::function<void(const Packet&)>;
+
+        // Returns a callback that hands packets of |type| to the matching
+        // method of |sink| without checking their type. |sink| must provide
+        // OnFloat, OnSize, OnBool, OnExternalRenderFrame and OnDetectionSet,
+        // each taking the value and the packet timestamp.
+        template <typename Sink>
+        PacketCallback MakeTypedCallback(PacketType type, Sink sink) {
+            switch (type) {
+            case PacketType::kFloat:
+                return [sink](const Packet& packet) {
+                    sink.OnFloat(packet.Get<float>(), packet.Timestamp());
+                };
+            case PacketType::kSize:
+                return [sink](const Packet& packet) {
+                    sink.OnSize(packet.Get<std::pair<int, int>>(), packet.Timestamp());
+                };
+            case PacketType::kBool:
+                return [sink](const Packet& packet) {
+                    sink.OnBool(packet.Get<bool>(), packet.Timestamp());
+                };
+            case PacketType::kExternalRenderFrame:
+                return [sink](const Packet& packet) {
+                    sink.OnExternalRenderFrame(
+                        packet.Get<mediapipe::autoflip::ExternalRenderFrame>(), packet.Timestamp());
+                };
+            case PacketType::kDetectionSet:
+                return [sink](const Packet& packet) {
+                    sink.OnDetectionSet(
+                        packet.Get<mediapipe::autoflip::DetectionSet>(), packet.Timestamp());
+                };
+            case PacketType::kUnknown:
+                break;
+            }
+            return [](const Packet&) {};
+        }
+
+        // Returns an observer callback for a stream of |expected_type|
+        // packets, or of any supported type if kUnknown. The type is checked
+        // on the first packet only; a stream of another type is logged once
+        // and then ignored.
+        template <typename Sink>
+        PacketCallback MakeStreamObserver(const std::string& stream_name, PacketType expected_type,
+            Sink sink) {
+            auto callback = std::make_shared<PacketCallback>();
+            return [stream_name, expected_type, sink, callback](const Packet& packet) {
+                if (!*callback) {
+                    PacketType type = expected_type;
+                    if (type == PacketType::kUnknown) {
+                        type = ResolvePacketType(packet);
+                    } else if (!HasPacketType(packet, type)) {
+                        type = PacketType::kUnknown;
+                    }
+                    if (type == PacketType::kUnknown) {
+                        LOG(ERROR) << "Unexpected packet type on " << stream_name << ": "
+                            << packet.DebugTypeName();
+                    }
+                    *callback = MakeTypedCallback(type, sink);
+                }
+                (*callback)(packet);
+            };
+        }
+
+    }  // namespace wasm
+}  // namespace drishti
+
+#endif  // WEB_AUTOFLIP_DEMO_AUTOFLIP_BUILD_PACKET_DISPATCH_H_
@@ -0,0 +1,131 @@
+// Copyright 2020 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Measures the per-packet cost of dispatching output packets to their
+// handler, comparing the ValidateAsType chain the bridge used to run on every
+// packet with the observers of packet_dispatch.h, which check the type once.
+//
+// Example:
+//   packet_dispatch_benchmark --num_packets=1000000
+
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "third_party/absl/strings/str_format.h"
+#include "third_party/absl/time/clock.h"
+#include "third_party/absl/time/time.h"
+#include "third_party/mediapipe/examples/desktop/autoflip/autoflip_messages.proto.h"
+#include "third_party/mediapipe/framework/packet.h"
+#include "third_party/mediapipe/framework/port/commandlineflags.h"
+#include "web_autoflip_demo/autoflip_build/packet_dispatch.h"
+
+DEFINE_int32(num_packets, 1000000, "Number of packets dispatched per case.");
+
+namespace drishti {
+    namespace wasm {
+        namespace {
+
+            // Counts the packets it receives, so that the handlers are not
+            // optimized away.
+            struct CountingSink {
+                int64* count;
+
+                void OnFloat(float value, const Timestamp& timestamp) const { ++*count; }
+                void OnSize(const std::pair<int, int>& size, const Timestamp& timestamp) const {
+                    ++*count;
+                }
+                void OnBool(bool value, const Timestamp& timestamp) const { ++*count; }
+                void OnExternalRenderFrame(const mediapipe::autoflip::ExternalRenderFrame& frame,
+                    const Timestamp& timestamp) const {
+                    ++*count;
+                }
+                void OnDetectionSet(const mediapipe::autoflip::DetectionSet& detection_set,
+                    const Timestamp& timestamp) const {
+                    ++*count;
+                }
+            };
+
+            // The dispatch the bridge ran on every packet before.
+            void DispatchByValidation(const Packet& packet, const CountingSink& sink) {
+                if (packet.ValidateAsType<float>().ok()) {
+                    sink.OnFloat(packet.Get<float>(), packet.Timestamp());
+                }
+                else if (packet.ValidateAsType<std::pair<int, int>>().ok()) {
+                    sink.OnSize(packet.Get<std::pair<int, int>>(), packet.Timestamp());
+                }
+                else if (packet.ValidateAsType<bool>().ok()) {
+                    sink.OnBool(packet.Get<bool>(), packet.Timestamp());
+                }
+                else if (packet.ValidateAsType<mediapipe::autoflip::ExternalRenderFrame>().ok()) {
+                    sink.OnExternalRenderFrame(
+                        packet.Get<mediapipe::autoflip::ExternalRenderFrame>(), packet.Timestamp());
+                }
+                else if (packet.ValidateAsType<mediapipe::autoflip::DetectionSet>().ok()) {
+                    sink.OnDetectionSet(
+                        packet.Get<mediapipe::autoflip::DetectionSet>(), packet.Timestamp());
+                }
+            }
+
+            // Returns the nanoseconds per packet of |dispatch| over |packets|.
+            template <typename Dispatch>
+            double NanosPerPacket(const std::vector<Packet>& packets, Dispatch dispatch) {
+                const absl::Time start = absl::Now();
+                for (const auto& packet : packets) {
+                    dispatch(packet);
+                }
+                return absl::ToDoubleNanoseconds(absl::Now() - start) / packets.size();
+            }
+
+            void RunCase(const std::string& name, const Packet& packet, PacketType type) {
+                std::vector<Packet> packets;
+                packets.reserve(FLAGS_num_packets);
+                for (int i = 0; i < FLAGS_num_packets; ++i) {
+                    packets.push_back(packet.At(Timestamp(i)));
+                }
+                int64 count = 0;
+                const CountingSink sink{ &count };
+                const double validated = NanosPerPacket(packets,
+                    [&sink](const Packet& packet) { DispatchByValidation(packet, sink); });
+                const PacketCallback resolved = MakeStreamObserver(name, PacketType::kUnknown, sink);
+                const double resolved_once = NanosPerPacket(packets, resolved);
+                const PacketCallback typed = MakeStreamObserver(name, type, sink);
+                const double typed_once = NanosPerPacket(packets, typed);
+                CHECK_EQ(count, 3 * static_cast<int64>(packets.size()));
+                std::cout << absl::StrFormat("%-24s %12.1f %12.1f %12.1f\n", name, validated,
+                    resolved_once, typed_once);
+            }
+
+            void RunBenchmark() {
+                std::cout << absl::StrFormat("%-24s %12s %12s %12s\n", "ns/packet", "validated",
+                    "resolved", "typed");
+                RunCase("float", MakePacket<float>(1.0f), PacketType::kFloat);
+                RunCase("bool", MakePacket<bool>(true), PacketType::kBool);
+                RunCase("ExternalRenderFrame",
+                    MakePacket<mediapipe::autoflip::ExternalRenderFrame>(),
+                    PacketType::kExternalRenderFrame);
+                RunCase("DetectionSet", MakePacket<mediapipe::autoflip::DetectionSet>(),
+                    PacketType::kDetectionSet);
+            }
+
+        }  // namespace
+    }  // namespace wasm
+}  // namespace drishti
+
+int main(int argc, char** argv) {
+    gflags::ParseCommandLineFlags(&argc, &argv, true);
+    drishti::wasm::RunBenchmark();
+    return 0;
+}
@@ -0,0 +1,227 @@
+/**
+Copyright 2020 Google LLC
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/**
+ * Headless throughput benchmark of AutoFlip wasm builds. Each build runs the
+ * web graph on the same synthetic I420 clip in its own Node process, and the
+ * frames per second of each build are printed side by side.
+ *
+ * Usage:
+ *   node benchmark/bridge_benchmark.js \
+ *     single=src/autoflip_wasm/autoflip_live_bin.js \
+ *     threaded=path/to/autoflip_live_mt_bin.js \
+ *     simd=path/to/autoflip_live_simd_bin.js \
+ *     [--frames=300] [--width=640] [--height=360] [--threads=<cpus>]
+ *
+ * Each build directory must hold the build's .wasm file, the packed assets
+ * and autoflip_web_graph.binarypb, as src/autoflip_wasm does. Threaded builds
+ * need a Node version with wasm threads (--experimental-wasm-threads before
+ * Node 16).
+ */
+
+const childProcess = require('child_process');
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const vm = require('vm');
+
+const FRAME_RING_SLOTS = 8;
+const PACKED_ASSETS = 'autoflip_live_packed_assets.data';
+
+/** Parses key=value and --key=value arguments. */
+function parseArgs(argv) {
+  const options = {
+    frames: 300,
+    width: 640,
+    height: 360,
+    threads: os.cpus().length,
+  };
+  const builds = [];
+  for (const arg of argv) {
+    const [key, value] = arg.replace(/^--/, '').split('=');
+    if (arg.startsWith('--')) {
+      options[key] = key === 'run' ? value : Number(value);
+    } else {
+      builds.push({ label: key, module: path.resolve(value) });
+    }
+  }
+  return { options, builds };
+}
+
+/** Fills an I420 frame with a square that moves and cuts halfway. */
+function fillFrame(heap, ptr, width, height, index, numFrames) {
+  const lumaSize = width * height;
+  const cut = index >= numFrames / 2;
+  heap.fill(cut ? 200 : 16, ptr, ptr + lumaSize);
+  heap.fill(128, ptr + lumaSize, ptr + (lumaSize * 3) / 2);
+  const size = Math.floor(height / 3);
+  const left = ((cut ? width / 2 : 0) + index) % (width - size);
+  for (let row = size; row < 2 * size; row++) {
+    const start = ptr + row * width + left;
+    heap.fill(cut ? 16 : 235, start, start + size);
+  }
+}
+
+/** Loads the wasm module of a build, with its packed assets. */
+function loadModule(modulePath) {
+  const dir = path.dirname(modulePath);
+  const loader = path.join(dir, 'autoflip_live_loader.js');
+  global.Module = {
+    locateFile: (file) => path.join(dir, path.basename(file)),
+    // Node's fetch does not load file paths.
+    wasmBinary: fs.readFileSync(modulePath.replace(/\.js$/, '.wasm')),
+    getPreloadedPackage: () => {
+      const data = fs.readFileSync(path.join(dir, PACKED_ASSETS));
+      return data.buffer.slice(
+        data.byteOffset,
+        data.byteOffset + data.length,
+      );
+    },
+  };
+  if (fs.existsSync(loader)) {
+    // The loader only resolves its package path in a page or a worker.
+    global.location = { pathname: `${dir}/` };
+    vm.runInThisContext(fs.readFileSync(loader, 'utf8'), {
+      filename: loader,
+    });
+  }
+  return require(modulePath)(global.Module);
+}
+
+/** Runs one build on the synthetic clip and reports its throughput. */
+async function runBuild(modulePath, options) {
+  const module = await loadModule(modulePath);
+  if (!module.openSession || !module.BinaryOutputListener) {
+    throw new Error(
+      `${modulePath} predates the session and binary output API`,
+    );
+  }
+  const threads = module.setNumThreads
+    ? module.setNumThreads(options.threads)
+    : 1;
+  const simd = module.simdKernelsEnabled
+    ? module.simdKernelsEnabled()
+    : false;
+  let numCrops = 0;
+  const listener = module.BinaryOutputListener.implement({
+    onRecords: (stream, ptr, numRecords) => {
+      numCrops += numRecords;
+    },
+  });
+  module.attachBinaryListener('external_rendering_per_frame', 256, listener);
+  module.setAspectRatio(9, 16);
+  const graph = fs.readFileSync(
+    path.join(path.dirname(modulePath), 'autoflip_web_graph.binarypb'),
+  );
+  module.openSession(graph);
+
+  const { frames, width, height } = options;
+  module.createFrameRing(width, height, FRAME_RING_SLOTS);
+  module.startStream(width, height, 30);
+  const slotBytes = (width * height * 3) / 2;
+  const timestampsPtr = module._malloc(FRAME_RING_SLOTS * 8);
+
+  const start = process.hrtime.bigint();
+  for (let i = 0; i < frames; i += FRAME_RING_SLOTS) {
+    const count = Math.min(FRAME_RING_SLOTS, frames - i);
+    let ptr = module.acquireFrameSlots(count);
+    if (ptr === 0) {
+      module.runTillIdle();
+      ptr = module.acquireFrameSlots(count);
+    }
+    const timestamps = new Float64Array(
+      module.HEAPF64.buffer,
+      timestampsPtr,
+      count,
+    );
+    for (let j = 0; j < count; j++) {
+      const framePtr = ptr + j * slotBytes;
+      fillFrame(module.HEAPU8, framePtr, width, height, i + j, frames);
+      timestamps[j] = Math.round(((i + j) * 1000000) / 30);
+    }
+    const ok = module.processYuvBatch(
+      ptr,
+      count,
+      width,
+      height,
+      timestampsPtr,
+      false,
+    );
+    if (!ok) {
+      throw new Error(`Frame batch at ${i} failed`);
+    }
+  }
+  module.flushSession();
+  const seconds = Number(process.hrtime.bigint() - start) / 1e9;
+  return { threads, simd, frames, numCrops, seconds, fps: frames / seconds };
+}
+
+async function main() {
+  const { options, builds } = parseArgs(process.argv.slice(2));
+  if (options.run) {
+    const result = await runBuild(path.resolve(options.run), options);
+    process.send(result);
+    return;
+  }
+  if (builds.length === 0) {
+    console.error('Usage: bridge_benchmark.js label=path/to/bin.js ...');
+    process.exit(1);
+  }
+  console.log(
+    `${options.frames} frames of ${options.width}x${options.height} I420`,
+  );
+  console.log(
+    'build'.padEnd(16),
+    'threads'.padStart(8),
+    'simd'.padStart(6),
+    'fps'.padStart(10),
+  );
+  const passthrough = process.argv
+    .slice(2)
+    .filter((arg) => arg.startsWith('--'));
+  for (const build of builds) {
+    // Each build runs in its own process, since emscripten modules share
+    // globals.
+    const result = await new Promise((resolve, reject) => {
+      const child = childProcess.fork(
+        __filename,
+        [...passthrough, `--run=${build.module}`],
+        { execArgv: process.execArgv },
+      );
+      child.on('message', resolve);
+      child.on('exit', (code) => {
+        if (code !== 0) {
+          reject(new Error(`${build.label} exited with ${code}`));
+        }
+      });
+    });
+    if (result.numCrops !== result.frames) {
+      console.warn(
+        `${build.label}: ${result.numCrops} crop windows for ${result.frames} frames`,
+      );
+    }
+    console.log(
+      build.label.padEnd(16),
+      String(result.threads).padStart(8),
+      (result.simd ? 'yes' : 'no').padStart(6),
+      result.fps.toFixed(1).padStart(10),
+    );
+  }
+}
+
+main().catch((error) => {
+  console.error(error);
+  process.exit(1);
+});
@@ -15,7 +15,10 @@
 
 /** The interface defines a cropping information object. */
 interface CropInfo {
-  /** The information type, like "finishedAnalysis", "sectionAnalysis". */
+  /**
+   * The information type, like "finishedAnalysis", "currentAnalysis" or
+   * "sceneAnalysis" for the crop windows of scenes finished mid-section.
+   */
   type: string;
   /** The crop windows for processed frames. */
   cropWindows: ExternalRenderingInformation[];
@@ -28,6 +31,11 @@ interface CropInfo {
   user: { inputWidth: number; inputHeight: number };
   faceDetections: faceDetectRegion[][];
   borders: BorderRegion[][];
+  /**
+   * The timestamp in microseconds up to which the crop windows of the video
+   * are final, if known.
+   */
+  watermarkUs?: number;
 }
 
 /** The interface defines information for a resizing dimension. */
@@ -74,6 +82,8 @@ interface Frame {
   data: ArrayBuffer;
   /** The sequence number of frame of the whole video */
   frameId: number;
+  /** The presentation timestamp of the frame in microseconds, if known */
+  timestampUs?: number;
 }
 
 /**
@@ -215,3 +225,38 @@ interface RefeedSignals {
    */
   shots: { shot: boolean; timestamp: number }[];
 }
+
+/** Statistics of the AutoFlip graph, as returned by getStats(). */
+interface GraphStats {
+  /** Size of the wasm heap in bytes. It never shrinks. */
+  heapSize: number;
+  /** Bytes of the heap allocated by malloc. */
+  heapUsed: number;
+  /** Largest heapUsed seen by getStats. */
+  heapUsedHighWaterMark: number;
+  /** Frames the graph has not released yet. */
+  framesInFlight: number;
+  framesInFlightHighWaterMark: number;
+  /**
+   * Packets of each graph input stream waiting to be processed. The embind
+   * vectors must be deleted after use.
+   */
+  inputQueues: {
+    size(): number;
+    get(i: number): { stream: string; queued: number };
+    delete(): void;
+  };
+  /** Process time of each calculator, if the graph enables the profiler. */
+  calculators: {
+    size(): number;
+    get(
+      i: number,
+    ): {
+      name: string;
+      processCalls: number;
+      processTimeUs: number;
+      averageProcessTimeUs: number;
+    };
+    delete(): void;
+  };
+}
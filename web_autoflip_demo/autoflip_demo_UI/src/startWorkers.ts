@@ -120,6 +120,10 @@ export function startWorker(): void {
     renderCroppedInfomation(e.data);
     renderShots(e.data);
 
+    if (e.data.type === 'sceneAnalysis') {
+      // Scenes finished mid-section; the section itself is still running.
+      return;
+    }
     if (e.data.type !== 'finishedAnalysis') {
       const expect =
         sectionIndexStorage[
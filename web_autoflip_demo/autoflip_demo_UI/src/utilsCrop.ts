@@ -90,7 +90,9 @@ export function renderCroppedInfomation(videoCropInfo: CropInfo): void {
     `${curAspectRatio.inputHeight}&${curAspectRatio.inputWidth}`
   ].push(borderWrappedFunc);
 
-  if (cropInfo.length !== 0) {
+  if (videoCropInfo.watermarkUs !== undefined) {
+    updateTimeRender(videoCropInfo.watermarkUs / 1000000);
+  } else if (cropInfo.length !== 0) {
     updateTimeRender(
       <number>cropInfo[cropInfo.length - 1].timestampUS / 1000000,
     );
@@ -34,6 +34,18 @@ let refeedInformation: RefeedSignals = {
   shots: [],
 };
 let hasSignals: boolean = false;
+// The signal of the section being analyzed.
+let currentSignal: Signal | undefined;
+// Number of preallocated frame slots in the wasm heap.
+const FRAME_RING_SLOTS: number = 8;
+// Heap offset of the timestamps of a frame batch, in microseconds.
+let timestampsPtr: number = 0;
+// Number of binary output records delivered per notification at most.
+const BINARY_OUTPUT_CAPACITY: number = 256;
+// Per-frame output logging of the graph and a graph statistics log every
+// STATS_INTERVAL_MS; off in the shipped demo.
+const VERBOSE_LOGGING: boolean = false;
+const STATS_INTERVAL_MS: number = 1000;
 
 let autoflipModule: any;
 declare const Module: any;
@@ -47,22 +59,36 @@ function startAutoflip() {
     const shotPacketListener: any = autoflipModule.PacketListener.implement(
       shotChange,
     );
-    const extPacketListener: any = autoflipModule.PacketListener.implement(
-      externalRendering,
-    );
-    const featurePacketListener: any = autoflipModule.PacketListener.implement(
-      featureDetect,
+    const binaryOutputListener: any = autoflipModule.BinaryOutputListener.implement(
+      binaryOutputs,
     );
     const borderPacketListener: any = autoflipModule.PacketListener.implement(
       borderDetect,
     );
+    const watermarkListener: any = autoflipModule.WatermarkListener.implement(
+      cropWatermark,
+    );
+    autoflipModule.createFrameRing(videoWidth, videoHeight, FRAME_RING_SLOTS);
 
-    autoflipModule.attachListener(
+    autoflipModule.attachBinaryListener(
       'external_rendering_per_frame',
-      extPacketListener,
+      BINARY_OUTPUT_CAPACITY,
+      binaryOutputListener,
+    );
+    autoflipModule.attachWatermarkListener(
+      'external_rendering_per_frame',
+      watermarkListener,
+    );
+    autoflipModule.attachTypedListener(
+      'shot_change',
+      autoflipModule.PacketType.BOOL,
+      shotPacketListener,
+    );
+    autoflipModule.attachBinaryListener(
+      'salient_regions',
+      BINARY_OUTPUT_CAPACITY,
+      binaryOutputListener,
     );
-    autoflipModule.attachListener('shot_change', shotPacketListener);
-    autoflipModule.attachListener('salient_regions', featurePacketListener);
     autoflipModule.attachListener('borders', borderPacketListener);
 
     fetch('autoflip_wasm/autoflip_web_graph.binarypb')
@@ -73,7 +99,17 @@ function startAutoflip() {
       )
       .then((buffer): void => {
         autoflipModule.setAspectRatio(videoAspectWidth, videoAspectHeight);
-        autoflipModule.changeBinaryGraph(buffer);
+        // Pthreads builds run the graph on a pool of this many threads.
+        const numThreads: number = autoflipModule.setNumThreads(
+          ctx.navigator.hardwareConcurrency || 1,
+        );
+        console.log(`AUTOFLIP: graph runs on ${numThreads} thread(s)`);
+        autoflipModule.setVerboseLogging(VERBOSE_LOGGING);
+        autoflipModule.openSession(buffer);
+        autoflipModule.startStream(videoWidth, videoHeight, 15);
+        if (VERBOSE_LOGGING) {
+          setInterval(logGraphStats, STATS_INTERVAL_MS);
+        }
       });
   });
 }
@@ -82,12 +118,15 @@ function startAutoflip() {
 onmessage = function (e: MessageEvent): void {
   let signal: Signal = e.data;
   console.log(`AUTOFLIP: video(${signal.videoId}) start to crop`, signal);
+  currentSignal = signal;
 
   if (signal.type === 'changeAspectRatio') {
     videoAspectWidth = signal.user.inputWidth;
     videoAspectHeight = signal.user.inputHeight;
     autoflipModule.setAspectRatio(videoAspectWidth, videoAspectHeight);
-    autoflipModule.cycleGraph();
+    // Restarts the analysis on the same graph, with the new aspect ratio.
+    autoflipModule.resetSession();
+    autoflipModule.startStream(videoWidth, videoHeight, 15);
     timestampHead = Math.floor(signal.startId * (1 / 15) * 1000000);
     resultCropInfo = [];
     resultShots = [];
@@ -124,7 +163,7 @@ onmessage = function (e: MessageEvent): void {
 
   if (hasSignals) {
     refeedSignals();
-    const b = autoflipModule.closeGraphInternal();
+    autoflipModule.flushSession();
     // This posts the analysis result back to main script.
     ctx.postMessage({
       type: 'finishedAnalysis',
@@ -147,7 +186,7 @@ onmessage = function (e: MessageEvent): void {
         let frameData: Frame[] = value;
         handleFrames(frameData, signal);
         if (signal.end === true) {
-          const b = autoflipModule.closeGraphInternal();
+          autoflipModule.flushSession();
           // This posts the analysis result back to main script.
           ctx.postMessage({
             type: 'finishedAnalysis',
@@ -198,25 +237,36 @@ let shotChange = {
     }
   },
 };
-let externalRendering = {
-  onExternalRendering: (stream: string, proto: string) => {
-    let cropInfo = convertSeralizedExternalRenderingInfoToObj(proto);
-    resultCropInfo.push(cropInfo);
+// Receives the crop windows and salient regions as fixed-layout records,
+// once per batch of frames.
+let binaryOutputs = {
+  onRecords: (stream: string, recordsPtr: number, numRecords: number) => {
+    if (stream === 'external_rendering_per_frame') {
+      resultCropInfo.push(...readCropRecords(recordsPtr, numRecords));
+    } else if (stream === 'salient_regions') {
+      readDetectionRecords(recordsPtr, numRecords, resultFaces);
+    }
   },
 };
-let featureDetect = {
-  onFeature: (stream: string, proto: string, timestamp: number) => {
-    let faceInfo: faceDetectRegion[] = convertSeralizedFaceDetectionInfoToObj(
-      proto,
-      timestamp,
-    );
-    resultFaces.push(faceInfo);
-    if (!hasSignals) {
-      refeedInformation.detections.push({
-        detection: proto,
-        timestamp: timestamp,
-      });
+// Posts the crop windows of every scene as soon as the graph has emitted them,
+// so that playback can start before the section, or the video, is analyzed.
+let cropWatermark = {
+  onWatermark: (stream: string, timestampUs: number) => {
+    if (currentSignal === undefined || resultCropInfo.length === 0) {
+      return;
     }
+    ctx.postMessage({
+      type: 'sceneAnalysis',
+      cropWindows: resultCropInfo,
+      startId: currentSignal.startId,
+      videoId: currentSignal.videoId,
+      shots: [],
+      faceDetections: [],
+      borders: [],
+      user: currentSignal.user,
+      watermarkUs: timestampUs + timestampHead,
+    });
+    resultCropInfo = [];
   },
 };
 let borderDetect = {
@@ -248,81 +298,85 @@ function convertSeralizedRectToObj(protoArray: number[]): Rect | undefined {
   };
 }
 
-/** Transfers the background color rectangles from stream. */
-function convertSeralizedColorToObj(protoArray: number[]): Color | undefined {
-  if (protoArray.length !== 3) {
-    return undefined;
-  }
-  return {
-    r: protoArray[0] ?? 0,
-    g: protoArray[1] ?? 0,
-    b: protoArray[2] ?? 0,
-  };
+/** Returns a view of binary output records in the wasm heap. */
+function recordsView(
+  recordsPtr: number,
+  numRecords: number,
+  recordSize: number,
+): Float64Array {
+  return new Float64Array(
+    ctx.Module.HEAPF64.buffer,
+    recordsPtr,
+    numRecords * recordSize,
+  );
 }
 
-/** Transfers the overall crop and render information from stream. */
-function convertSeralizedExternalRenderingInfoToObj(
-  protoString: string,
-): ExternalRenderingInformation {
-  const protoArray: any[] = JSON.parse(protoString);
-  const renderInformation: Partial<ExternalRenderingInformation> = {};
-  if (protoArray[0] ?? false) {
-    renderInformation.cropFromLocation = convertSeralizedRectToObj(
-      protoArray[0] as any[],
-    );
-  }
-  if (protoArray[1] ?? false) {
-    renderInformation.renderToLocation = convertSeralizedRectToObj(
-      protoArray[1] as any[],
-    );
-  }
-  if (protoArray[2] ?? false) {
-    renderInformation.padding_color = convertSeralizedColorToObj(
-      protoArray[2] as any[],
-    );
-  }
-  renderInformation.timestampUS = (protoArray[3] ?? 0) + timestampHead;
-  if (protoArray[4] ?? false) {
-    renderInformation.targetWidth = protoArray[4];
-  }
-  if (protoArray[5] ?? false) {
-    renderInformation.targetHeight = protoArray[5];
+/** Reads the crop windows from ExternalRenderFrame records. */
+function readCropRecords(
+  recordsPtr: number,
+  numRecords: number,
+): ExternalRenderingInformation[] {
+  const size = autoflipModule.CROP_RECORD_SIZE;
+  const records = recordsView(recordsPtr, numRecords, size);
+  const cropInfo: ExternalRenderingInformation[] = [];
+  for (let i = 0; i < records.length; i += size) {
+    cropInfo.push({
+      timestampUS: records[i] + timestampHead,
+      cropFromLocation: {
+        x: records[i + 1],
+        y: records[i + 2],
+        width: records[i + 3],
+        height: records[i + 4],
+      },
+      renderToLocation: {
+        x: records[i + 5],
+        y: records[i + 6],
+        width: records[i + 7],
+        height: records[i + 8],
+      },
+      padding_color: {
+        r: records[i + 9],
+        g: records[i + 10],
+        b: records[i + 11],
+      },
+      targetWidth: records[i + 12],
+      targetHeight: records[i + 13],
+    });
   }
-  return renderInformation;
+  return cropInfo;
 }
 
-/** Transfers the overall crop and render information from stream. */
-function convertSeralizedFaceDetectionInfoToObj(
-  protoString: string,
-  timestamp: number,
-): faceDetectRegion[] {
-  const protoArray: any[] = JSON.parse(protoString);
-  let faceDetectionsInfo: faceDetectRegion[] = [];
-
-  if (protoArray.length === 0) {
-    const faceDetect: faceDetectRegion = {};
-    faceDetect.timestamp = timestamp + timestampHead;
-    faceDetectionsInfo.push(faceDetect);
-  }
-  if (protoArray[1] ?? false) {
-    for (let i = 0; i < protoArray[1].length; i++) {
-      const faceDetect: faceDetectRegion = {};
-      if (protoArray[1][i][1] ?? false) {
-        faceDetect.score = protoArray[1][i][1];
-      }
-      if (protoArray[1][i][5] ?? false) {
-        faceDetect.signalType = protoArray[1][i][5][0];
-      }
-      if (protoArray[1][i][7] ?? false) {
-        faceDetect.faceRegion = convertSeralizedRectToObj(
-          protoArray[1][i][7] as any[],
-        );
-      }
-      faceDetect.timestamp = timestamp + timestampHead;
-      faceDetectionsInfo.push(faceDetect);
+/**
+ * Appends the regions of each frame from DetectionSet records to frames. The
+ * regions of a frame may continue from the previous batch.
+ */
+function readDetectionRecords(
+  recordsPtr: number,
+  numRecords: number,
+  frames: faceDetectRegion[][],
+): void {
+  const size = autoflipModule.DETECTION_RECORD_SIZE;
+  const records = recordsView(recordsPtr, numRecords, size);
+  for (let i = 0; i < records.length; i += size) {
+    const faceDetect: faceDetectRegion = {
+      timestamp: records[i] + timestampHead,
+    };
+    // Region index 0 starts a frame, -1 is a frame without regions.
+    if (records[i + 1] <= 0 || frames.length === 0) {
+      frames.push([]);
     }
+    if (records[i + 1] >= 0) {
+      faceDetect.faceRegion = {
+        x: records[i + 2],
+        y: records[i + 3],
+        width: records[i + 4],
+        height: records[i + 5],
+      };
+      faceDetect.score = records[i + 6];
+      faceDetect.signalType = records[i + 7];
+    }
+    frames[frames.length - 1].push(faceDetect);
   }
-  return faceDetectionsInfo;
 }
 
 /** Transfers the border information from stream. */
@@ -385,6 +439,14 @@ async function refeedSignals(): Promise<string> {
   });
 }
 
+/**
+ * Returns the presentation timestamp of a frame. Frames decoded without one
+ * are at the 15 fps of the ffmpeg worker.
+ */
+function frameTimestampUs(frame: Frame): number {
+  return frame.timestampUs ?? Math.round((frame.frameId * 1000000) / 15);
+}
+
 /** Processes input frames with autoflip wasm. */
 async function handleFrames(
   frameData: Frame[],
@@ -395,20 +457,54 @@ async function handleFrames(
       `AUTOFLIP: video (${signal.videoId}) received from main`,
       frameData,
     );
-    const info = { width: videoWidth, height: videoHeight };
-    for (let i = 0; i < frameData.length; i++) {
-      const image = frameData[i].data; // Array buffer from FFmpeg, .tiff <-
-      // Saving array buffer to the wasm heap memory.
-      const numBytes = image.byteLength;
-      const ptr = ctx.Module._malloc(numBytes);
-      const heapBytes = new Uint8Array(ctx.Module.HEAPU8.buffer, ptr, numBytes);
-      const uint8Image = new Uint8Array(image);
-      heapBytes.set(uint8Image);
-      // End saving memory.
-      const status = autoflipModule.processRawYuvBytes(
+    const slotBytes = (videoWidth * videoHeight * 3) / 2;
+    if (timestampsPtr === 0) {
+      timestampsPtr = autoflipModule._malloc(FRAME_RING_SLOTS * 8);
+    }
+    // Frames are sent in batches of up to FRAME_RING_SLOTS, so that the graph
+    // runs once per batch instead of once per frame.
+    for (let i = 0; i < frameData.length; i += FRAME_RING_SLOTS) {
+      const count = Math.min(FRAME_RING_SLOTS, frameData.length - i);
+      let ptr: number = autoflipModule.acquireFrameSlots(count);
+      if (ptr === 0) {
+        // Let the graph finish with queued frames to free their slots.
+        autoflipModule.runTillIdle();
+        ptr = autoflipModule.acquireFrameSlots(count);
+      }
+      if (ptr === 0) {
+        throw new Error('Autoflip frame ring is full!');
+      }
+      const timestamps = new Float64Array(
+        ctx.Module.HEAPF64.buffer,
+        timestampsPtr,
+        count,
+      );
+      for (let j = 0; j < count; j++) {
+        const image = frameData[i + j].data; // Array buffer from FFmpeg, .tiff <-
+        if (image.byteLength !== slotBytes) {
+          throw new Error(
+            `Autoflip expects I420 frames of ${slotBytes} bytes!`,
+          );
+        }
+        // Saving array buffer to a preallocated frame slot in the heap.
+        const heapBytes = new Uint8Array(
+          ctx.Module.HEAPU8.buffer,
+          ptr + j * slotBytes,
+          slotBytes,
+        );
+        heapBytes.set(new Uint8Array(image));
+        // Frames are sent at their own timestamps, relative to the start of
+        // the graph run.
+        timestamps[j] = frameTimestampUs(frameData[i + j]) - timestampHead;
+      }
+      // End saving memory. The slots are recycled once the graph releases them.
+      const status = autoflipModule.processYuvBatch(
         ptr,
-        info.width,
-        info.height,
+        count,
+        videoWidth,
+        videoHeight,
+        timestampsPtr,
+        true,
       );
 
       // Do this to check if it saved correctly.
@@ -416,13 +512,49 @@ async function handleFrames(
         console.error(status);
         throw new Error('Autoflip had an error!');
       }
-      // Finish.
-      autoflipModule._free(ptr);
+    }
+    if (VERBOSE_LOGGING) {
+      const occupancy = autoflipModule.getFrameRingOccupancy();
+      console.log(
+        `AUTOFLIP: frame ring ${occupancy.inUse}/${occupancy.slots} in use, ` +
+          `high water mark ${occupancy.highWaterMark}`,
+      );
     }
     resolve('success');
   });
 }
 
+/** Logs the memory use, input queues and slowest calculator of the graph. */
+function logGraphStats(): void {
+  const stats: GraphStats = autoflipModule.getStats();
+  const megabytes = (bytes: number): string => (bytes / 1048576).toFixed(1);
+  const queues: string[] = [];
+  for (let i = 0; i < stats.inputQueues.size(); i++) {
+    const queue = stats.inputQueues.get(i);
+    queues.push(`${queue.stream} ${queue.queued}`);
+  }
+  let slowest = '';
+  let slowestTimeUs = 0;
+  for (let i = 0; i < stats.calculators.size(); i++) {
+    const calculator = stats.calculators.get(i);
+    if (calculator.processTimeUs > slowestTimeUs) {
+      slowestTimeUs = calculator.processTimeUs;
+      slowest =
+        `${calculator.name} ` +
+        `${(calculator.averageProcessTimeUs / 1000).toFixed(1)} ms/call`;
+    }
+  }
+  console.log(
+    `AUTOFLIP: heap ${megabytes(stats.heapUsed)}/` +
+      `${megabytes(stats.heapSize)} MB (high water mark ` +
+      `${megabytes(stats.heapUsedHighWaterMark)} MB), ` +
+      `${stats.framesInFlight} frames in flight, ` +
+      `queues [${queues.join(', ')}], slowest ${slowest}`,
+  );
+  stats.inputQueues.delete();
+  stats.calculators.delete();
+}
+
 /** Reads frame decode data rows from the indexDB. */
 async function readFramesFromIndexedDB(
   videoId: number,